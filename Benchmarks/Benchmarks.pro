@@ -0,0 +1,7 @@
+TEMPLATE      = subdirs
+CONFIG += no_docs_target
+
+SUBDIRS       = \
+                SplitterDrag \
+                LayoutFormat \
+                ModelLayout
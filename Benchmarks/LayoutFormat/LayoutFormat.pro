@@ -0,0 +1,25 @@
+#-------------------------------------------------
+#
+# Parse time and size of a large layout, JSON against CBOR
+#
+#-------------------------------------------------
+
+QT       += core testlib
+QT       -= gui
+
+TARGET = tst_layoutformat
+TEMPLATE = app
+CONFIG += testcase console
+CONFIG -= app_bundle
+
+# The model needs no widgets, its sources are built in
+SOURCES += \
+    tst_layoutformat.cpp \
+    ../../Dock/DockModel.cpp \
+    ../../Dock/StateStore.cpp
+
+HEADERS += \
+    ../../Dock/DockModel.h \
+    ../../Dock/StateStore.h
+
+INCLUDEPATH += ./../../Dock
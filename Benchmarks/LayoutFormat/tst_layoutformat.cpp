@@ -0,0 +1,126 @@
+#include <QtTest>
+#include <QJsonDocument>
+#include <QJsonArray>
+
+#include "DockModel.h"
+
+namespace dock {
+
+// 10 columns of 5 tab groups of 10 tabs: 500 windows, each with a small state
+static const int COLUMN_COUNT = 10;
+static const int GROUPS_PER_COLUMN = 5;
+static const int TABS_PER_GROUP = 10;
+
+class LayoutFormatBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void fileSize();
+    void cborRoundTrip();
+    void parse_data();
+    void parse();
+
+private:
+    static DockModel createLayout();
+
+private:
+    DockModel _model;
+    QByteArray _json;           // As DockContainer writes it
+    QByteArray _compactJson;
+    QByteArray _cbor;
+};
+
+DockModel LayoutFormatBenchmark::createLayout()
+{
+    DockModel model;
+    DockModel::NodeId root = model.createSplitter(Qt::Horizontal);
+    int windowId = 0;
+    for (int c = 0; c < COLUMN_COUNT; c++)
+    {
+        DockModel::NodeId column = model.createSplitter(Qt::Vertical);
+        for (int g = 0; g < GROUPS_PER_COLUMN; g++)
+        {
+            DockModel::NodeId group = model.createTabGroup();
+            for (int t = 0; t < TABS_PER_GROUP; t++)
+            {
+                DockModel::Tab tab;
+                tab.windowType = qHash(QString("Window%1").arg(t));
+                tab.windowId = windowId++;
+                tab.state.insert("Title", QString("Window %1").arg(tab.windowId));
+                tab.state.insert("Zoom", 1.25);
+                tab.state.insert("Scroll", QJsonArray({120, 4096}));
+                tab.state.insert("Pinned", (t % 3) == 0);
+                model.addTab(group, tab);
+            }
+            model.appendChild(column, group, 200);
+        }
+        model.appendChild(root, column, 300);
+    }
+    model.addWindow(root);
+    return model;
+}
+
+void LayoutFormatBenchmark::initTestCase()
+{
+    _model = createLayout();
+    QJsonObject jsonObj;
+    _model.toJson(jsonObj);
+    _json = QJsonDocument(jsonObj).toJson();
+    _compactJson = QJsonDocument(jsonObj).toJson(QJsonDocument::Compact);
+    _cbor = _model.toCbor();
+}
+
+void LayoutFormatBenchmark::fileSize()
+{
+    qInfo("%d windows: json %lld bytes, compact json %lld bytes, cbor %lld bytes (%.0f%% of compact json)",
+          COLUMN_COUNT * GROUPS_PER_COLUMN * TABS_PER_GROUP,
+          qint64(_json.size()), qint64(_compactJson.size()), qint64(_cbor.size()),
+          100.0 * _cbor.size() / _compactJson.size());
+    QVERIFY(_cbor.size() < _compactJson.size());
+}
+
+void LayoutFormatBenchmark::cborRoundTrip()
+{
+    DockModel model;
+    QVERIFY(model.fromCbor(_cbor));
+    QCOMPARE(model.fingerprint(), _model.fingerprint());
+}
+
+void LayoutFormatBenchmark::parse_data()
+{
+    QTest::addColumn<bool>("isCbor");
+    QTest::newRow("json") << false;
+    QTest::newRow("cbor") << true;
+}
+
+// From the bytes of the file to a built model
+void LayoutFormatBenchmark::parse()
+{
+    QFETCH(bool, isCbor);
+    DockModel model;
+    bool isParsed = false;
+    if (isCbor)
+    {
+        QBENCHMARK
+        {
+            isParsed = model.fromCbor(_cbor);
+        }
+    }
+    else
+    {
+        QBENCHMARK
+        {
+            isParsed = model.fromJson(QJsonDocument::fromJson(_json).object());
+        }
+    }
+    QVERIFY(isParsed);
+    QCOMPARE(model.windowCount(), 1);
+}
+
+}
+
+QTEST_GUILESS_MAIN(dock::LayoutFormatBenchmark)
+
+#include "tst_layoutformat.moc"
@@ -0,0 +1,25 @@
+#-------------------------------------------------
+#
+# Layout math of DockModel, on the GUI thread and on a worker pool
+#
+#-------------------------------------------------
+
+QT       += core concurrent testlib
+QT       -= gui
+
+TARGET = tst_modellayout
+TEMPLATE = app
+CONFIG += testcase console
+CONFIG -= app_bundle
+
+# The model needs no widgets, its sources are built in
+SOURCES += \
+    tst_modellayout.cpp \
+    ../../Dock/DockModel.cpp \
+    ../../Dock/StateStore.cpp
+
+HEADERS += \
+    ../../Dock/DockModel.h \
+    ../../Dock/StateStore.h
+
+INCLUDEPATH += ./../../Dock
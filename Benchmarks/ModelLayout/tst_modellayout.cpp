@@ -0,0 +1,121 @@
+#include <QtTest>
+#include <QtConcurrent>
+
+#include "DockModel.h"
+
+namespace dock {
+
+// 10 columns of 5 tab groups, 500 windows in all
+static const int COLUMN_COUNT = 10;
+static const int GROUPS_PER_COLUMN = 5;
+static const int TABS_PER_GROUP = 10;
+static const int WORKER_LAYOUTS = 1000;
+static const QSize MAIN_WINDOW_SIZE(1920, 1080);
+
+class ModelLayoutBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void dockRules();
+    void maximize();
+    void layout();
+    void layoutOnWorkers();
+
+private:
+    static DockModel createLayout();
+};
+
+DockModel ModelLayoutBenchmark::createLayout()
+{
+    DockModel model;
+    DockModel::NodeId root = model.createSplitter(Qt::Horizontal);
+    int windowId = 0;
+    for (int c = 0; c < COLUMN_COUNT; c++)
+    {
+        DockModel::NodeId column = model.createSplitter(Qt::Vertical);
+        for (int g = 0; g < GROUPS_PER_COLUMN; g++)
+        {
+            DockModel::NodeId group = model.createTabGroup();
+            for (int t = 0; t < TABS_PER_GROUP; t++)
+            {
+                DockModel::Tab tab;
+                tab.windowType = t + 1;
+                tab.windowId = windowId++;
+                model.addTab(group, tab);
+            }
+            model.appendChild(column, group, 200);
+        }
+        model.appendChild(root, column, 300);
+    }
+    model.addWindow(root);
+    return model;
+}
+
+// The operations size what they add by the rules DockContainer sizes its widgets with
+void ModelLayoutBenchmark::dockRules()
+{
+    DockModel model = createLayout();
+    model.layout(MAIN_WINDOW_SIZE);
+    DockModel::Tab tab;
+    tab.windowType = 1;
+
+    // Across a column: the tab group is split in a new splitter
+    DockModel::NodeId target = model.tabGroups().first();
+    int extent = model.node(target).geometry.width();
+    DockModel::NodeId group = model.dockAtTabGroup(target, DockModel::RIGHT, tab);
+    QVERIFY(group != DockModel::INVALID_NODE);
+    QCOMPARE(model.node(model.node(group).parent).sizes, DockModel::splitSizes(extent, false));
+
+    // Along the root splitter: the columns give way to the new tab group
+    DockModel::NodeId root = model.window(0).rootSplitter;
+    QList<int> oldSizes;
+    for (int i = 0; i < model.node(root).children.size(); i++)
+    {
+        oldSizes.append(model.node(model.node(root).children.at(i)).geometry.width());
+    }
+    group = model.dockAtRoot(0, DockModel::LEFT, tab);
+    QVERIFY(group != DockModel::INVALID_NODE);
+    QCOMPARE(model.node(root).sizes,
+             DockModel::recalcRootSplitterSizesAfterAddNew(oldSizes, DockModel::ROOT_DOCKED_SIZE_HINT, true));
+    QVERIFY(model.validate());
+}
+
+void ModelLayoutBenchmark::maximize()
+{
+    DockModel model = createLayout();
+    model.layout(MAIN_WINDOW_SIZE);
+    DockModel::NodeId group = model.tabGroups().last();
+    QVERIFY(model.maximize(group, 0));
+    QCOMPARE(model.node(group).geometry, QRect(QPoint(0, 0), MAIN_WINDOW_SIZE));
+    QVERIFY(model.node(model.tabGroups().first()).geometry.isNull());
+    model.restoreMaximized();
+    QVERIFY(model.node(group).geometry.height() < MAIN_WINDOW_SIZE.height());
+}
+
+void ModelLayoutBenchmark::layout()
+{
+    DockModel model = createLayout();
+    QBENCHMARK
+    {
+        model.layout(MAIN_WINDOW_SIZE);
+    }
+}
+
+// Models are plain values: a pool of threads lays out a batch of them without a windowing system
+void ModelLayoutBenchmark::layoutOnWorkers()
+{
+    QList<DockModel> models(WORKER_LAYOUTS, createLayout());
+    QBENCHMARK
+    {
+        QtConcurrent::blockingMap(models, [](DockModel &model) { model.layout(MAIN_WINDOW_SIZE); });
+    }
+    qInfo("%d layouts on %d threads", WORKER_LAYOUTS, QThreadPool::globalInstance()->maxThreadCount());
+    QVERIFY(models.last().node(models.last().tabGroups().first()).geometry.isValid());
+}
+
+}
+
+QTEST_GUILESS_MAIN(dock::ModelLayoutBenchmark)
+
+#include "tst_modellayout.moc"
@@ -0,0 +1,26 @@
+#-------------------------------------------------
+#
+# Allocations and time of a splitter handle drag step
+#
+#-------------------------------------------------
+
+QT       += widgets testlib
+
+TARGET = tst_splitterdrag
+TEMPLATE = app
+CONFIG += testcase console
+CONFIG -= app_bundle
+
+# The splitter is not exported, its sources are built in
+SOURCES += \
+    tst_splitterdrag.cpp \
+    ../../Dock/Splitter.cpp \
+    ../../Dock/SplitterHandle.cpp \
+    ../../Dock/DragFramePacer.cpp
+
+HEADERS += \
+    ../../Dock/Splitter.h \
+    ../../Dock/SplitterHandle.h \
+    ../../Dock/DragFramePacer.h
+
+INCLUDEPATH += ./../../Dock
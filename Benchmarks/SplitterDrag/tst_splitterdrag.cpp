@@ -0,0 +1,215 @@
+#include <QtTest>
+#include <QApplication>
+#include <QMouseEvent>
+
+#include "Splitter.h"
+#include "SplitterHandle.h"
+
+// Heap allocations of the benchmark thread while counting is on. glibc lets the executable
+// replace malloc and friends for every library, Qt containers included
+#if defined(__GLIBC__)
+#define DOCK_COUNT_ALLOCATIONS 1
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *p, size_t size);
+
+static thread_local bool t_isCounting = false;
+static thread_local int t_allocations = 0;
+
+extern "C" void *malloc(size_t size) noexcept
+{
+    if (t_isCounting)
+    {
+        t_allocations++;
+    }
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) noexcept
+{
+    if (t_isCounting)
+    {
+        t_allocations++;
+    }
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *p, size_t size) noexcept
+{
+    if (t_isCounting)
+    {
+        t_allocations++;
+    }
+    return __libc_realloc(p, size);
+}
+#endif
+
+namespace dock {
+
+static const int CHILD_SIZE = 100;
+static const int DRAG_STEPS = 200;
+
+// The drag step through the protected API a splitter subclass has
+class DragSplitter : public Splitter
+{
+public:
+    DragSplitter() { setMinimumWidgetSize(CHILD_SIZE / 5); }
+    using Splitter::solveDragStep;
+};
+
+class SplitterDragBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void solveAllocations_data();
+    void solveAllocations();
+    void dragStep_data();
+    void dragStep();
+
+private:
+    // childCount children side by side, every fourth one a vertical splitter of two widgets
+    DragSplitter *createSplitter(int childCount);
+    void pressHandle(Splitter *splitter, int handleIndex);
+    static SplitterHandle *handle(Splitter *splitter, int handleIndex);
+    void childCountData();
+};
+
+DragSplitter *SplitterDragBenchmark::createSplitter(int childCount)
+{
+    DragSplitter *splitter = new DragSplitter();
+    // Every move is processed as it comes, not at the next frame
+    splitter->setFramePacedResize(false);
+    for (int i = 0; i < childCount; i++)
+    {
+        if (i % 4 == 0)
+        {
+            Splitter *nested = new DragSplitter();
+            nested->setOrientation(Qt::Vertical);
+            nested->addWidget(new QWidget());
+            nested->addWidget(new QWidget());
+            splitter->addWidget(nested);
+        }
+        else
+        {
+            splitter->addWidget(new QWidget());
+        }
+    }
+    // Shown, so that the nested splitters get their resize events as on screen
+    splitter->resize(childCount * CHILD_SIZE, 600);
+    splitter->show();
+    if (!QTest::qWaitForWindowExposed(splitter))
+    {
+        qWarning("The splitter was not exposed");
+    }
+    splitter->updateSizes(QList<int>(childCount, CHILD_SIZE));
+    return splitter;
+}
+
+SplitterHandle *SplitterDragBenchmark::handle(Splitter *splitter, int handleIndex)
+{
+    // Handles are created as the children are added, in their order
+    return splitter->findChildren<SplitterHandle *>(QString(), Qt::FindDirectChildrenOnly).at(handleIndex);
+}
+
+void SplitterDragBenchmark::pressHandle(Splitter *splitter, int handleIndex)
+{
+    QPoint globalPos(1000, 100);
+    QMouseEvent pressEvent(QEvent::MouseButtonPress, QPointF(0, 0), QPointF(globalPos),
+                           Qt::LeftButton, Qt::LeftButton, Qt::NoModifier);
+    QApplication::sendEvent(handle(splitter, handleIndex), &pressEvent);
+}
+
+void SplitterDragBenchmark::childCountData()
+{
+    QTest::addColumn<int>("childCount");
+    QTest::newRow("2") << 2;
+    QTest::newRow("8") << 8;
+    QTest::newRow("32") << 32;
+    QTest::newRow("128") << 128;
+    QTest::newRow("256") << 256;
+}
+
+void SplitterDragBenchmark::solveAllocations_data()
+{
+    childCountData();
+}
+
+// What a drag step computes before it touches a widget: proportions, the splitter's geometries
+// and those of every nested splitter. Reserved on press, it must not allocate
+void SplitterDragBenchmark::solveAllocations()
+{
+#if defined(DOCK_COUNT_ALLOCATIONS)
+    QFETCH(int, childCount);
+    QScopedPointer<DragSplitter> splitter(createSplitter(childCount));
+    int handleIndex = childCount / 2 - 1;
+    pressHandle(splitter.data(), handleIndex);
+
+    int maxAllocations = 0;
+    for (int i = 0; i < DRAG_STEPS; i++)
+    {
+        int moveDist = (i % 2 == 0) ? i % 40 : -(i % 40);
+        t_allocations = 0;
+        t_isCounting = true;
+        splitter->solveDragStep(moveDist);
+        t_isCounting = false;
+        maxAllocations = qMax(maxAllocations, t_allocations);
+    }
+    QCOMPARE(maxAllocations, 0);
+#else
+    QSKIP("Counting allocations needs glibc");
+#endif
+}
+
+void SplitterDragBenchmark::dragStep_data()
+{
+    childCountData();
+}
+
+// A whole drag step, the geometries applied to the widgets. Qt may allocate inside setGeometry
+// and for the event that turns updates back on, so that count is reported, not checked
+void SplitterDragBenchmark::dragStep()
+{
+    QFETCH(int, childCount);
+    QScopedPointer<DragSplitter> splitter(createSplitter(childCount));
+    int handleIndex = childCount / 2 - 1;
+    SplitterHandle *movedHandle = handle(splitter.data(), handleIndex);
+    pressHandle(splitter.data(), handleIndex);
+
+    int step = 0;
+    int allocations = 0;
+    QBENCHMARK
+    {
+        QPoint globalPos(1000 + ((step % 2 == 0) ? step % 40 : -(step % 40)), 100);
+#if defined(DOCK_COUNT_ALLOCATIONS)
+        t_allocations = 0;
+        t_isCounting = true;
+#endif
+        QMouseEvent moveEvent(QEvent::MouseMove, QPointF(0, 0), QPointF(globalPos),
+                              Qt::NoButton, Qt::LeftButton, Qt::NoModifier);
+        QApplication::sendEvent(movedHandle, &moveEvent);
+#if defined(DOCK_COUNT_ALLOCATIONS)
+        t_isCounting = false;
+        allocations = qMax(allocations, t_allocations);
+#endif
+        step++;
+    }
+    qInfo("%d children: at most %d allocations per step, widget geometry included", childCount, allocations);
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    // Shown on the offscreen platform, no display is needed
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    dock::SplitterDragBenchmark benchmark;
+    return QTest::qExec(&benchmark, argc, argv);
+}
+
+#include "tst_splitterdrag.moc"
@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += widgets
+QT       += widgets concurrent
 
 TARGET = Dock
 TEMPLATE = lib
@@ -37,7 +37,17 @@ SOURCES += \
     DockableWindow.cpp \
     Splitter.cpp \
     TabBar.cpp \
-    TabWidget.cpp
+    TabWidget.cpp \
+    DragFramePacer.cpp \
+    DropTargetIndex.cpp \
+    DropPreviewOverlay.cpp \
+    DockTree.cpp \
+    DockModel.cpp \
+    PendingWindow.cpp \
+    LayoutJournal.cpp \
+    StateStore.cpp \
+    LayoutLibrary.cpp \
+    LayoutPreset.cpp
 
 HEADERS += \
         dock_global.h \ 
@@ -49,7 +59,17 @@ HEADERS += \
     DockableWindow.h \
     Splitter.h \
     TabBar.h \
-    TabWidget.h
+    TabWidget.h \
+    DragFramePacer.h \
+    DropTargetIndex.h \
+    DropPreviewOverlay.h \
+    DockTree.h \
+    DockModel.h \
+    PendingWindow.h \
+    LayoutJournal.h \
+    StateStore.h \
+    LayoutLibrary.h \
+    LayoutPreset.h
 
 unix {
     target.path = /usr/lib
@@ -1,15 +1,23 @@
 ﻿#include <QWidget>
 #include <QEvent>
 #include <QApplication>
+#include <QWindow>
 #include <QLayout>
 #include <QMouseEvent>
 #include <QLabel>
-#include <QTabWidget>
+#include <QPointer>
 //#include <QDesktopWidget>
 #include <QMargins>
 #include <QMenu>
 #include <QSignalMapper>
-#include <QJsonArray>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+#include <QFile>
+#include <QSaveFile>
+#include <QJsonDocument>
 
 #include "DockContainer.h"
 #include "TabBar.h"
@@ -17,35 +25,36 @@
 #include "DockableWindow.h"
 #include "DockableWindowPool.h"
 #include "Splitter.h"
+#include "DragFramePacer.h"
+#include "DropTargetIndex.h"
+#include "DockTree.h"
+#include "DropPreviewOverlay.h"
 #include "WindowFactoryManager.h"
 #include "WindowFactory.h"
+#include "PendingWindow.h"
+#include "LayoutJournal.h"
+#include "StateStore.h"
+#include "LayoutLibrary.h"
+#include "LayoutPreset.h"
 
 namespace dock {
 
-const int WIDGET_MIN_SIZE = 100;
-const int ROOT_DOCKED_SIZE_HINT = 200;
 const int TEMPLATE_FORM_OPTIMUM_SIZE = 300;
 
-const QString c_strWidgetType           = "WidgetType";
-const QString c_strOrientation          = "Orientation";
-const QString c_strSize                 = "Size";
-const QString c_strSplitter             = "Splitter";
-const QString c_strTabWidget            = "TabWidget";
-const QString c_strFloatWindowChildren  = "FloatWindowChildren";
-const QString c_strSplitterChildren     = "SplitterChildren";
-const QString c_strTabWidgetChildren    = "TabWidgetChildren";
-const QString c_strWindowType           = "WindowType";
-const QString c_strWindowID             = "WindowID";
-const QString c_strWindowName           = "WindowName";
-const QString c_strMainWindow           = "MainWindow";
-const QString c_strCurrentLayoutName    = "CurrrentLayoutName";
-const QString c_strLayoutArray          = "LayoutArray";
-const QString c_strGeometry             = "Geometry";
-const QString c_strLeft                 = "Left";
-const QString c_strTop                  = "Top";
-const QString c_strWidth                = "Width";
-const QString c_strHeight               = "Height";
-const QString c_strCurrentTabIndex      = "CurrentTabIndex";
+// A built layout kept off screen; the windows it last showed are put back on restore
+struct CachedLayout
+{
+    struct TabGroup
+    {
+        QPointer<TabWidget> tabWidget;
+        QList<QPointer<QWidget>> pages;     // Dockable windows and pending tabs
+        int currentIndex;
+    };
+    QString name;
+    QWidget *rootWidget;
+    QList<QPointer<Splitter>> rootSplitters;
+    QList<TabGroup> tabGroups;
+};
 
 class DockContainerPrivate {
     Q_DECLARE_PUBLIC(DockContainer)
@@ -59,7 +68,6 @@ public:
         , sourceView(nullptr)
         , filterSwitch(true)
         , isDragging(false)
-        , templateFormOnDrag(nullptr)
         , contextMenuTabWidget(nullptr)
         , contextMenuTabIndex(-1)
         , maxmizedWindow(nullptr)
@@ -69,12 +77,32 @@ public:
         , isDisConnectAll(false)
         , dockableWindowPool(nullptr)
         , isDraggingCancelled(false)
+        , dragFramePacer(nullptr)
+        , isFramePacedDrag(true)
+        , isIncrementalLayout(true)
+        , isReconcilingLayout(false)
+        , layoutRevision(0)
+        , layoutCacheLimit(3)
+        , isLazyTabs(true)
+        , isPendingTabsQueued(false)
+        , isProgressiveRestore(false)
+        , restoreFrameBudget(8)
+        , restoreTimer(nullptr)
+        , reserveTimer(nullptr)
+        , restoreTotal(0)
+        , restoreCreated(0)
+        , journalCompactThreshold(256)
+        , journalCompactTimer(nullptr)
+        , journalSizesTimer(nullptr)
+        , stateStore(nullptr)
     {}
 
     DockContainer *q_ptr;
     QWidget *parentWidget;
     QWidget *dockRootWidget;
     QList<Splitter *> rootSplitterList;
+    // Top-level windows, the one activated last at the end
+    QList<QPointer<QWindow>> windowActivationOrder;
     QSet<QWidget *> tabBarSet;
 
     QPoint mousePressPos;
@@ -86,7 +114,9 @@ public:
     DockContainer::HoverWidgetData hoverWidgetData;
     bool filterSwitch;
     bool isDragging;
-    QTabWidget *templateFormOnDrag;
+    // Preview painted inside the hovered window, and the ghost shown outside all windows
+    QPointer<DropPreviewOverlay> dropOverlay;
+    QPointer<DropPreviewOverlay> dragGhost;
 
     TabWidget *contextMenuTabWidget;
     int contextMenuTabIndex;
@@ -99,8 +129,261 @@ public:
 
     DockableWindowPool *dockableWindowPool;
     bool isDraggingCancelled;
+
+    DragFramePacer *dragFramePacer;
+    bool isFramePacedDrag;
+
+    // Drop candidates captured in beginDragging, valid until endDragging
+    DropTargetIndex dropTargetIndex;
+
+    // Node graph of the splitters, tab widgets and windows, kept in sync by their signals
+    DockTree dockTree;
+
+    // While reconciling, the windows decided for every tab group of the target model
+    bool isIncrementalLayout;
+    bool isReconcilingLayout;
+    QHash<DockModel::NodeId, QList<DockableWindow *>> reconciledWindows;
+
+    // Fingerprint of the live layout, set when it is loaded or saved and cleared by any change to it.
+    // The revision counts the changes, so a background save only sets it if none came in between
+    QByteArray layoutFingerprint;
+    quint64 layoutRevision;
+    QHash<uint, WindowStateStats> windowStateStats;
+
+    // Hidden layouts by name, least recently used first
+    QString currentLayoutName;
+    QList<CachedLayout> layoutCache;
+    int layoutCacheLimit;
+    LayoutCacheStats layoutCacheStats;
+
+    // Tab widgets that started showing a pending tab, its window is created on the next loop
+    bool isLazyTabs;
+    bool isPendingTabsQueued;
+    QList<QPointer<TabWidget>> pendingTabWidgets;
+    // Placeholders whose async data arrived during a drag
+    QList<QPointer<PendingWindow>> preparedWindows;
+
+    // Progressive restore: windows still to create, the visible ones first
+    bool isProgressiveRestore;
+    int restoreFrameBudget;
+    QTimer *restoreTimer;
+    QList<QPointer<PendingWindow>> restoreQueue;
+    int restoreTotal;
+    int restoreCreated;
+
+    // Refills the window reserve one instance per event loop pass
+    QTimer *reserveTimer;
+
+    // Dock operations since the last layout snapshot, compacted once threshold of them piled up
+    LayoutJournal journal;
+    int journalCompactThreshold;
+    QTimer *journalCompactTimer;
+    // Journals the sizes the splitters settled on once an operation's emptied widgets are gone
+    QTimer *journalSizesTimer;
+
+    StateStore *stateStore;
+
+    // One thread, so saves of the same file land in order
+    QThreadPool saveThreadPool;
+    LayoutSaveStats layoutSaveStats;
+};
+
+static WindowFactory *asyncFactory(uint type)
+{
+    WindowFactory *factory = WindowFactoryManager::getInstance()->getFactory(type);
+    return (factory != nullptr && factory->isAsync()) ? factory : nullptr;
+}
+
+// Where a tab group or splitter of the live layout is, as LayoutJournal records it
+static bool journalLocation(DockContainerPrivate *d, QWidget *node, LayoutJournal::Location &location)
+{
+    if (!d->journal.isOpen() || node == nullptr)
+    {
+        return false;
+    }
+    location.path.clear();
+    QWidget *child = node;
+    Splitter *parent = d->dockTree.parentSplitter(child);
+    while (parent != nullptr)
+    {
+        location.path.prepend(parent->indexOf(child));
+        child = parent;
+        parent = d->dockTree.parentSplitter(child);
+    }
+    location.window = d->rootSplitterList.indexOf(qobject_cast<Splitter *>(child));
+    return location.window >= 0;
+}
+
+// Dock operations, resizes and window states marked dirty; the main window size, the positions of
+// floating windows and the current tabs do not count, loading the layout again would not change them
+static void markLayoutChanged(DockContainerPrivate *d)
+{
+    d->layoutFingerprint.clear();
+    d->layoutRevision++;
+}
+
+// The child count and sizes of every splitter below splitter, depth first, as LayoutJournal::SIZES holds them
+static void collectJournalSizes(Splitter *splitter, QList<int> &sizes)
+{
+    QList<int> childSizes = splitter->sizes();
+    sizes.append(childSizes.size());
+    sizes.append(childSizes);
+    for (int i = 0; i < splitter->widgetCount(); i++)
+    {
+        Splitter *child = qobject_cast<Splitter *>(splitter->widget(i));
+        if (child != nullptr)
+        {
+            collectJournalSizes(child, sizes);
+        }
+    }
+}
+
+static void appendJournal(DockContainerPrivate *d, const LayoutJournal::Record &record)
+{
+    d->journal.append(record);
+    // Replay places the tab with placeholder sizes, the widgets' own follow in a SIZES record
+    bool isStructural = record.operation == LayoutJournal::TAB || record.operation == LayoutJournal::DOCK
+        || record.operation == LayoutJournal::FLOAT || record.operation == LayoutJournal::CLOSE;
+    if (isStructural && !d->journalSizesTimer->isActive())
+    {
+        d->journalSizesTimer->start(0);
+    }
+    // Compacted from the event loop, when the tab widgets an operation emptied are gone
+    if (d->journal.recordCount() >= d->journalCompactThreshold && !d->journalCompactTimer->isActive())
+    {
+        d->journalCompactTimer->start();
+    }
+}
+
+// What a background save hands back to the GUI thread
+struct BackgroundSaveResult
+{
+    bool isWritten;
+    bool isSkipped;
+    QByteArray fingerprint;
+    qint64 nsecs;
+    BackgroundSaveResult() : isWritten(false), isSkipped(false), nsecs(0) {}
 };
 
+// The fingerprint in the header of the layout file there is, read on the save thread
+static QByteArray savedLayoutFingerprint(const QString &fileName, DockContainer::LayoutFormat format)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return QByteArray();
+    }
+    QByteArray data = DockContainer::uncompressLayout(file.readAll());
+    if (format == DockContainer::CBOR_LAYOUT)
+    {
+        return DockModel::fingerprintFromCbor(data);
+    }
+    return DockModel::fingerprintFromJson(QJsonDocument::fromJson(data).object());
+}
+
+// Runs on the save thread: the model is its own copy and the store is only appended to
+static BackgroundSaveResult writeLayoutFile(DockModel model, const QString &fileName, DockContainer::LayoutFormat format,
+                                            bool isCompressed, StateStore *store)
+{
+    QElapsedTimer timer;
+    timer.start();
+    BackgroundSaveResult result;
+    result.fingerprint = model.fingerprint();
+    if (result.fingerprint == savedLayoutFingerprint(fileName, format))
+    {
+        result.isSkipped = true;
+        result.nsecs = timer.nsecsElapsed();
+        return result;
+    }
+    if (store != nullptr)
+    {
+        model.moveStatesTo(*store);
+    }
+    QByteArray data;
+    if (format == DockContainer::CBOR_LAYOUT)
+    {
+        data = model.toCbor(result.fingerprint);
+    }
+    else
+    {
+        QJsonObject jsonObj;
+        model.toJson(jsonObj, result.fingerprint);
+        data = QJsonDocument(jsonObj).toJson();
+    }
+    if (isCompressed)
+    {
+        data = qCompress(data);
+    }
+    QSaveFile file(fileName);
+    result.isWritten = file.open(QIODevice::WriteOnly) && file.write(data) == data.size() && file.commit();
+    result.nsecs = timer.nsecsElapsed();
+    return result;
+}
+
+// The same into a layout library, which nothing else touches until the save is done
+static BackgroundSaveResult writeLibraryLayout(DockModel model, LayoutLibrary *library, const QString &layoutName,
+                                               StateStore *store)
+{
+    QElapsedTimer timer;
+    timer.start();
+    BackgroundSaveResult result;
+    result.fingerprint = model.fingerprint();
+    if (result.fingerprint == library->layoutFingerprint(layoutName))
+    {
+        result.isSkipped = true;
+        result.nsecs = timer.nsecsElapsed();
+        return result;
+    }
+    if (store != nullptr)
+    {
+        model.moveStatesTo(*store);
+    }
+    result.isWritten = library->setLayout(layoutName, model.toCbor(result.fingerprint), result.fingerprint);
+    result.nsecs = timer.nsecsElapsed();
+    return result;
+}
+
+// Back on the GUI thread: the statistics, the live fingerprint unless the layout changed meanwhile, the signal
+static void watchBackgroundSave(DockContainer *q, DockContainerPrivate *d, const QFuture<BackgroundSaveResult> &future,
+                                const QString &name, quint64 revision)
+{
+    QFutureWatcher<BackgroundSaveResult> *watcher = new QFutureWatcher<BackgroundSaveResult>(q);
+    QObject::connect(watcher, &QFutureWatcher<BackgroundSaveResult>::finished, q, [q, d, watcher, name, revision]() {
+        BackgroundSaveResult result = watcher->result();
+        watcher->deleteLater();
+        if (revision == d->layoutRevision)
+        {
+            d->layoutFingerprint = result.fingerprint;
+        }
+        d->layoutSaveStats.lastWriteNsecs = result.nsecs;
+        if (result.isSkipped)
+        {
+            d->layoutSaveStats.skipped++;
+        }
+        else if (result.isWritten)
+        {
+            d->layoutSaveStats.saves++;
+        }
+        else
+        {
+            d->layoutSaveStats.failures++;
+        }
+        emit q->layoutSaved(name, result.isWritten);
+    });
+    watcher->setFuture(future);
+}
+
+static QString pageTitle(QWidget *page)
+{
+    DockableWindow *dockableWindow = qobject_cast<DockableWindow *>(page);
+    if (dockableWindow != nullptr)
+    {
+        return dockableWindow->getTitle();
+    }
+    PendingWindow *pending = qobject_cast<PendingWindow *>(page);
+    return (pending != nullptr) ? pending->getTitle() : QString();
+}
+
 DockContainer::DockContainer(QWidget *parent)
     : QObject(parent)
     , d_ptr(new DockContainerPrivate(this))
@@ -113,6 +396,25 @@ DockContainer::DockContainer(QWidget *parent)
     laytout->setSpacing(0);
     laytout->setContentsMargins(0, 0, 0, 0);
     d->dockableWindowPool = new DockableWindowPool();
+    d->dragFramePacer = new DragFramePacer(this);
+    connect(d->dragFramePacer, &DragFramePacer::moveReady, this, &DockContainer::onDragMoveReady);
+    d->restoreTimer = new QTimer(this);
+    d->restoreTimer->setSingleShot(true);
+    connect(d->restoreTimer, &QTimer::timeout, this, &DockContainer::onRestoreTimeout);
+    d->reserveTimer = new QTimer(this);
+    d->reserveTimer->setSingleShot(true);
+    connect(d->reserveTimer, &QTimer::timeout, this, &DockContainer::onReserveTimeout);
+    QTimer *reserveTimer = d->reserveTimer;
+    d->dockableWindowPool->setReserveTakenCallback([reserveTimer]() { reserveTimer->start(0); });
+    d->journalCompactTimer = new QTimer(this);
+    d->journalCompactTimer->setSingleShot(true);
+    d->journalCompactTimer->setInterval(1000);
+    connect(d->journalCompactTimer, &QTimer::timeout, this, &DockContainer::compactJournal);
+    d->journalSizesTimer = new QTimer(this);
+    d->journalSizesTimer->setSingleShot(true);
+    connect(d->journalSizesTimer, &QTimer::timeout, this, &DockContainer::onJournalSizesTimeout);
+    d->saveThreadPool.setMaxThreadCount(1);
+    connect(qApp, &QGuiApplication::focusWindowChanged, this, &DockContainer::onFocusWindowChanged);
     initLayout();
 }
 
@@ -120,289 +422,1275 @@ DockContainer::~DockContainer()
 {
     Q_D(DockContainer);
     d->isDisConnectAll = true;
+    delete d->dropOverlay;
+    delete d->dragGhost;
+    d->saveThreadPool.waitForDone();
+    d->dockableWindowPool->clearReserve();
     delete d_ptr;
 }
 
-void DockContainer::saveLayoutToJson(QJsonObject &jsonObj)
+bool DockContainer::saveLayoutToJson(QJsonObject &jsonObj, const QByteArray &savedFingerprint)
+{
+    Q_D(DockContainer);
+    DockModel model;
+    saveLayoutToModel(model);
+    QByteArray fingerprint = model.fingerprint();
+    d->layoutFingerprint = fingerprint;
+    if (fingerprint == savedFingerprint)
+    {
+        return false;
+    }
+    if (d->stateStore != nullptr)
+    {
+        model.moveStatesTo(*d->stateStore);
+    }
+    model.toJson(jsonObj, fingerprint);
+    return true;
+}
+
+void DockContainer::createLayoutFromJson(const QJsonObject &jsonObj)
+{
+    Q_D(DockContainer);
+    QByteArray fingerprint = DockModel::fingerprintFromJson(jsonObj);
+    if (isLiveLayout(fingerprint))
+    {
+        return;
+    }
+    DockModel model;
+    model.fromJson(jsonObj);
+    createLayoutFromModel(model);
+    d->layoutFingerprint = fingerprint;
+}
+
+bool DockContainer::saveLayoutToCbor(QByteArray &data, const QByteArray &savedFingerprint)
+{
+    Q_D(DockContainer);
+    DockModel model;
+    saveLayoutToModel(model);
+    QByteArray fingerprint = model.fingerprint();
+    d->layoutFingerprint = fingerprint;
+    if (fingerprint == savedFingerprint)
+    {
+        return false;
+    }
+    if (d->stateStore != nullptr)
+    {
+        model.moveStatesTo(*d->stateStore);
+    }
+    data = model.toCbor(fingerprint);
+    return true;
+}
+
+void DockContainer::saveLayoutInBackground(const QString &fileName, LayoutFormat format, bool isCompressed)
+{
+    Q_D(DockContainer);
+    // The widgets are only read here, window states included; everything else is the worker's
+    QElapsedTimer timer;
+    timer.start();
+    DockModel model;
+    saveLayoutToModel(model);
+    quint64 revision = d->layoutRevision;
+    QFuture<BackgroundSaveResult> future = QtConcurrent::run(&d->saveThreadPool, writeLayoutFile, model, fileName,
+                                                             format, isCompressed, d->stateStore);
+    d->layoutSaveStats.lastBlockedNsecs = timer.nsecsElapsed();
+    d->layoutSaveStats.maxBlockedNsecs = qMax(d->layoutSaveStats.maxBlockedNsecs, d->layoutSaveStats.lastBlockedNsecs);
+    watchBackgroundSave(this, d, future, fileName, revision);
+}
+
+void DockContainer::saveLayoutToLibraryInBackground(LayoutLibrary &library, const QString &layoutName)
+{
+    Q_D(DockContainer);
+    QElapsedTimer timer;
+    timer.start();
+    DockModel model;
+    saveLayoutToModel(model);
+    quint64 revision = d->layoutRevision;
+    QFuture<BackgroundSaveResult> future = QtConcurrent::run(&d->saveThreadPool, writeLibraryLayout, model, &library,
+                                                             layoutName, d->stateStore);
+    d->layoutSaveStats.lastBlockedNsecs = timer.nsecsElapsed();
+    d->layoutSaveStats.maxBlockedNsecs = qMax(d->layoutSaveStats.maxBlockedNsecs, d->layoutSaveStats.lastBlockedNsecs);
+    watchBackgroundSave(this, d, future, layoutName, revision);
+}
+
+void DockContainer::waitForBackgroundSaves()
+{
+    Q_D(DockContainer);
+    d->saveThreadPool.waitForDone();
+}
+
+LayoutSaveStats DockContainer::layoutSaveStats() const
+{
+    Q_D(const DockContainer);
+    return d->layoutSaveStats;
+}
+
+QByteArray DockContainer::uncompressLayout(const QByteArray &data)
+{
+    // qCompress puts the size in 4 bytes before a zlib stream, whose 2 byte header is a
+    // multiple of 31; json starts with '{' and the CBOR layout with its tag, neither matches
+    if (data.size() > 6 && (uchar)data.at(4) == 0x78 && (((uchar)data.at(4) << 8) | (uchar)data.at(5)) % 31 == 0
+        && data.at(0) != '{' && (uchar)data.at(0) != 0xda)
+    {
+        QByteArray uncompressed = qUncompress(data);
+        if (!uncompressed.isEmpty())
+        {
+            return uncompressed;
+        }
+    }
+    return data;
+}
+
+bool DockContainer::createLayoutFromCbor(const QByteArray &data)
+{
+    Q_D(DockContainer);
+    QByteArray fingerprint = DockModel::fingerprintFromCbor(data);
+    if (isLiveLayout(fingerprint))
+    {
+        return true;
+    }
+    DockModel model;
+    if (!model.fromCbor(data))
+    {
+        return false;
+    }
+    createLayoutFromModel(model);
+    d->layoutFingerprint = fingerprint;
+    return true;
+}
+
+QByteArray DockContainer::layoutFingerprint()
+{
+    Q_D(DockContainer);
+    if (d->layoutFingerprint.isEmpty())
+    {
+        DockModel model;
+        saveLayoutToModel(model);
+        d->layoutFingerprint = model.fingerprint();
+    }
+    return d->layoutFingerprint;
+}
+
+void DockContainer::setStateStore(StateStore *store)
+{
+    Q_D(DockContainer);
+    d->stateStore = store;
+    d->dockableWindowPool->setStateStore(store);
+}
+
+StateStore *DockContainer::stateStore() const
+{
+    Q_D(const DockContainer);
+    return d->stateStore;
+}
+
+bool DockContainer::isLiveLayout(const QByteArray &fingerprint)
+{
+    Q_D(DockContainer);
+    // The cached fingerprint alone: no snapshot, no window asked for its state
+    return !fingerprint.isEmpty() && fingerprint == d->layoutFingerprint;
+}
+
+void DockContainer::createLayoutFromJson(const QJsonObject &jsonObj, const QString &layoutName)
+{
+    Q_D(DockContainer);
+    // A cached copy of this name is out of date once it is built again
+    for (int i = 0; i < d->layoutCache.size(); i++)
+    {
+        if (d->layoutCache[i].name == layoutName)
+        {
+            evictCachedLayout(i);
+            break;
+        }
+    }
+    if (isLiveLayout(DockModel::fingerprintFromJson(jsonObj)))
+    {
+        d->currentLayoutName = layoutName;
+        return;
+    }
+    stashCurrentLayout();
+    createLayoutFromJson(jsonObj);
+    d->currentLayoutName = layoutName;
+}
+
+bool DockContainer::createLayoutFromCbor(const QByteArray &data, const QString &layoutName)
+{
+    Q_D(DockContainer);
+    for (int i = 0; i < d->layoutCache.size(); i++)
+    {
+        if (d->layoutCache[i].name == layoutName)
+        {
+            evictCachedLayout(i);
+            break;
+        }
+    }
+    QByteArray fingerprint = DockModel::fingerprintFromCbor(data);
+    if (isLiveLayout(fingerprint))
+    {
+        d->currentLayoutName = layoutName;
+        return true;
+    }
+    DockModel model;
+    if (!model.fromCbor(data))
+    {
+        return false;
+    }
+    stashCurrentLayout();
+    createLayoutFromModel(model);
+    d->layoutFingerprint = fingerprint;
+    d->currentLayoutName = layoutName;
+    return true;
+}
+
+bool DockContainer::saveLayoutToLibrary(LayoutLibrary &library, const QString &layoutName)
+{
+    Q_D(DockContainer);
+    QByteArray data;
+    if (!saveLayoutToCbor(data, library.layoutFingerprint(layoutName)))
+    {
+        return library.contains(layoutName);
+    }
+    return library.setLayout(layoutName, data, d->layoutFingerprint);
+}
+
+bool DockContainer::createLayoutFromLibrary(const LayoutLibrary &library, const QString &layoutName)
+{
+    Q_D(DockContainer);
+    // The index has the fingerprint, a live layout is not even read
+    if (isLiveLayout(library.layoutFingerprint(layoutName)))
+    {
+        d->currentLayoutName = layoutName;
+        return true;
+    }
+    QByteArray data = library.layout(layoutName);
+    return !data.isEmpty() && createLayoutFromCbor(data, layoutName);
+}
+
+bool DockContainer::switchToCachedLayout(const QString &layoutName)
+{
+    Q_D(DockContainer);
+    if (!layoutName.isEmpty() && layoutName == d->currentLayoutName)
+    {
+        d->layoutCacheStats.hits++;
+        return true;
+    }
+    int index = -1;
+    for (int i = 0; i < d->layoutCache.size(); i++)
+    {
+        if (d->layoutCache[i].name == layoutName)
+        {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0 || d->isDragging)
+    {
+        d->layoutCacheStats.misses++;
+        return false;
+    }
+    d->layoutCacheStats.hits++;
+    // Move the entry to the back first so stashing the current layout cannot evict it
+    d->layoutCache.move(index, d->layoutCache.size() - 1);
+    if (!stashCurrentLayout())
+    {
+        releaseCurrentLayout();
+    }
+    restoreCachedLayout(d->layoutCache.size() - 1);
+    d->currentLayoutName = layoutName;
+    return true;
+}
+
+void DockContainer::saveLayoutToModel(DockModel &model)
+{
+    Q_D(DockContainer);
+    model.clear();
+    d->windowStateStats.clear();
+    for (int i = 0; i < d->rootSplitterList.size(); i++)
+    {
+        Splitter *rootSplitter = d->rootSplitterList[i];
+        DockModel::NodeId rootId = saveSplitterToModel(rootSplitter, model);
+        QWidget *floatWindow = rootSplitter->parentWidget();
+        model.addWindow(rootId, floatWindow != nullptr ? floatWindow->geometry() : QRect());
+    }
+}
+
+QHash<uint, WindowStateStats> DockContainer::windowStateStats() const
+{
+    Q_D(const DockContainer);
+    return d->windowStateStats;
+}
+
+void DockContainer::createLayoutFromModel(const DockModel &model)
+{
+    Q_D(DockContainer);
+    d->currentLayoutName.clear();
+    d->layoutFingerprint.clear();
+    // Saving leaves a maximized tab alone, replacing the layout puts it back first
+    if (d->maxmizedWindow != nullptr)
+    {
+        onTabMaxmized();
+    }
+    if (d->isIncrementalLayout && canReconcileLayout(model))
+    {
+        reconcileLayout(model);
+    }
+    else
+    {
+        buildLayoutFromModel(model);
+    }
+    if (d->isProgressiveRestore)
+    {
+        scheduleProgressiveRestore();
+    }
+    // Only now are the windows the new layout took back out of the hidden set
+    d->dockableWindowPool->trimHiddenWindows();
+    // Records of the previous layout would not replay on this one
+    compactJournal();
+}
+
+void DockContainer::buildLayoutFromModel(const DockModel &model)
+{
+    Q_D(DockContainer);
+    releaseCurrentLayout();
+    d->dockRootWidget = new QWidget();
+    d->dockRootWidget->setObjectName("DockRootWidget");
+
+    if (model.isEmpty())
+    {
+        return;
+    }
+    d->parentWidget->layout()->addWidget(d->dockRootWidget);
+
+    QHBoxLayout* carrierlaytout = new QHBoxLayout(d->dockRootWidget);
+    carrierlaytout->setSpacing(0);
+    carrierlaytout->setContentsMargins(0, 0, 0, 0);
+    Splitter *mainRootSplitter = createSplitterFromModel(model, model.window(0).rootSplitter);
+    connect(mainRootSplitter, &Splitter::destroyed, this, &DockContainer::onSplitterDestroyed);
+    carrierlaytout->addWidget(mainRootSplitter);
+    d->rootSplitterList.append(mainRootSplitter);
+    d->dockTree.addRoot(mainRootSplitter, d->parentWidget);
+
+    for (int i = 1; i < model.windowCount(); i++)
+    {
+        createFloatWindowFromModel(model, i);
+    }
+}
+
+void DockContainer::createFloatWindowFromModel(const DockModel &model, int windowIndex)
+{
+    Q_D(DockContainer);
+    Splitter *floatRootSplitter = createSplitterFromModel(model, model.window(windowIndex).rootSplitter);
+    d->rootSplitterList.append(floatRootSplitter);
+    d->dockTree.addRoot(floatRootSplitter, nullptr);
+
+    QHBoxLayout *layout = new QHBoxLayout();
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->setSpacing(0);
+    layout->addWidget(floatRootSplitter);
+
+    QWidget *floatWindow = new QWidget(d->dockRootWidget);
+    floatWindow->setAttribute(Qt::WA_DeleteOnClose);
+    floatWindow->setLayout(layout);
+    floatWindow->setWindowFlags(Qt::Window);
+    floatWindow->show();
+
+    relocateFloatWindowGeometry(floatWindow, model.window(windowIndex).geometry);
+    connect(floatWindow, &QWidget::destroyed, this, &DockContainer::onFloatWindowDestroyed);
+    connect(floatRootSplitter, &Splitter::destroyed, this, &DockContainer::onSplitterDestroyed);
+    connect(floatRootSplitter, &Splitter::destroyed, floatWindow, &QWidget::deleteLater);
+}
+
+inline Splitter *DockContainer::createSplitterWidget()
+{
+    Q_D(DockContainer);
+    Splitter *splitter = new Splitter();
+    splitter->setOpaqueResize(false);
+    splitter->setFramePacedResize(d->isFramePacedDrag);
+    d->dockTree.addSplitter(splitter);
+    connect(splitter, &Splitter::widgetInserted, this, &DockContainer::onSplitterWidgetInserted);
+    connect(splitter, &Splitter::widgetRemoved, this, &DockContainer::onSplitterWidgetRemoved);
+    connect(splitter, &Splitter::handleReleased, this, &DockContainer::onSplitterHandleReleased);
+    connect(splitter, &Splitter::destroyed, this, &DockContainer::onDockNodeDestroyed);
+    return splitter;
+}
+
+DockModel::NodeId DockContainer::saveSplitterToModel(Splitter *splitter, DockModel &model)
+{
+    DockModel::NodeId id = model.createSplitter(splitter->orientation());
+    model.setGeometry(id, splitter->geometry());
+    for (int i = 0; i < splitter->widgetCount(); i++)
+    {
+        QWidget *widget = splitter->widget(i);
+        DockModel::NodeId childId = DockModel::INVALID_NODE;
+        if (qobject_cast<Splitter *>(widget) != nullptr)
+        {
+            childId = saveSplitterToModel(qobject_cast<Splitter *>(widget), model);
+        }
+        else if (qobject_cast<TabWidget *>(widget) != nullptr)
+        {
+            childId = saveTabWidgetToModel(qobject_cast<TabWidget *>(widget), model);
+        }
+        if (childId == DockModel::INVALID_NODE)
+        {
+            continue;
+        }
+        int size = (splitter->orientation() == Qt::Horizontal) ? widget->width() : widget->height();
+        model.appendChild(id, childId, size);
+    }
+    return id;
+}
+
+Splitter *DockContainer::createSplitterFromModel(const DockModel &model, DockModel::NodeId id)
+{
+    const DockModel::Node &node = model.node(id);
+    Splitter *splitter = createSplitterWidget();
+    splitter->setOrientation(node.orientation);
+    splitter->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+    QList<int> sizes;
+    for (int i = 0; i < node.children.size(); i++)
+    {
+        DockModel::NodeId childId = node.children[i];
+        if (model.node(childId).kind == DockModel::SPLITTER)
+        {
+            Splitter *childSplitter = createSplitterFromModel(model, childId);
+            splitter->addWidget(childSplitter);
+        }
+        else
+        {
+            TabWidget *tabWidget = createTabWidgetFromModel(model, childId);
+            splitter->addWidget(tabWidget);
+        }
+        sizes.append(node.sizes[i]);
+    }
+    splitter->updateSizes(sizes);
+    return splitter;
+}
+
+DockModel::NodeId DockContainer::saveTabWidgetToModel(TabWidget *tabWidget, DockModel &model)
+{
+    Q_D(DockContainer);
+    DockModel::NodeId id = model.createTabGroup();
+    model.setGeometry(id, tabWidget->geometry());
+    QList<QWidget *> pages;
+    for (int i = 0; i < tabWidget->widgetCount(); i++)
+    {
+        pages.append(tabWidget->widget(i));
+    }
+    // A maximized window is saved where it came from, the user's tab stays maximized
+    if (tabWidget == d->maxmizedWindowSourceTabWidget && d->maxmizedWindow != nullptr)
+    {
+        pages.insert(qBound(0, d->maxmizedWindowSourceTabIndex, pages.size()), d->maxmizedWindow);
+    }
+    for (int i = 0; i < pages.size(); i++)
+    {
+        PendingWindow *pending = qobject_cast<PendingWindow *>(pages.at(i));
+        if (pending != nullptr)
+        {
+            // Its saved id may belong to another window by now
+            DockModel::Tab tab = pending->tab();
+            tab.windowId = -1;
+            model.addTab(id, tab);
+            continue;
+        }
+        DockableWindow *dockableWindow = qobject_cast<DockableWindow*>(pages.at(i));
+        if (dockableWindow == nullptr)
+        {
+            continue;
+        }
+        DockModel::Tab tab;
+        tab.windowType = dockableWindow->windowType();
+        tab.windowId = d->dockableWindowPool->windowID(dockableWindow);
+        WindowStateStats &stats = d->windowStateStats[tab.windowType];
+        bool isReused = false;
+        QElapsedTimer timer;
+        timer.start();
+        tab.state = dockableWindow->savedState(&isReused);
+        if (isReused)
+        {
+            stats.reused++;
+        }
+        else
+        {
+            stats.serialized++;
+            stats.nsecs += timer.nsecsElapsed();
+        }
+        if (dockableWindow->tracksStateChanges())
+        {
+            tab.stateHash = dockableWindow->savedStateHash();
+        }
+        model.addTab(id, tab);
+    }
+    model.setCurrentTab(id, tabWidget->tabBar()->currentIndex());
+    return id;
+}
+
+TabWidget *DockContainer::createTabWidgetFromModel(const DockModel &model, DockModel::NodeId id)
+{
+    Q_D(DockContainer);
+    const DockModel::Node &node = model.node(id);
+    TabWidget *tabWidget = createTabWidget();
+    for (int i = 0; i < node.tabs.size(); i++)
+    {
+        const DockModel::Tab &tab = node.tabs[i];
+        bool isPending = isDeferredTab(node, i);
+        DockableWindow *dockableWindow = nullptr;
+        if (d->isReconcilingLayout)
+        {
+            dockableWindow = d->reconciledWindows.value(id).value(i, nullptr);
+        }
+        else if (!isPending)
+        {
+            dockableWindow = acquireWindow(tab);
+        }
+        addTabFromModel(tabWidget, tab, dockableWindow, isPending);
+    }
+    tabWidget->setCurrentTabIndex(node.currentIndex);
+    return tabWidget;
+}
+
+bool DockContainer::isDeferredTab(const DockModel::Node &node, int tabIndex)
+{
+    Q_D(DockContainer);
+    if (asyncFactory(node.tabs[tabIndex].windowType) != nullptr)
+    {
+        return true;
+    }
+    return d->isProgressiveRestore || (d->isLazyTabs && tabIndex != node.currentIndex);
+}
+
+void DockContainer::scheduleProgressiveRestore()
+{
+    Q_D(DockContainer);
+    // Shown pages of the main window, then of the floating windows, then background tabs unless lazy
+    QList<QPointer<PendingWindow>> shown;
+    QList<QPointer<PendingWindow>> background;
+    for (int i = 0; i < d->rootSplitterList.size(); i++)
+    {
+        QList<TabWidget *> tabWidgets;
+        collectTabWidgets(d->rootSplitterList[i], tabWidgets);
+        for (int t = 0; t < tabWidgets.size(); t++)
+        {
+            for (int k = 0; k < tabWidgets[t]->widgetCount(); k++)
+            {
+                PendingWindow *pending = qobject_cast<PendingWindow *>(tabWidgets[t]->widget(k));
+                if (pending == nullptr)
+                {
+                    continue;
+                }
+                if (tabWidgets[t]->currentWidget() == pending)
+                {
+                    shown.append(pending);
+                }
+                else if (!d->isLazyTabs)
+                {
+                    background.append(pending);
+                }
+            }
+        }
+    }
+    // Building showed the pending pages, their activation would undo the slicing
+    d->pendingTabWidgets.clear();
+    d->restoreQueue = shown + background;
+    d->restoreTotal = d->restoreQueue.size();
+    d->restoreCreated = 0;
+    d->restoreTimer->start(0);
+}
+
+void DockContainer::addTabFromModel(TabWidget *tabWidget, const DockModel::Tab &tab, DockableWindow *window, bool isPending)
+{
+    if (window != nullptr)
+    {
+        loadWindow(window, tab);
+        tabWidget->addTab(window, window->getTitle());
+    }
+    else if (isPending)
+    {
+        PendingWindow *pending = createPendingPage(tab);
+        tabWidget->addTab(pending, pending->getTitle());
+    }
+}
+
+PendingWindow *DockContainer::createPendingPage(const DockModel::Tab &tab)
+{
+    PendingWindow *pending = new PendingWindow(tab);
+    connect(pending, &PendingWindow::prepared, this, &DockContainer::onPendingWindowPrepared);
+    return pending;
+}
+
+DockableWindow *DockContainer::createPendingWindow(PendingWindow *pending)
+{
+    Q_D(DockContainer);
+    TabWidget *tabWidget = getParentTabWidget(pending);
+    if (tabWidget == nullptr)
+    {
+        return nullptr;
+    }
+    int index = -1;
+    for (int i = 0; i < tabWidget->widgetCount(); i++)
+    {
+        if (tabWidget->widget(i) == pending)
+        {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0)
+    {
+        return nullptr;
+    }
+    const DockModel::Tab &tab = pending->tab();
+    WindowFactory *factory = asyncFactory(tab.windowType);
+    if (factory != nullptr && !pending->isPrepared())
+    {
+        // Back through onPendingWindowPrepared, the placeholder stays shown meanwhile
+        pending->startPrepare(factory, tabState(tab));
+        return nullptr;
+    }
+    DockableWindow *window = nullptr;
+    if (tab.windowId >= 0)
+    {
+        window = d->dockableWindowPool->getHiddenWindow(tab.windowType, tab.windowId);
+    }
+    if (window == nullptr)
+    {
+        window = d->dockableWindowPool->newWindow(tab.windowType);
+    }
+    if (window == nullptr)
+    {
+        return nullptr;
+    }
+    if (pending->isPrepared())
+    {
+        // The prepared data replaces load, only the container setup of loadWindow is wanted
+        loadWindow(window, DockModel::Tab());
+        window->attach(pending->preparedData());
+    }
+    else
+    {
+        loadWindow(window, tab);
+    }
+    bool isCurrent = (tabWidget->currentWidget() == pending);
+    tabWidget->removeOnlyWidget(pending);
+    tabWidget->insertOnlyWidget(index, window);
+    tabWidget->tabBar()->setTabText(index, window->getTitle());
+    if (isCurrent)
+    {
+        tabWidget->setCurrentWidget(window);
+    }
+    pending->deleteLater();
+    return window;
+}
+
+PendingWindow *DockContainer::findPendingWindow(uint type)
+{
+    Q_D(DockContainer);
+    for (auto iter = d->tabBarSet.begin(); iter != d->tabBarSet.end(); iter++)
+    {
+        TabWidget *tabWidget = qobject_cast<TabWidget *>((*iter)->parentWidget());
+        if (tabWidget == nullptr)
+        {
+            continue;
+        }
+        for (int i = 0; i < tabWidget->widgetCount(); i++)
+        {
+            PendingWindow *pending = qobject_cast<PendingWindow *>(tabWidget->widget(i));
+            if (pending != nullptr && pending->windowType() == type)
+            {
+                return pending;
+            }
+        }
+    }
+    return nullptr;
+}
+
+void DockContainer::clearTabWidget(TabWidget *tabWidget)
+{
+    while (tabWidget->widgetCount() > 0)
+    {
+        QWidget *page = tabWidget->removeTabAndWidget(0);
+        if (qobject_cast<PendingWindow *>(page) != nullptr)
+        {
+            delete page;
+        }
+    }
+    while (tabWidget->tabBar()->count() > 0)
+    {
+        tabWidget->removeOnlyTab(0);
+    }
+}
+
+DockableWindow *DockContainer::acquireWindow(const DockModel::Tab &tab)
+{
+    Q_D(DockContainer);
+    if (tab.windowId < 0)
+    {
+        return d->dockableWindowPool->newWindow(tab.windowType);
+    }
+    return d->dockableWindowPool->getWindow(tab.windowType, tab.windowId);
+}
+
+void DockContainer::loadWindow(DockableWindow *window, const DockModel::Tab &tab)
+{
+    Q_D(DockContainer);
+    QJsonObject state = tabState(tab);
+    if (!state.isEmpty())
+    {
+        window->load(state);
+    }
+    window->setMinimumSize(DockModel::WIDGET_MIN_SIZE, DockModel::WIDGET_MIN_SIZE);
+    window->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+    connect(window, &DockableWindow::destroyed, this, &DockContainer::onDockableWindowDestroyed, Qt::UniqueConnection);
+    connect(window, &DockableWindow::stateMarkedDirty, this, &DockContainer::onWindowStateMarkedDirty, Qt::UniqueConnection);
+    d->dockableWindowPool->windowReady(window);
+}
+
+QJsonObject DockContainer::tabState(const DockModel::Tab &tab) const
+{
+    Q_D(const DockContainer);
+    if (!tab.state.isEmpty() || tab.stateRef.isEmpty() || d->stateStore == nullptr)
+    {
+        return tab.state;
+    }
+    return d->stateStore->get(tab.stateRef);
+}
+
+bool DockContainer::canReconcileLayout(const DockModel &model)
+{
+    Q_D(DockContainer);
+    if (model.isEmpty() || d->rootSplitterList.isEmpty() || d->dockRootWidget == nullptr)
+    {
+        return false;
+    }
+    if (d->isDragging || d->maxmizedWindow != nullptr)
+    {
+        return false;
+    }
+    return d->parentWidget->layout()->indexOf(d->dockRootWidget) >= 0;
+}
+
+void DockContainer::reconcileLayout(const DockModel &model)
+{
+    Q_D(DockContainer);
+    // Pair target nodes with live widgets of the same kind at the same position
+    QHash<DockModel::NodeId, QWidget *> matched;
+    int oldWindowCount = d->rootSplitterList.size();
+    int reusedWindowCount = std::min<int>(model.windowCount(), d->rootSplitterList.size());
+    for (int i = 0; i < reusedWindowCount; i++)
+    {
+        matchLayoutNode(d->rootSplitterList[i], model, model.window(i).rootSplitter, matched);
+    }
+
+    QList<DockableWindow *> placedWindows;
+    for (int i = 0; i < d->rootSplitterList.size(); i++)
+    {
+        collectPlacedWindows(d->rootSplitterList[i], placedWindows);
+    }
+
+    // A window stays where it is when the matched tab widget shows the same type at the same index
+    QSet<DockableWindow *> claimedWindows;
+    QList<DockModel::NodeId> tabGroups = model.tabGroups();
+    d->reconciledWindows.clear();
+    for (int g = 0; g < tabGroups.size(); g++)
+    {
+        DockModel::NodeId id = tabGroups[g];
+        const DockModel::Node &node = model.node(id);
+        QList<DockableWindow *> windows;
+        TabWidget *tabWidget = qobject_cast<TabWidget *>(matched.value(id, nullptr));
+        for (int k = 0; k < node.tabs.size(); k++)
+        {
+            DockableWindow *w = nullptr;
+            if (tabWidget != nullptr)
+            {
+                w = qobject_cast<DockableWindow *>(tabWidget->widget(k));
+            }
+            if (w != nullptr && (uint)w->windowType() == node.tabs[k].windowType && !claimedWindows.contains(w))
+            {
+                claimedWindows.insert(w);
+            }
+            else
+            {
+                w = nullptr;
+            }
+            windows.append(w);
+        }
+        d->reconciledWindows.insert(id, windows);
+    }
+
+    // Other tabs take a displaced window of their type, then a pooled or new one
+    for (int g = 0; g < tabGroups.size(); g++)
+    {
+        DockModel::NodeId id = tabGroups[g];
+        const DockModel::Node &node = model.node(id);
+        QList<DockableWindow *> &windows = d->reconciledWindows[id];
+        for (int k = 0; k < node.tabs.size(); k++)
+        {
+            if (windows[k] != nullptr)
+            {
+                continue;
+            }
+            const DockModel::Tab &tab = node.tabs[k];
+            DockableWindow *candidate = nullptr;
+            for (int p = 0; p < placedWindows.size(); p++)
+            {
+                DockableWindow *w = placedWindows[p];
+                if (claimedWindows.contains(w) || (uint)w->windowType() != tab.windowType)
+                {
+                    continue;
+                }
+                if (tab.windowId < 0 || d->dockableWindowPool->windowID(w) == tab.windowId)
+                {
+                    candidate = w;
+                    break;
+                }
+                if (candidate == nullptr)
+                {
+                    candidate = w;
+                }
+            }
+            if (candidate == nullptr && !isDeferredTab(node, k))
+            {
+                candidate = acquireWindow(tab);
+            }
+            if (claimedWindows.contains(candidate))
+            {
+                // The saved id points at a window another tab already kept
+                candidate = d->dockableWindowPool->newWindow(tab.windowType);
+            }
+            if (candidate != nullptr)
+            {
+                claimedWindows.insert(candidate);
+            }
+            windows[k] = candidate;
+        }
+    }
+
+    // Empty reused tab widgets whose content changes before any window moves
+    for (auto iter = matched.begin(); iter != matched.end(); iter++)
+    {
+        TabWidget *tabWidget = qobject_cast<TabWidget *>(iter.value());
+        if (tabWidget == nullptr)
+        {
+            continue;
+        }
+        QList<DockableWindow *> current;
+        for (int k = 0; k < tabWidget->widgetCount(); k++)
+        {
+            current.append(qobject_cast<DockableWindow *>(tabWidget->widget(k)));
+        }
+        // An empty slot is a pending tab to add
+        QList<DockableWindow *> wanted = d->reconciledWindows.value(iter.key());
+        if (!wanted.contains(nullptr) && current == wanted && tabWidget->tabBar()->count() == current.size())
+        {
+            continue;
+        }
+        clearTabWidget(tabWidget);
+    }
+
+    d->isReconcilingLayout = true;
+    QList<QWidget *> garbage;
+    for (int i = 0; i < model.windowCount(); i++)
+    {
+        if (i < reusedWindowCount)
+        {
+            Splitter *rootSplitter = d->rootSplitterList[i];
+            reconcileSplitter(rootSplitter, model, model.window(i).rootSplitter, matched, garbage);
+            if (i > 0 && rootSplitter->parentWidget() != nullptr)
+            {
+                relocateFloatWindowGeometry(rootSplitter->parentWidget(), model.window(i).geometry);
+            }
+        }
+        else
+        {
+            createFloatWindowFromModel(model, i);
+        }
+    }
+    d->isReconcilingLayout = false;
+    d->reconciledWindows.clear();
+
+    // Floating windows the target layout does not have any more
+    QList<QWidget *> closedFloatWindows;
+    for (int i = model.windowCount(); i < oldWindowCount; i++)
+    {
+        if (d->rootSplitterList[i]->parentWidget() != nullptr)
+        {
+            closedFloatWindows.append(d->rootSplitterList[i]->parentWidget());
+        }
+    }
+
+    // Windows left over go back to the pool before their old containers are destroyed
+    for (int p = 0; p < placedWindows.size(); p++)
+    {
+        if (!claimedWindows.contains(placedWindows[p]))
+        {
+            d->dockableWindowPool->hideWindow(placedWindows[p]);
+        }
+    }
+    for (int i = 0; i < closedFloatWindows.size(); i++)
+    {
+        delete closedFloatWindows[i];
+    }
+    for (int i = 0; i < garbage.size(); i++)
+    {
+        delete garbage[i];
+    }
+}
+
+void DockContainer::matchLayoutNode(QWidget *existing, const DockModel &model, DockModel::NodeId id,
+                                    QHash<DockModel::NodeId, QWidget *> &matched)
+{
+    const DockModel::Node &node = model.node(id);
+    if (node.kind == DockModel::SPLITTER)
+    {
+        // An empty splitter or tab widget is already scheduled for deletion
+        Splitter *splitter = qobject_cast<Splitter *>(existing);
+        if (splitter == nullptr || splitter->widgetCount() == 0)
+        {
+            return;
+        }
+        matched.insert(id, splitter);
+        for (int i = 0; i < node.children.size() && i < splitter->widgetCount(); i++)
+        {
+            matchLayoutNode(splitter->widget(i), model, node.children[i], matched);
+        }
+    }
+    else
+    {
+        TabWidget *tabWidget = qobject_cast<TabWidget *>(existing);
+        if (tabWidget == nullptr || tabWidget->widgetCount() == 0)
+        {
+            return;
+        }
+        matched.insert(id, tabWidget);
+    }
+}
+
+void DockContainer::reconcileSplitter(Splitter *splitter, const DockModel &model, DockModel::NodeId id,
+                                      const QHash<DockModel::NodeId, QWidget *> &matched, QList<QWidget *> &garbage)
 {
-    Q_D(DockContainer);
-    if (d->maxmizedWindow != nullptr)
+    const DockModel::Node &node = model.node(id);
+    if (splitter->orientation() != node.orientation)
     {
-        onTabMaxmized();
+        splitter->setOrientation(node.orientation);
     }
-    QJsonArray floatWindowChildren;
-    for (int i = 0; i < d->rootSplitterList.size(); i++)
+    QList<int> sizes;
+    for (int i = 0; i < node.children.size(); i++)
     {
-        QJsonObject windowObj;
-        Splitter *rootSplitter = d->rootSplitterList[i];
-        saveSplitterToJson(rootSplitter, windowObj);
-
-        QWidget *floatWindow = rootSplitter->parentWidget();
-        if (floatWindow)
-        {
-            QRect geometry = floatWindow->geometry();
-            QJsonObject geometryObj;
-            geometryObj.insert(c_strLeft, geometry.left());
-            geometryObj.insert(c_strTop, geometry.top());
-            geometryObj.insert(c_strWidth, geometry.width());
-            geometryObj.insert(c_strHeight, geometry.height());
-            windowObj.insert(c_strGeometry, geometryObj);
-        }
-        if (i == 0)
+        DockModel::NodeId childId = node.children[i];
+        QWidget *current = splitter->widget(i);
+        QWidget *reused = matched.value(childId, nullptr);
+        if (reused != nullptr && reused == current)
         {
-            windowObj.insert(c_strWindowName, c_strMainWindow);
+            if (model.node(childId).kind == DockModel::SPLITTER)
+            {
+                reconcileSplitter(static_cast<Splitter *>(current), model, childId, matched, garbage);
+            }
+            else
+            {
+                reconcileTabWidget(static_cast<TabWidget *>(current), model, childId);
+            }
         }
         else
         {
-            windowObj.insert(c_strWindowName, QString("%1%2").arg("Window_").arg(i));
+            QWidget *created = nullptr;
+            if (model.node(childId).kind == DockModel::SPLITTER)
+            {
+                created = createSplitterFromModel(model, childId);
+            }
+            else
+            {
+                created = createTabWidgetFromModel(model, childId);
+            }
+            if (current != nullptr)
+            {
+                garbage.append(splitter->replaceWidget(i, created));
+            }
+            else
+            {
+                splitter->addWidget(created);
+            }
         }
-        floatWindowChildren.append(windowObj);
+        sizes.append(node.sizes[i]);
     }
-    jsonObj.insert(c_strFloatWindowChildren, floatWindowChildren);
+    while (splitter->widgetCount() > node.children.size() && node.children.size() > 0)
+    {
+        QWidget *extra = splitter->widget(node.children.size());
+        extra->setParent(nullptr);
+        garbage.append(extra);
+    }
+    splitter->updateSizes(sizes);
 }
 
-void DockContainer::createLayoutFromJson(const QJsonObject &jsonObj)
+void DockContainer::reconcileTabWidget(TabWidget *tabWidget, const DockModel &model, DockModel::NodeId id)
 {
     Q_D(DockContainer);
-    d->tabBarSet.clear();
-    d->rootSplitterList.clear();
-    d->dockableWindowPool->hideAllWindowsBeforeChangeLayout();
-    if (nullptr != d->dockRootWidget)
+    const DockModel::Node &node = model.node(id);
+    QList<DockableWindow *> windows = d->reconciledWindows.value(id);
+    // Emptied before when its content changes, otherwise its windows are already in place
+    bool isRefill = (tabWidget->widgetCount() == 0);
+    for (int i = 0; i < node.tabs.size() && i < windows.size(); i++)
     {
-        d->parentWidget->layout()->removeWidget(d->dockRootWidget);
-        delete d->dockRootWidget;
+        DockableWindow *dockableWindow = windows[i];
+        if (isRefill)
+        {
+            addTabFromModel(tabWidget, node.tabs[i], dockableWindow, isDeferredTab(node, i));
+        }
+        else if (dockableWindow != nullptr)
+        {
+            loadWindow(dockableWindow, node.tabs[i]);
+        }
     }
-    d->dockRootWidget = new QWidget();
-    d->dockRootWidget->setObjectName("DockRootWidget");
+    tabWidget->setCurrentTabIndex(node.currentIndex);
+}
 
-    QJsonArray childreList = jsonObj.value(c_strFloatWindowChildren).toArray();
-    if (childreList.isEmpty())
+void DockContainer::collectTabWidgets(QWidget *widget, QList<TabWidget *> &tabWidgets)
+{
+    Splitter *splitter = qobject_cast<Splitter *>(widget);
+    if (splitter != nullptr)
     {
+        for (int i = 0; i < splitter->widgetCount(); i++)
+        {
+            collectTabWidgets(splitter->widget(i), tabWidgets);
+        }
         return;
     }
-    d->parentWidget->layout()->addWidget(d->dockRootWidget);
-
-    QHBoxLayout* carrierlaytout = new QHBoxLayout(d->dockRootWidget);
-    carrierlaytout->setSpacing(0);
-    carrierlaytout->setContentsMargins(0, 0, 0, 0);
-    Splitter *mainRootSplitter = createSplitterFromJson(childreList[0].toObject());
-    connect(mainRootSplitter, &Splitter::destroyed, this, &DockContainer::onSplitterDestroyed);
-    carrierlaytout->addWidget(mainRootSplitter);
-    d->rootSplitterList.append(mainRootSplitter);
-
-    for (int i = 1; i < childreList.count(); i++)
+    TabWidget *tabWidget = qobject_cast<TabWidget *>(widget);
+    if (tabWidget != nullptr)
     {
-        QJsonObject windowJsonObj = childreList[i].toObject();
-        Splitter *floatRootSplitter = createSplitterFromJson(windowJsonObj);
-        d->rootSplitterList.append(floatRootSplitter);
-
-        QHBoxLayout *layout = new QHBoxLayout();
-        layout->setContentsMargins(0, 0, 0, 0);
-        layout->setSpacing(0);
-        layout->addWidget(floatRootSplitter);
-
-        QWidget *floatWindow = new QWidget(d->dockRootWidget);
-        floatWindow->setAttribute(Qt::WA_DeleteOnClose);
-        floatWindow->setLayout(layout);
-        floatWindow->setWindowFlags(Qt::Window);
-        floatWindow->show();
-
-        QJsonObject geometryObj = windowJsonObj.value(c_strGeometry).toObject();
-        int left = geometryObj.value(c_strLeft).toInt();
-        int top = geometryObj.value(c_strTop).toInt();
-        int width = geometryObj.value(c_strWidth).toInt();
-        int height = geometryObj.value(c_strHeight).toInt();
-        QRect rectGeometry(left, top, width, height);
-        relocateFloatWindowGeometry(floatWindow, rectGeometry);
-        connect(floatRootSplitter, &Splitter::destroyed, this, &DockContainer::onSplitterDestroyed);
-        connect(floatRootSplitter, &Splitter::destroyed, floatWindow, &QWidget::deleteLater);
+        tabWidgets.append(tabWidget);
     }
 }
 
-inline Splitter *DockContainer::createSplitterWidget()
+void DockContainer::releaseCurrentLayout()
 {
-    Splitter *splitter = new Splitter();
-    splitter->setOpaqueResize(false);
-    return splitter;
+    Q_D(DockContainer);
+    d->tabBarSet.clear();
+    d->rootSplitterList.clear();
+    // Cached layouts keep their nodes, the deleted widgets unregister their own
+    if (d->layoutCache.isEmpty())
+    {
+        d->dockTree.clear();
+    }
+    d->dockableWindowPool->hideAllWindowsBeforeChangeLayout();
+    if (nullptr != d->dockRootWidget)
+    {
+        d->parentWidget->layout()->removeWidget(d->dockRootWidget);
+        delete d->dockRootWidget;
+        d->dockRootWidget = nullptr;
+    }
 }
 
-void DockContainer::saveSplitterToJson(Splitter *splitter, QJsonObject &jsonObj)
+bool DockContainer::stashCurrentLayout()
 {
     Q_D(DockContainer);
-    jsonObj.insert(c_strWidgetType, SPLITTER);
-    jsonObj.insert(c_strOrientation, splitter->orientation());
-
-    int size = 0;
-    if (d->rootSplitterList.contains(splitter))
+    if (d->currentLayoutName.isEmpty() || d->layoutCacheLimit <= 0 || d->dockRootWidget == nullptr || d->isDragging)
     {
-        size = 1;
+        return false;
     }
-    else
+    if (d->maxmizedWindow != nullptr)
     {
-        Splitter *parentSplitter = getParentSplitter(splitter);
-        if (parentSplitter != nullptr)
+        onTabMaxmized();
+    }
+    CachedLayout layout;
+    layout.name = d->currentLayoutName;
+    layout.rootWidget = d->dockRootWidget;
+    QList<TabWidget *> tabWidgets;
+    for (int i = 0; i < d->rootSplitterList.size(); i++)
+    {
+        Splitter *rootSplitter = d->rootSplitterList[i];
+        layout.rootSplitters.append(rootSplitter);
+        collectTabWidgets(rootSplitter, tabWidgets);
+        if (i > 0 && rootSplitter->parentWidget() != nullptr)
         {
-            Qt::Orientation orientation = parentSplitter->orientation();
-            if (orientation == Qt::Horizontal)
-            {
-                size = splitter->width();
-            }
-            else
-            {
-                size = splitter->height();
-            }
+            rootSplitter->parentWidget()->hide();
         }
-        else
+    }
+    for (int i = 0; i < tabWidgets.size(); i++)
+    {
+        CachedLayout::TabGroup group;
+        group.tabWidget = tabWidgets[i];
+        group.currentIndex = tabWidgets[i]->tabBar()->currentIndex();
+        for (int k = 0; k < tabWidgets[i]->widgetCount(); k++)
         {
-            size = splitter->width();
+            QWidget *page = tabWidgets[i]->widget(k);
+            group.pages.append(page);
+            DockableWindow *dockableWindow = qobject_cast<DockableWindow *>(page);
+            if (dockableWindow != nullptr)
+            {
+                // Hidden layouts own no window, the next layout may take any of them
+                d->dockableWindowPool->releaseWindow(dockableWindow);
+            }
         }
+        layout.tabGroups.append(group);
     }
-    jsonObj.insert(c_strSize, size);
-
-    QRect rectGeometry = splitter->geometry();
-    QJsonObject geometryObj;
-    geometryObj.insert(c_strLeft, rectGeometry.left());
-    geometryObj.insert(c_strTop, rectGeometry.top());
-    geometryObj.insert(c_strWidth, rectGeometry.width());
-    geometryObj.insert(c_strHeight, rectGeometry.height());
-    jsonObj.insert(c_strGeometry, geometryObj);
+    d->parentWidget->layout()->removeWidget(d->dockRootWidget);
+    d->dockRootWidget->hide();
+    d->dockRootWidget = nullptr;
+    d->rootSplitterList.clear();
+    d->tabBarSet.clear();
+    d->currentLayoutName.clear();
 
-    QJsonObject childrenList;
-    for (int i = 0; i < splitter->widgetCount(); i++)
+    d->layoutCache.append(layout);
+    while (d->layoutCache.size() > d->layoutCacheLimit)
     {
-        QJsonObject childObj;
+        evictCachedLayout(0);
+    }
+    return true;
+}
 
-        QString childName;
-        QWidget *widget = splitter->widget(i);
-        if (qobject_cast<Splitter *>(widget) != nullptr)
+void DockContainer::restoreCachedLayout(int index)
+{
+    Q_D(DockContainer);
+    CachedLayout layout = d->layoutCache.takeAt(index);
+    d->layoutFingerprint.clear();
+    d->dockRootWidget = layout.rootWidget;
+    d->parentWidget->layout()->addWidget(d->dockRootWidget);
+    d->dockRootWidget->show();
+    for (int i = 0; i < layout.rootSplitters.size(); i++)
+    {
+        Splitter *rootSplitter = layout.rootSplitters[i];
+        if (rootSplitter == nullptr)
         {
-            childName = c_strSplitter;
-            saveSplitterToJson(qobject_cast<Splitter *>(widget), childObj);
+            continue;
         }
-        else if (qobject_cast<TabWidget *>(widget) != nullptr)
+        d->rootSplitterList.append(rootSplitter);
+        if (i > 0 && rootSplitter->parentWidget() != nullptr)
         {
-            childName = c_strTabWidget;
-            saveTabWidgetToJson(qobject_cast<TabWidget *>(widget), splitter->orientation(), childObj);
+            rootSplitter->parentWidget()->show();
         }
-        childName = QString("%1_%2_%3").arg("child").arg(i).arg(childName);
-        childrenList.insert(childName, childObj);
     }
-    jsonObj.insert(c_strSplitterChildren, childrenList);
-}
 
-Splitter *DockContainer::createSplitterFromJson(const QJsonObject &jsonObj)
-{
-    Qt::Orientation orientation = (Qt::Orientation)jsonObj.value(c_strOrientation).toInt();
-    Splitter *splitter = createSplitterWidget();
-    splitter->setOrientation(orientation);
-    splitter->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
-    QList<int> sizes;
-    QJsonObject childreList = jsonObj.value(c_strSplitterChildren).toObject();
-    for (auto iter = childreList.begin(); iter != childreList.end(); iter++)
+    // Windows taken by other layouts meanwhile are moved back
+    for (int i = 0; i < layout.tabGroups.size(); i++)
     {
-        QJsonObject childOject = iter.value().toObject();
-        int widgetType = childOject.value(c_strWidgetType).toInt();
-        switch (widgetType)
+        const CachedLayout::TabGroup &group = layout.tabGroups[i];
+        TabWidget *tabWidget = group.tabWidget;
+        if (tabWidget == nullptr)
         {
-        case SPLITTER:
+            continue;
+        }
+        QList<QWidget *> pages;
+        for (int k = 0; k < group.pages.size(); k++)
         {
-            Splitter *childSplitter = createSplitterFromJson(childOject);
-            splitter->addWidget(childSplitter);
-            break;
+            if (!group.pages[k].isNull())
+            {
+                pages.append(group.pages[k]);
+            }
         }
-        case TABWIDGE:
+        if (pages.isEmpty())
         {
-            TabWidget *tabWidget = createTabWidgetFromJson(childOject);
-            splitter->addWidget(tabWidget);
-            break;
+            delete tabWidget;
+            continue;
         }
-        default:
-            Q_ASSERT(false);
-            break;
+        QList<QWidget *> current;
+        for (int k = 0; k < tabWidget->widgetCount(); k++)
+        {
+            current.append(tabWidget->widget(k));
+        }
+        if (current != pages || tabWidget->tabBar()->count() != current.size())
+        {
+            // Pending tabs never leave their layout, so nothing stripped here is lost
+            while (tabWidget->widgetCount() > 0)
+            {
+                tabWidget->removeTabAndWidget(0);
+            }
+            while (tabWidget->tabBar()->count() > 0)
+            {
+                tabWidget->removeOnlyTab(0);
+            }
+            for (int k = 0; k < pages.size(); k++)
+            {
+                tabWidget->addTab(pages[k], pageTitle(pages[k]));
+            }
+        }
+        tabWidget->setCurrentTabIndex(qBound(0, group.currentIndex, pages.size() - 1));
+        d->tabBarSet.insert(tabWidget->tabBar());
+        for (int k = 0; k < pages.size(); k++)
+        {
+            DockableWindow *dockableWindow = qobject_cast<DockableWindow *>(pages[k]);
+            if (dockableWindow != nullptr)
+            {
+                d->dockableWindowPool->claimWindow(dockableWindow);
+            }
         }
-        int sizeInSplitter = childOject.value(c_strSize).toInt();
-        sizes.append(sizeInSplitter);
     }
-    splitter->updateSizes(sizes);
-    return splitter;
+    d->dockableWindowPool->trimHiddenWindows();
+    compactJournal();
 }
 
-void DockContainer::saveTabWidgetToJson(TabWidget *tabWidget, Qt::Orientation orient, QJsonObject &jsonObj)
+void DockContainer::evictCachedLayout(int index)
 {
     Q_D(DockContainer);
-    jsonObj.insert(c_strWidgetType, TABWIDGE);
-    int size = 0;
-    if (orient == Qt::Horizontal)
+    CachedLayout layout = d->layoutCache.takeAt(index);
+    // The pooled windows outlive the layout
+    QList<DockableWindow *> windows;
+    for (int i = 0; i < layout.rootSplitters.size(); i++)
     {
-        size = tabWidget->width();
+        if (!layout.rootSplitters[i].isNull())
+        {
+            collectPlacedWindows(layout.rootSplitters[i], windows);
+        }
     }
-    else
+    for (int i = 0; i < windows.size(); i++)
     {
-        size = tabWidget->height();
+        windows[i]->setParent(nullptr);
     }
-    jsonObj.insert(c_strSize, size);
-    jsonObj.insert(c_strCurrentTabIndex, tabWidget->tabBar()->currentIndex());
+    delete layout.rootWidget;
+    d->layoutCacheStats.evictions++;
+}
 
-    QJsonObject children;
-    for (int i = 0; i < tabWidget->widgetCount(); i++)
+void DockContainer::setLayoutCacheLimit(int limit)
+{
+    Q_D(DockContainer);
+    d->layoutCacheLimit = qMax(0, limit);
+    while (d->layoutCache.size() > d->layoutCacheLimit)
     {
-        DockableWindow *dockableWindow = qobject_cast<DockableWindow*>(tabWidget->widget(i));
-        if (dockableWindow == nullptr)
-        {
-            continue;
-        }
-        uint wType = dockableWindow->windowType();
-        QJsonObject childObj;
-        childObj.insert(c_strWidgetType, VIEW);
-        childObj.insert(c_strWindowType, QString::number(wType));
-        //if is last modification todo
-        {
-            int wId = d->dockableWindowPool->windowID(dockableWindow);
-            wId = jsonObj.value(c_strWindowID).toInt();
-            dockableWindow->saveObject(childObj);
-        }
-        QString childName = QString("%1_%2_%3").arg("Tab").arg(i).arg(wType);
-        children.insert(childName, childObj);
-    };
-    jsonObj.insert(c_strTabWidgetChildren, children);
+        evictCachedLayout(0);
+    }
 }
 
-TabWidget *DockContainer::createTabWidgetFromJson(const QJsonObject &jsonObj)
+int DockContainer::layoutCacheLimit() const
+{
+    Q_D(const DockContainer);
+    return d->layoutCacheLimit;
+}
+
+void DockContainer::clearLayoutCache()
 {
     Q_D(DockContainer);
-    int currentTabIndex = jsonObj.value(c_strCurrentTabIndex).toInt();
-    int wId = -1;
-    if (jsonObj.contains(c_strWindowID))
+    while (!d->layoutCache.isEmpty())
     {
-        wId = jsonObj.value(c_strWindowID).toInt();
+        evictCachedLayout(0);
     }
-    TabWidget *tabWidget = createTabWidget();
-    QJsonObject childreList = jsonObj.value(c_strTabWidgetChildren).toObject();
-    for (auto iter = childreList.begin(); iter != childreList.end(); iter++)
+}
+
+LayoutCacheStats DockContainer::layoutCacheStats() const
+{
+    Q_D(const DockContainer);
+    return d->layoutCacheStats;
+}
+
+void DockContainer::collectPlacedWindows(QWidget *widget, QList<DockableWindow *> &windows)
+{
+    Splitter *splitter = qobject_cast<Splitter *>(widget);
+    if (splitter != nullptr)
     {
-        QJsonObject childOject = iter.value().toObject();
-        Q_ASSERT(childOject.value(c_strWidgetType).toInt() == VIEW);
-        auto windowType = childOject.value(c_strWindowType).toString().toLongLong();
-        DockableWindow *dockableWindow = nullptr;
-        if (wId < 0)
-        {
-            dockableWindow = d->dockableWindowPool->newWindow(windowType);
-        }
-        else
+        for (int i = 0; i < splitter->widgetCount(); i++)
         {
-            dockableWindow = d->dockableWindowPool->getWindow(windowType, wId);
+            collectPlacedWindows(splitter->widget(i), windows);
         }
-        if (dockableWindow)
+        return;
+    }
+    TabWidget *tabWidget = qobject_cast<TabWidget *>(widget);
+    if (tabWidget != nullptr)
+    {
+        for (int i = 0; i < tabWidget->widgetCount(); i++)
         {
-            dockableWindow->load(childOject);
-            dockableWindow->setMinimumSize(WIDGET_MIN_SIZE, WIDGET_MIN_SIZE);
-            dockableWindow->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
-            connect(dockableWindow, SIGNAL(destroyed(QObject *)), this, SLOT(onDockableWindowDestroyed(QObject *)));
-            tabWidget->addTab(dockableWindow, dockableWindow->getTitle());
+            DockableWindow *dockableWindow = qobject_cast<DockableWindow *>(tabWidget->widget(i));
+            if (dockableWindow != nullptr)
+            {
+                windows.append(dockableWindow);
+            }
         }
     }
-    tabWidget->setCurrentTabIndex(currentTabIndex);
-    return tabWidget;
 }
 
 void DockContainer::tabbedView(DockableWindow *view, TabWidget *tabWidget, int index, const QString &label)
@@ -431,22 +1719,65 @@ void DockContainer::tabbedView(DockableWindow *view, TabWidget *tabWidget, int i
     {
         tabWidget->setCurrentTabIndex(actIndex);
     }
+    markLayoutChanged(d);
+    LayoutJournal::Record record;
+    if (journalLocation(d, tabWidget, record.target))
+    {
+        record.operation = LayoutJournal::TAB;
+        record.sourceIndex = view->windowType();
+        record.state = view->savedState();
+        record.targetIndex = actIndex;
+        appendJournal(d, record);
+    }
     //save for searching
     view->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
-    view->setMinimumSize(WIDGET_MIN_SIZE, WIDGET_MIN_SIZE);
+    view->setMinimumSize(DockModel::WIDGET_MIN_SIZE, DockModel::WIDGET_MIN_SIZE);
     d->dockableWindowPool->registerWindow(view);
     connect(view, &DockableWindow::destroyed, this, &DockContainer::onDockableWindowDestroyed);
+    connect(view, &DockableWindow::stateMarkedDirty, this, &DockContainer::onWindowStateMarkedDirty, Qt::UniqueConnection);
+    d->dockableWindowPool->windowReady(view);
 }
 
 TabWidget *DockContainer::floatView(DockableWindow *view, const QString& title)
 {
+    Q_D(DockContainer);
     QPoint cusPos = QApplication::primaryScreen()->availableGeometry().center();
-    return floatView(view, title, cusPos);
+    TabWidget *tabWidget = floatView(view, title, cusPos);
+    markLayoutChanged(d);
+    LayoutJournal::Record record;
+    if (journalLocation(d, tabWidget, record.target))
+    {
+        record.operation = LayoutJournal::FLOAT;
+        record.sourceIndex = view->windowType();
+        record.state = view->savedState();
+        record.geometry = getRootSplitter(tabWidget)->parentWidget()->geometry();
+        appendJournal(d, record);
+    }
+    return tabWidget;
 }
 
 void DockContainer::floatView(uint nWindowType)
 {
     Q_D(DockContainer);
+    if (asyncFactory(nWindowType) != nullptr)
+    {
+        DockModel::Tab tab;
+        tab.windowType = nWindowType;
+        PendingWindow *pending = createPendingPage(tab);
+        QPoint cusPos = QApplication::primaryScreen()->availableGeometry().center();
+        TabWidget *tabWidget = floatView(pending, pending->getTitle(), cusPos);
+        markLayoutChanged(d);
+        LayoutJournal::Record record;
+        if (journalLocation(d, tabWidget, record.target))
+        {
+            record.operation = LayoutJournal::FLOAT;
+            record.sourceIndex = nWindowType;
+            record.geometry = getRootSplitter(tabWidget)->parentWidget()->geometry();
+            appendJournal(d, record);
+        }
+        createPendingWindow(pending);
+        return;
+    }
     auto pDockableWindow = d->dockableWindowPool->newWindow(nWindowType);
     if (pDockableWindow != nullptr)
     {
@@ -471,7 +1802,18 @@ void DockContainer::activeView(uint nWindowType)
     }
     else
     {
-        floatView(nWindowType);
+        PendingWindow *pending = findPendingWindow(nWindowType);
+        TabWidget *pParentTabWidget = getParentTabWidget(pending);
+        if (pParentTabWidget != nullptr)
+        {
+            // An async window keeps its placeholder current until it is ready
+            DockableWindow *pDockableWindow = createPendingWindow(pending);
+            pParentTabWidget->setCurrentWidget(pDockableWindow != nullptr ? static_cast<QWidget *>(pDockableWindow) : pending);
+        }
+        else
+        {
+            floatView(nWindowType);
+        }
     }
 }
 
@@ -501,11 +1843,18 @@ TabWidget *DockContainer::floatView(QWidget *view, const QString& title, QPoint
     QRect geo(0, 0, 900, 600);
     geo.moveCenter(cusPos);
     relocateFloatWindowGeometry(floatWindow, geo);
+    connect(floatWindow, &QWidget::destroyed, this, &DockContainer::onFloatWindowDestroyed);
 
     //save for searching
-    d->dockableWindowPool->registerWindow(qobject_cast<DockableWindow*>(view));
-    connect(view, &DockableWindow::destroyed, this, &DockContainer::onDockableWindowDestroyed);
+    if (pDockableWindow != nullptr)
+    {
+        d->dockableWindowPool->registerWindow(pDockableWindow);
+        connect(view, &DockableWindow::destroyed, this, &DockContainer::onDockableWindowDestroyed);
+        connect(pDockableWindow, &DockableWindow::stateMarkedDirty, this, &DockContainer::onWindowStateMarkedDirty, Qt::UniqueConnection);
+        d->dockableWindowPool->windowReady(pDockableWindow);
+    }
     d->rootSplitterList.append(rootSplitter);
+    d->dockTree.addRoot(rootSplitter, nullptr);
     connect(rootSplitter, &Splitter::destroyed, this, &DockContainer::onSplitterDestroyed);
     connect(rootSplitter, &Splitter::destroyed, floatWindow, &QWidget::deleteLater);
     return tabWidget;
@@ -557,6 +1906,11 @@ TabWidget *DockContainer::createTabWidget()
     //save for searching
     d->tabBarSet.insert(tabWidget->tabBar());
     connect(tabWidget->tabBar(), &TabBar::destroyed, this, &DockContainer::onTabBarDestroyed);
+    d->dockTree.addTabGroup(tabWidget);
+    connect(tabWidget, &TabWidget::windowInserted, this, &DockContainer::onTabWidgetWindowInserted);
+    connect(tabWidget, &TabWidget::windowRemoved, this, &DockContainer::onTabWidgetWindowRemoved);
+    connect(tabWidget, &TabWidget::currentWidgetChanged, this, &DockContainer::onTabCurrentWidgetChanged);
+    connect(tabWidget, &TabWidget::destroyed, this, &DockContainer::onDockNodeDestroyed);
     return tabWidget;
 }
 
@@ -593,6 +1947,7 @@ bool DockContainer::eventFilter(QObject *watched, QEvent *event)
                     QKeyEvent* keyEvent = static_cast<QKeyEvent*>(event);
                     if (keyEvent->key() == Qt::Key_Escape)
                     {
+                        d->dragFramePacer->cancel();
                         d->isDraggingCancelled = true;
                         endDragging(QPoint(-1, -1));
                     }
@@ -625,10 +1980,13 @@ void DockContainer::tabBarMouseReleaseEvent(QObject *watched, QEvent *event)
     (void)watched;
     if (d->isDraggingCancelled)
     {
+        d->dragFramePacer->cancel();
         d->isDraggingCancelled = false;
     }
     else
     {
+        // Evaluate the last coalesced move first, so the drop uses the exact final hover
+        d->dragFramePacer->flush();
         QMouseEvent* mouseEvent = static_cast<QMouseEvent *>(event);
         endDragging(mouseEvent->globalPosition().toPoint());
     }
@@ -658,7 +2016,7 @@ void DockContainer::tabBarMouseMoveEvent(QObject *watched, QEvent *event)
         beginDragging(tabBar);
         if (d->isDragging)
         {
-            showDragging(mouseEvent->globalPosition().toPoint());
+            d->dragFramePacer->pushMove(mouseEvent->globalPosition().toPoint());
         }
     }
 }
@@ -673,6 +2031,11 @@ void DockContainer::tabBarContextMenuEvent(QObject *watched, QEvent *event)
     if (d->contextMenuTabIndex >= 0 && d->contextMenuTabWidget != nullptr)
     {
         QMenu *menu = new QMenu();
+        PendingWindow *pending = qobject_cast<PendingWindow *>(d->contextMenuTabWidget->widget(d->contextMenuTabIndex));
+        if (pending != nullptr)
+        {
+            createPendingWindow(pending);
+        }
         DockableWindow *view = qobject_cast<DockableWindow*>(d->contextMenuTabWidget->widget(d->contextMenuTabIndex));
         if (view != nullptr)
         {
@@ -761,35 +2124,12 @@ bool DockContainer::isLastTabInMainWindow(TabBar *tabBar)
     {
         return false;
     }
-    if (!d->parentWidget->isAncestorOf(tabBar))
-    {
-        return false;
-    }
     if (d->rootSplitterList.isEmpty() || getRootSplitter(tabBar) != d->rootSplitterList[0])
     {
         return false;
     }
-
-    for (auto iter = d->tabBarSet.begin(); iter != d->tabBarSet.end(); iter++)
-    {
-        if (*iter == tabBar)
-        {
-            continue;
-        }
-        if (d->maxmizedTempTabWidget != nullptr)
-        {
-            if (*iter == d->maxmizedTempTabWidget->tabBar())
-            {
-                continue;
-            }
-        }
-        if (d->rootSplitterList.isEmpty() || getRootSplitter(*iter) != d->rootSplitterList[0])
-        {
-            continue;
-        }
-        return false;
-    }
-    return true;
+    // The maximized temporary tab widget is never below a root, so it is not counted
+    return d->dockTree.rootTabGroupCount(tabBar) <= 1;
 }
 
 void DockContainer::beginDragging(TabBar *tabBar)
@@ -825,6 +2165,12 @@ void DockContainer::beginDragging(TabBar *tabBar)
         d->sourceTabIndex = tabBar->tabAt(localPoint);
         if (d->sourceTabIndex >= 0)
         {
+            // The press may not have given its pending window a turn of the event loop yet
+            PendingWindow *pending = qobject_cast<PendingWindow *>(d->sourceTabWidget->widget(d->sourceTabIndex));
+            if (pending != nullptr)
+            {
+                createPendingWindow(pending);
+            }
             d->sourceTabText = d->sourceTabWidget->tabText(d->sourceTabIndex);
             d->sourceView = d->sourceTabWidget->widget(d->sourceTabIndex);
             if (d->sourceView == nullptr)
@@ -833,6 +2179,7 @@ void DockContainer::beginDragging(TabBar *tabBar)
             }
             d->sourceTabWidget->removeOnlyTab(d->sourceTabIndex);
             d->isDragging = true;
+            buildDropTargetIndex();
             qApp->installEventFilter(this);
         }
     }
@@ -885,7 +2232,21 @@ void DockContainer::endDragging(QPoint pos)
         d->sourceTabText = "";
         d->sourceView = nullptr;
         d->sourceTabWidget = nullptr;
+        d->dropTargetIndex.clear();
         hideTemplateForm();
+        if (!d->pendingTabWidgets.isEmpty())
+        {
+            onPendingTabsShown();
+        }
+        QList<QPointer<PendingWindow>> preparedWindows = d->preparedWindows;
+        d->preparedWindows.clear();
+        for (int i = 0; i < preparedWindows.size(); i++)
+        {
+            if (!preparedWindows[i].isNull())
+            {
+                createPendingWindow(preparedWindows[i]);
+            }
+        }
         QApplication::processEvents();
         d->parentWidget->setUpdatesEnabled(true);
         qApp->removeEventFilter(this);
@@ -905,6 +2266,9 @@ void DockContainer::endDragByTabbled(QPoint pos)
     {
         return;
     }
+    markLayoutChanged(d);
+    LayoutJournal::Record record;
+    bool isJournaled = journalLocation(d, d->sourceTabWidget, record.source) && journalLocation(d, targetTabWidget, record.target);
     QPoint localPos = targetTabWidget->tabBar()->mapFromGlobal(pos);
     int index = targetTabWidget->tabBar()->tabAt(localPos);
     targetTabWidget->removeTempTab();
@@ -912,6 +2276,13 @@ void DockContainer::endDragByTabbled(QPoint pos)
     int newIndex = targetTabWidget->insertTab(index, d->sourceView, d->sourceTabText);
     targetTabWidget->setCurrentTabIndex(newIndex);
     targetTabWidget->setCurrentWidgetIndex(newIndex);
+    if (isJournaled)
+    {
+        record.operation = LayoutJournal::TAB;
+        record.sourceIndex = d->sourceTabIndex;
+        record.targetIndex = newIndex;
+        appendJournal(d, record);
+    }
 }
 
 void DockContainer::endDragByDockedAtRoot(QPoint pos)
@@ -931,8 +2302,16 @@ void DockContainer::endDragByDockedAtRoot(QPoint pos)
         return;
     }
 
-    QPoint locatPoint = d->hoverWidgetData.horverWidget->mapFromGlobal(pos);
-    RegionType type = getRegionType(locatPoint, d->hoverWidgetData.horverWidget->rect());
+    RegionType type = getGlobalRegionType(pos, d->hoverWidgetData.hoverRect);
+    markLayoutChanged(d);
+    LayoutJournal::Record record;
+    if (type != CENTRAL && journalLocation(d, d->sourceTabWidget, record.source) && journalLocation(d, splitter, record.target))
+    {
+        record.operation = LayoutJournal::DOCK;
+        record.sourceIndex = d->sourceTabIndex;
+        record.targetIndex = (DockModel::Region)type;
+        appendJournal(d, record);
+    }
     switch (type)
     {
     case TOP:
@@ -967,16 +2346,24 @@ void DockContainer::endDragByDockedAtChild(QPoint pos)
     {
         return;
     }
-    TabWidget *hoverTabWidget = getParentTabWidget(d->hoverWidgetData.horverWidget);
+    TabWidget *hoverTabWidget = qobject_cast<TabWidget *>(d->hoverWidgetData.horverWidget);
     if (hoverTabWidget == nullptr)
     {
         return;
     }
+    RegionType type = getGlobalRegionType(pos, d->hoverWidgetData.hoverRect);
+    markLayoutChanged(d);
+    LayoutJournal::Record record;
+    if (type != CENTRAL && journalLocation(d, d->sourceTabWidget, record.source) && journalLocation(d, hoverTabWidget, record.target))
+    {
+        record.operation = LayoutJournal::DOCK;
+        record.sourceIndex = d->sourceTabIndex;
+        record.targetIndex = (DockModel::Region)type;
+        appendJournal(d, record);
+    }
     TabWidget *newTabWidget = createTabWidget();
     d->sourceTabWidget->removeOnlyWidget(d->sourceView);
     newTabWidget->addTab(d->sourceView, d->sourceTabText);
-    QPoint locatPoint = hoverTabWidget->mapFromGlobal(pos);
-    RegionType type = getRegionType(locatPoint, hoverTabWidget->rect());
     switch (type)
     {
     case TOP:
@@ -1010,14 +2397,10 @@ void DockContainer::dockAtTabWidgetRight(TabWidget *newTabWidget, TabWidget *hov
     Splitter *hoverSplitter = getParentSplitter(hoverTabWidget);
     Q_ASSERT(hoverSplitter != nullptr);
     int index = hoverSplitter->indexOf(hoverTabWidget);
-    int rightWidth = hoverTabWidget->width() / 3;
-    int leftWidth = hoverTabWidget->width() - rightWidth;
     if (hoverSplitter->orientation() == Qt::Horizontal)
     {
-        QList<int> sizes = hoverSplitter->sizes();
+        QList<int> sizes = DockModel::sizesAfterDockBeside(hoverSplitter->sizes(), index, hoverTabWidget->width(), false);
         hoverSplitter->insertWidget(index + 1, newTabWidget);
-        sizes[index] = leftWidth;
-        sizes.insert(index + 1, rightWidth);
         hoverSplitter->updateSizes(sizes);
     }
     else
@@ -1027,10 +2410,7 @@ void DockContainer::dockAtTabWidgetRight(TabWidget *newTabWidget, TabWidget *hov
         hoverSplitter->replaceWidget(index, newSplitter);
         newSplitter->addWidget(hoverTabWidget);
         newSplitter->addWidget(newTabWidget);
-        QList<int> sizes;
-        sizes.append(leftWidth);
-        sizes.append(rightWidth);
-        newSplitter->updateSizes(sizes);
+        newSplitter->updateSizes(DockModel::splitSizes(hoverTabWidget->width(), false));
     }
 }
 
@@ -1039,14 +2419,10 @@ void DockContainer::dockAtTabWidgetLeft(TabWidget *newTabWidget, TabWidget *hove
     Splitter *hoverSplitter = getParentSplitter(hoverTabWidget);
     Q_ASSERT(hoverSplitter != nullptr);
     int index = hoverSplitter->indexOf(hoverTabWidget);
-    int leftWidth = hoverTabWidget->width() / 3;
-    int rightWidth = hoverTabWidget->width() - leftWidth;
     if (hoverSplitter->orientation() == Qt::Horizontal)
     {
-        QList<int> sizes = hoverSplitter->sizes();
+        QList<int> sizes = DockModel::sizesAfterDockBeside(hoverSplitter->sizes(), index, hoverTabWidget->width(), true);
         hoverSplitter->insertWidget(index, newTabWidget);
-        sizes.insert(index, leftWidth);
-        sizes[index + 1] = rightWidth;
         hoverSplitter->updateSizes(sizes);
     }
     else
@@ -1056,10 +2432,7 @@ void DockContainer::dockAtTabWidgetLeft(TabWidget *newTabWidget, TabWidget *hove
         hoverSplitter->replaceWidget(index, newSplitter);
         newSplitter->addWidget(newTabWidget);
         newSplitter->addWidget(hoverTabWidget);
-        QList<int> sizes;
-        sizes.append(leftWidth);
-        sizes.append(rightWidth);
-        newSplitter->updateSizes(sizes);
+        newSplitter->updateSizes(DockModel::splitSizes(hoverTabWidget->width(), true));
     }
 
 }
@@ -1069,14 +2442,10 @@ void DockContainer::dockAtTabWdigetTop(TabWidget *newTabWidget, TabWidget *hover
     Splitter *hoverSplitter = getParentSplitter(hoverTabWidget);
     Q_ASSERT(hoverSplitter != nullptr);
     int index = hoverSplitter->indexOf(hoverTabWidget);
-    int topHeight = hoverTabWidget->height() / 3;
-    int bottomHeight = hoverTabWidget->height() - topHeight;
     if (hoverSplitter->orientation() == Qt::Vertical)
     {
-        QList<int> sizes = hoverSplitter->sizes();
+        QList<int> sizes = DockModel::sizesAfterDockBeside(hoverSplitter->sizes(), index, hoverTabWidget->height(), true);
         hoverSplitter->insertWidget(index, newTabWidget);
-        sizes.insert(index, topHeight);
-        sizes[index + 1] = bottomHeight;
         hoverSplitter->updateSizes(sizes);
     }
     else
@@ -1086,9 +2455,7 @@ void DockContainer::dockAtTabWdigetTop(TabWidget *newTabWidget, TabWidget *hover
         hoverSplitter->replaceWidget(index, newSplitter);
         newSplitter->addWidget(newTabWidget);
         newSplitter->addWidget(hoverTabWidget);
-        QList<int> sizes;
-        sizes << topHeight << bottomHeight;
-        newSplitter->updateSizes(sizes);
+        newSplitter->updateSizes(DockModel::splitSizes(hoverTabWidget->height(), true));
     }
 }
 
@@ -1097,14 +2464,10 @@ void DockContainer::dockAtTabWidgetBottom(TabWidget *newTabWidget, TabWidget *ho
     Splitter *hoverSplitter = getParentSplitter(hoverTabWidget);
     Q_ASSERT(nullptr != hoverSplitter);
     int index = hoverSplitter->indexOf(hoverTabWidget);
-    int bottomHeight = hoverTabWidget->height() / 3;
-    int topHeight = hoverTabWidget->height() - bottomHeight;
     if (hoverSplitter->orientation() == Qt::Vertical)
     {
-        QList<int> sizes = hoverSplitter->sizes();
+        QList<int> sizes = DockModel::sizesAfterDockBeside(hoverSplitter->sizes(), index, hoverTabWidget->height(), false);
         hoverSplitter->insertWidget(index + 1, newTabWidget);
-        sizes[index] = topHeight;
-        sizes.insert(index + 1, bottomHeight);
         hoverSplitter->updateSizes(sizes);
     }
     else
@@ -1114,9 +2477,7 @@ void DockContainer::dockAtTabWidgetBottom(TabWidget *newTabWidget, TabWidget *ho
         hoverSplitter->replaceWidget(index, newSplitter);
         newSplitter->addWidget(hoverTabWidget);
         newSplitter->addWidget(newTabWidget);
-        QList<int> sizes;
-        sizes << topHeight << bottomHeight;
-        newSplitter->updateSizes(sizes);
+        newSplitter->updateSizes(DockModel::splitSizes(hoverTabWidget->height(), false));
     }
 
 }
@@ -1134,15 +2495,14 @@ void DockContainer::dockAtRootSplitterTop(TabWidget *newTabWidget, Splitter *roo
     {
         QList<int> sizes = rootSplitter->sizes();
         rootSplitter->insertWidget(0, newTabWidget);
-        QList<int> newSizes = recalcRootSplitterSizesAfterAddNew(sizes, ROOT_DOCKED_SIZE_HINT, true);
+        QList<int> newSizes = DockModel::recalcRootSplitterSizesAfterAddNew(sizes, DockModel::ROOT_DOCKED_SIZE_HINT, true);
         rootSplitter->updateSizes(newSizes);
     }
     else
     {
         QWidget *window = rootSplitter->parentWidget();
         Q_ASSERT(window != nullptr);
-        QList<int> newSizes;
-        newSizes << ROOT_DOCKED_SIZE_HINT << rootSplitter->height() - ROOT_DOCKED_SIZE_HINT;
+        QList<int> newSizes = DockModel::rootSplitSizes(rootSplitter->height(), true);
         Splitter *newRootSplitter = createSplitterWidget();
         newRootSplitter->setOrientation(Qt::Vertical);
         newRootSplitter->addWidget(newTabWidget);
@@ -1166,15 +2526,14 @@ void DockContainer::dockAtRootSplitterLeft(TabWidget *newTabWidget, Splitter *ro
     {
         QList<int> sizes = rootSplitter->sizes();
         rootSplitter->insertWidget(0, newTabWidget);
-        QList<int> newSizes = recalcRootSplitterSizesAfterAddNew(sizes, ROOT_DOCKED_SIZE_HINT, true);
+        QList<int> newSizes = DockModel::recalcRootSplitterSizesAfterAddNew(sizes, DockModel::ROOT_DOCKED_SIZE_HINT, true);
         rootSplitter->updateSizes(newSizes);
     }
     else
     {
         QWidget *window = rootSplitter->parentWidget();
         Q_ASSERT(window != nullptr);
-        QList<int> newSizes;
-        newSizes << ROOT_DOCKED_SIZE_HINT << rootSplitter->height() - ROOT_DOCKED_SIZE_HINT;
+        QList<int> newSizes = DockModel::rootSplitSizes(rootSplitter->width(), true);
         Splitter *newRootSplitter = createSplitterWidget();
         newRootSplitter->setOrientation(Qt::Horizontal);
         newRootSplitter->addWidget(newTabWidget);
@@ -1197,15 +2556,14 @@ void DockContainer::dockAtRootSplitterBottom(TabWidget *newTabWidget, Splitter *
     {
         QList<int> sizes = rootSplitter->sizes();
         rootSplitter->addWidget(newTabWidget);
-        QList<int> newSizes = recalcRootSplitterSizesAfterAddNew(sizes, ROOT_DOCKED_SIZE_HINT, false);
+        QList<int> newSizes = DockModel::recalcRootSplitterSizesAfterAddNew(sizes, DockModel::ROOT_DOCKED_SIZE_HINT, false);
         rootSplitter->updateSizes(newSizes);
     }
     else
     {
         QWidget *window = rootSplitter->parentWidget();
         Q_ASSERT(window != nullptr);
-        QList<int> newSizes;
-        newSizes << rootSplitter->height() - ROOT_DOCKED_SIZE_HINT << ROOT_DOCKED_SIZE_HINT;
+        QList<int> newSizes = DockModel::rootSplitSizes(rootSplitter->height(), false);
         Splitter *newRootSplitter = createSplitterWidget();
         newRootSplitter->setOrientation(Qt::Vertical);
         newRootSplitter->addWidget(rootSplitter);
@@ -1229,15 +2587,14 @@ void DockContainer::dockAtRootSplitterRight(TabWidget *newTabWidget, Splitter *r
     {
         QList<int> sizes = rootSplitter->sizes();
         rootSplitter->addWidget(newTabWidget);
-        QList<int> newSizes = recalcRootSplitterSizesAfterAddNew(sizes, ROOT_DOCKED_SIZE_HINT, false);
+        QList<int> newSizes = DockModel::recalcRootSplitterSizesAfterAddNew(sizes, DockModel::ROOT_DOCKED_SIZE_HINT, false);
         rootSplitter->updateSizes(newSizes);
     }
     else
     {
         QWidget *window = rootSplitter->parentWidget();
         Q_ASSERT(window != nullptr);
-        QList<int> newSizes;
-        newSizes << rootSplitter->height() - ROOT_DOCKED_SIZE_HINT << ROOT_DOCKED_SIZE_HINT;
+        QList<int> newSizes = DockModel::rootSplitSizes(rootSplitter->width(), false);
         Splitter *newRootSplitter = createSplitterWidget();
         newRootSplitter->setOrientation(Qt::Horizontal);
         newRootSplitter->addWidget(rootSplitter);
@@ -1248,38 +2605,21 @@ void DockContainer::dockAtRootSplitterRight(TabWidget *newTabWidget, Splitter *r
     }
 }
 
-QList<int> DockContainer::recalcRootSplitterSizesAfterAddNew(QList<int> oldSizes, int newItemSizeHint, bool isToHead)
-{
-    QList<int> newSizes;
-    int totalDecrease = 0;
-    for (int i = 0; i < oldSizes.size(); i++)
-    {
-        int decrease = std::min<int>(newItemSizeHint - totalDecrease, oldSizes[i] - WIDGET_MIN_SIZE);
-        newSizes.append(oldSizes[i] - decrease);
-        totalDecrease += decrease;
-        Q_ASSERT(totalDecrease <= newItemSizeHint);
-        if (totalDecrease == newItemSizeHint)
-        {
-            continue;
-        }
-    }
-    int newItemSize = std::max<int>(WIDGET_MIN_SIZE, totalDecrease);
-    if (isToHead)
-    {
-        newSizes.insert(0, newItemSize);
-    }
-    else
-    {
-        newSizes.append(newItemSize);
-    }
-    return newSizes;
-}
-
 void DockContainer::endDragByFloated(QPoint pos)
 {
     Q_D(DockContainer);
+    markLayoutChanged(d);
+    LayoutJournal::Record record;
+    bool isJournaled = journalLocation(d, d->sourceTabWidget, record.source);
     d->sourceTabWidget->removeOnlyWidget(d->sourceView);
-    floatView(d->sourceView, d->sourceTabText, pos);
+    TabWidget *tabWidget = floatView(d->sourceView, d->sourceTabText, pos);
+    if (isJournaled)
+    {
+        record.operation = LayoutJournal::FLOAT;
+        record.sourceIndex = d->sourceTabIndex;
+        record.geometry = getRootSplitter(tabWidget)->parentWidget()->geometry();
+        appendJournal(d, record);
+    }
 }
 
 void DockContainer::endDragByCancelled()
@@ -1322,55 +2662,32 @@ void DockContainer::endDragByCancelled()
 
 Splitter *DockContainer::getParentSplitter(QWidget *widget)
 {
+    Q_D(DockContainer);
     if (widget == nullptr)
     {
         return nullptr;
     }
-    QWidget *parentWidget = widget->parentWidget();
-    Splitter *parentSpliter = qobject_cast<Splitter *>(parentWidget);
-    while (parentSpliter == nullptr && parentWidget != nullptr)
-    {
-        parentWidget = parentWidget->parentWidget();
-        parentSpliter = qobject_cast<Splitter *>(parentWidget);
-    }
-    return parentSpliter;
+    return d->dockTree.parentSplitter(widget);
 }
 
 Splitter *DockContainer::getRootSplitter(QWidget *widget)
 {
+    Q_D(DockContainer);
     if (widget == nullptr)
     {
-        return nullptr;
-    }
-    Splitter *parentSplitter = qobject_cast<Splitter *>(widget);
-    if (parentSplitter == nullptr)
-    {
-        parentSplitter = getParentSplitter(widget);
-    }
-
-    Splitter *rootParentSplitter = parentSplitter;
-    while (parentSplitter != nullptr)
-    {
-        rootParentSplitter = parentSplitter;
-        parentSplitter = getParentSplitter(parentSplitter);
+        return nullptr;
     }
-    return rootParentSplitter;
+    return d->dockTree.rootSplitter(widget);
 }
 
 TabWidget *DockContainer::getParentTabWidget(QWidget *widget)
 {
+    Q_D(DockContainer);
     if (widget == nullptr)
     {
         return nullptr;
     }
-    QWidget *parentWidget = widget->parentWidget();
-    TabWidget *parentTabWidget = qobject_cast<TabWidget *>(parentWidget);
-    while (parentTabWidget == nullptr && parentWidget != nullptr)
-    {
-        parentWidget = parentWidget->parentWidget();
-        parentTabWidget = qobject_cast<TabWidget *>(parentWidget);
-    }
-    return parentTabWidget;
+    return d->dockTree.parentTabWidget(widget);
 }
 
 void DockContainer::showDragging(QPoint currrentCurPos)
@@ -1413,70 +2730,91 @@ void DockContainer::showDragging(QPoint currrentCurPos)
     }
 }
 
-void DockContainer::getHoverWidgetData(QPoint curPos, HoverWidgetData &data)
+void DockContainer::buildDropTargetIndex()
 {
     Q_D(DockContainer);
-    if (d->hoverWidgetData.type == TAB
-        && d->hoverWidgetData.horverWidget->rect().contains(d->hoverWidgetData.horverWidget->mapFromGlobal(curPos)))
+    d->dropTargetIndex.clear();
+    for (int i = 0; i < d->rootSplitterList.size(); i++)
     {
-        data = d->hoverWidgetData;
-        return;
+        Splitter *rootSplitter = d->rootSplitterList[i];
+        QWidget *window = rootSplitter->window();
+        if (window == nullptr || !window->isVisible())
+        {
+            continue;
+        }
+        // Window managers raise a window when it is activated, so activation order stands in for
+        // the stacking order Qt does not report. Windows never activated stay below, floating ones
+        // above the main window. A window raised without activation is not seen
+        int rank = d->windowActivationOrder.indexOf(window->windowHandle());
+        int z = (rank >= 0) ? d->rootSplitterList.size() + rank : i;
+        QRect dockRect(rootSplitter->mapToGlobal(QPoint(0, 0)), rootSplitter->size());
+        d->dropTargetIndex.addWindow(window, window->frameGeometry(), window->geometry(), dockRect, z);
     }
-
-    QWidget *hoverWidget = this->widgetAt(curPos);
-    if (d->maxmizedWindow != nullptr)
+    for (auto iter = d->tabBarSet.begin(); iter != d->tabBarSet.end(); iter++)
     {
-        if (d->parentWidget->isAncestorOf(hoverWidget)
-            || hoverWidget->isAncestorOf(d->parentWidget))
+        QWidget *tabBar = *iter;
+        if (tabBar == nullptr || !tabBar->isVisible())
         {
-            data.type = FLOAT;
-            return;
+            continue;
+        }
+        TabWidget *tabWidget = qobject_cast<TabWidget *>(tabBar->parentWidget());
+        if (tabWidget == nullptr)
+        {
+            continue;
         }
+        QWidget *window = tabBar->window();
+        d->dropTargetIndex.addTabBar(window, tabBar, QRect(tabBar->mapToGlobal(QPoint(0, 0)), tabBar->size()));
+        d->dropTargetIndex.addTabWidget(window, tabWidget, QRect(tabWidget->mapToGlobal(QPoint(0, 0)), tabWidget->size()));
     }
-    if (hoverWidget != nullptr && hoverWidget->isWindow())
+    d->dropTargetIndex.build();
+}
+
+void DockContainer::getHoverWidgetData(QPoint curPos, HoverWidgetData &data)
+{
+    Q_D(DockContainer);
+    if (d->hoverWidgetData.type == TAB && d->hoverWidgetData.hoverRect.contains(curPos))
     {
-        data.horverWidget = hoverWidget;
-        data.type = DOCK_AT_ROOT;
+        data = d->hoverWidgetData;
         return;
     }
 
-    if (d->tabBarSet.contains(hoverWidget))
+    DropTargetIndex::Target target;
+    if (!d->dropTargetIndex.hitTest(curPos, target))
     {
-        data.horverWidget = hoverWidget;
-        data.type = TAB;
+        data.type = FLOAT;
         return;
     }
-
-    while (nullptr != hoverWidget)
+    if (d->maxmizedWindow != nullptr && target.window == d->parentWidget->window())
     {
-        if (d->dockableWindowPool->isDockedWindow(hoverWidget))
-            break;
-        hoverWidget = hoverWidget->parentWidget();
+        data.type = FLOAT;
+        return;
     }
 
-    if (nullptr != hoverWidget)
+    switch (target.kind)
     {
-        TabWidget *tabWiget = getParentTabWidget(hoverWidget);
-        if (tabWiget == d->sourceTabWidget && d->sourceTabWidget->widgetCount() == 1)
-        {
-            if(qobject_cast<QTabBar *>(hoverWidget) != nullptr)
-            {
-                data.type = TAB;
-                data.horverWidget = hoverWidget;
-            }
-            else
-            {
-                data.type = FLOAT;
-            }
-        }
-        else
+    case DropTargetIndex::WINDOW_BORDER:
+    {
+        data.type = DOCK_AT_ROOT;
+        break;
+    }
+    case DropTargetIndex::TAB_BAR:
+    {
+        data.type = TAB;
+        break;
+    }
+    default:
+    {
+        if (target.widget == d->sourceTabWidget && d->sourceTabWidget->widgetCount() == 1)
         {
-            data.horverWidget = hoverWidget;
-            data.type = DOCK_AT_CHILD;
+            data.type = FLOAT;
+            return;
         }
-        return;
+        data.type = DOCK_AT_CHILD;
+        break;
+    }
     }
-    data.type = FLOAT;
+    data.horverWidget = target.widget;
+    data.hoverRect = target.globalRect;
 }
 
 void DockContainer::onHoverWidgetChanged(QPoint curPos, HoverWidgetData &newHoverdata)
@@ -1528,6 +2866,20 @@ void DockContainer::onHoverWidgetChanged(QPoint curPos, HoverWidgetData &newHove
             Qt::NoModifier);
         QCoreApplication::sendEvent(newHoverdata.horverWidget, &mouseEventpress);
     }
+    // A drop target shows its window even while activations wait for the drop
+    TabWidget *hoverTabWidget = qobject_cast<TabWidget *>(newHoverdata.horverWidget);
+    if (newHoverdata.type == TAB && newHoverdata.horverWidget != nullptr)
+    {
+        hoverTabWidget = qobject_cast<TabWidget *>(newHoverdata.horverWidget->parent());
+    }
+    if (hoverTabWidget != nullptr && hoverTabWidget != d->sourceTabWidget)
+    {
+        PendingWindow *pending = qobject_cast<PendingWindow *>(hoverTabWidget->currentWidget());
+        if (pending != nullptr)
+        {
+            createPendingWindow(pending);
+        }
+    }
     if (d->hoverWidgetData.horverWidget == nullptr)
     {
         //when first time come here
@@ -1564,36 +2916,37 @@ void DockContainer::whenDragIngore(QPoint cursorPos)
 {
     Q_D(DockContainer);
     createTemplateForm();
-    d->templateFormOnDrag->resize(calcFloatTemplateFormSize());
-    d->templateFormOnDrag->setWindowOpacity(0.8);
-    QRect rect = d->templateFormOnDrag->rect();
+    if (!d->dropOverlay.isNull())
+    {
+        d->dropOverlay->hidePreview();
+    }
+    QSize ghostSize = calcFloatTemplateFormSize();
+    if (d->dragGhost->size() != ghostSize)
+    {
+        d->dragGhost->resize(ghostSize);
+    }
+    QRect rect(QPoint(0, 0), ghostSize);
     rect.moveCenter(cursorPos);
     rect = getNearestRectInDesktopRect(rect, cursorPos);
 
-    d->templateFormOnDrag->move(rect.topLeft());
-    d->templateFormOnDrag->raise();
-    d->templateFormOnDrag->show();
+    // Only the position of the ghost changes from one move to the next
+    d->dragGhost->move(rect.topLeft());
+    if (d->dragGhost->isHidden())
+    {
+        d->dragGhost->show();
+        d->dragGhost->raise();
+    }
 }
 
 void DockContainer::whenDragAcceptDock(QPoint cursorPos, bool isDockAtRoot)
 {
     Q_D(DockContainer);
     createTemplateForm();
-    QWidget *hoverTabWidget = d->hoverWidgetData.horverWidget;
-    if (!isDockAtRoot)
-    {
-        hoverTabWidget = getParentTabWidget(d->hoverWidgetData.horverWidget);
-    }
-    else if(!d->rootSplitterList.isEmpty() && hoverTabWidget != nullptr && hoverTabWidget->isAncestorOf(d->rootSplitterList[0]))
-    {
-        hoverTabWidget = d->rootSplitterList[0];
-    }
-    if (hoverTabWidget == nullptr)
+    if (d->hoverWidgetData.horverWidget == nullptr || !d->hoverWidgetData.hoverRect.isValid())
     {
         return;
     }
-    QPoint locatPoint = hoverTabWidget->mapFromGlobal(cursorPos);
-    RegionType type = getRegionType(locatPoint, hoverTabWidget->rect());
+    RegionType type = getGlobalRegionType(cursorPos, d->hoverWidgetData.hoverRect);
     if (type == CENTRAL)
     {
         d->hoverWidgetData.type = FLOAT;
@@ -1601,17 +2954,16 @@ void DockContainer::whenDragAcceptDock(QPoint cursorPos, bool isDockAtRoot)
     }
     else
     {
-        QRect rect = hoverTabWidget->rect();
-        rect.moveTo(hoverTabWidget->mapToGlobal(QPoint(0, 0)));
+        QRect rect = d->hoverWidgetData.hoverRect;
         switch (type)
         {
         case TOP:
             rect.setBottom(rect.top() + rect.height() / 3);
             if (isDockAtRoot)
             {
-                if (rect.height() > ROOT_DOCKED_SIZE_HINT)
+                if (rect.height() > DockModel::ROOT_DOCKED_SIZE_HINT)
                 {
-                    rect.setHeight(ROOT_DOCKED_SIZE_HINT);
+                    rect.setHeight(DockModel::ROOT_DOCKED_SIZE_HINT);
                 }
             }
             break;
@@ -1619,9 +2971,9 @@ void DockContainer::whenDragAcceptDock(QPoint cursorPos, bool isDockAtRoot)
             rect.setRight(rect.left() + rect.width() / 3);
             if (isDockAtRoot)
             {
-                if (rect.width() > ROOT_DOCKED_SIZE_HINT)
+                if (rect.width() > DockModel::ROOT_DOCKED_SIZE_HINT)
                 {
-                    rect.setWidth(ROOT_DOCKED_SIZE_HINT);
+                    rect.setWidth(DockModel::ROOT_DOCKED_SIZE_HINT);
                 }
             }
             break;
@@ -1629,9 +2981,9 @@ void DockContainer::whenDragAcceptDock(QPoint cursorPos, bool isDockAtRoot)
             rect.setLeft(rect.left() + rect.width() * 2 / 3);
             if (isDockAtRoot)
             {
-                if (rect.width() > ROOT_DOCKED_SIZE_HINT)
+                if (rect.width() > DockModel::ROOT_DOCKED_SIZE_HINT)
                 {
-                    rect.setLeft(rect.right() - ROOT_DOCKED_SIZE_HINT);
+                    rect.setLeft(rect.right() - DockModel::ROOT_DOCKED_SIZE_HINT);
                 }
             }
             break;
@@ -1639,33 +2991,45 @@ void DockContainer::whenDragAcceptDock(QPoint cursorPos, bool isDockAtRoot)
             rect.setTop(rect.top() + rect.height() * 2 / 3);
             if (isDockAtRoot)
             {
-                if (rect.height() > ROOT_DOCKED_SIZE_HINT)
+                if (rect.height() > DockModel::ROOT_DOCKED_SIZE_HINT)
                 {
-                    rect.setTop(rect.bottom() - ROOT_DOCKED_SIZE_HINT);
+                    rect.setTop(rect.bottom() - DockModel::ROOT_DOCKED_SIZE_HINT);
                 }
             }
             break;
         default:
             break;
         }
-        d->templateFormOnDrag->setGeometry(rect);
-        d->templateFormOnDrag->setWindowOpacity(1.0);
-        d->templateFormOnDrag->raise();
-        d->templateFormOnDrag->show();
+        if (!d->dragGhost->isHidden())
+        {
+            d->dragGhost->hide();
+        }
+        QWidget *window = d->hoverWidgetData.horverWidget->window();
+        if (d->dropOverlay.isNull())
+        {
+            // Born inside the hovered window, it is never a top-level widget of its own
+            d->dropOverlay = new DropPreviewOverlay(window);
+            d->dropOverlay->setTitle(d->sourceTabText);
+        }
+        d->dropOverlay->showPreview(window, rect);
     }
 }
 
 void DockContainer::createTemplateForm()
 {
     Q_D(DockContainer);
-    if (d->templateFormOnDrag == nullptr)
+    if (d->dragGhost.isNull())
+    {
+        d->dragGhost = new DropPreviewOverlay(nullptr);
+        d->dragGhost->setWindowFlags(Qt::FramelessWindowHint | Qt::WindowStaysOnTopHint
+                                     | Qt::BypassWindowManagerHint | Qt::WindowTransparentForInput);
+        d->dragGhost->setWindowOpacity(0.8);
+    }
+    if (!d->dropOverlay.isNull())
     {
-        d->templateFormOnDrag = new QTabWidget(nullptr);
-        d->templateFormOnDrag->addTab(new QWidget(), d->sourceTabText);
-        d->templateFormOnDrag->setWindowFlags(Qt::FramelessWindowHint | Qt::WindowStaysOnTopHint | Qt::BypassWindowManagerHint);
-        d->templateFormOnDrag->setAttribute(Qt::WA_TransparentForMouseEvents);
+        d->dropOverlay->setTitle(d->sourceTabText);
     }
-    d->templateFormOnDrag->setTabText(0, d->sourceTabText);
+    d->dragGhost->setTitle(d->sourceTabText);
 }
 
 QSize DockContainer::calcFloatTemplateFormSize()
@@ -1673,7 +3037,7 @@ QSize DockContainer::calcFloatTemplateFormSize()
     Q_D(DockContainer);
     int with = d->sourceTabWidget->width();
     int height = d->sourceTabWidget->height();
-    if (with < WIDGET_MIN_SIZE || height < WIDGET_MIN_SIZE)
+    if (with < DockModel::WIDGET_MIN_SIZE || height < DockModel::WIDGET_MIN_SIZE)
     {
         return QSize(with, height);
     }
@@ -1697,207 +3061,425 @@ QSize DockContainer::calcFloatTemplateFormSize()
 void DockContainer::hideTemplateForm()
 {
     Q_D(DockContainer);
-    if (d->templateFormOnDrag != nullptr)
+    if (!d->dropOverlay.isNull())
+    {
+        d->dropOverlay->hidePreview();
+    }
+    if (!d->dragGhost.isNull() && !d->dragGhost->isHidden())
+    {
+        d->dragGhost->hide();
+    }
+}
+
+DockContainer::RegionType DockContainer::getRegionType(QPoint pt, QRect rect)
+{
+    bool isInLeft = pt.x() < rect.width() / 3;
+    bool isInRight = pt.x() > rect.width() * 2 / 3;
+    bool isInTop = pt.y() < rect.height() / 3;
+    bool isInBttom = pt.y() > rect.height() * 2 / 3;
+
+    RegionType regionType;
+    if (isInLeft)
+    {
+        regionType = LEFT;
+        if (isInTop)
+        {
+            if (pt.y() < pt.x())
+            {
+                regionType = TOP;
+            }
+        }
+        else if (isInBttom)
+        {
+            if (rect.height() - pt.y() < pt.x())
+            {
+                regionType = BOTTOM;
+            }
+        }
+        return regionType;
+    }
+
+    if (isInRight)
+    {
+        RegionType regionType = RIGHT;
+        if (isInTop)
+        {
+            if (pt.y() < rect.width() - pt.x())
+            {
+                regionType = TOP;
+            }
+        }
+        else if (isInBttom)
+        {
+            if (pt.y() > pt.x())
+            {
+                regionType = BOTTOM;
+            }
+        }
+        return regionType;
+    }
+    if (isInTop)
+    {
+        return TOP;
+    }
+    if (isInBttom)
+    {
+        return BOTTOM;
+    }
+    return CENTRAL;
+}
+
+DockContainer::RegionType DockContainer::getGlobalRegionType(QPoint globalPt, QRect globalRect)
+{
+    return getRegionType(globalPt - globalRect.topLeft(), QRect(QPoint(0, 0), globalRect.size()));
+}
+
+void DockContainer::changeRootSplitter(Splitter *oldRootSplitter, Splitter *newRootSplitter)
+{
+    Q_D(DockContainer);
+    for (auto iter = d->rootSplitterList.begin(); iter != d->rootSplitterList.end(); iter++)
+    {
+        if (oldRootSplitter == *iter)
+        {
+            if (iter != d->rootSplitterList.begin())
+            {
+                (*iter)->disconnect((*iter)->parent());
+                connect(newRootSplitter, &Splitter::destroyed, oldRootSplitter->parent(), &QObject::deleteLater);
+            }
+            *iter = newRootSplitter;
+            d->dockTree.replaceRoot(oldRootSplitter, newRootSplitter);
+            break;
+        }
+    }
+}
+
+void DockContainer::onSplitterDestroyed(QObject *obj)
+{
+    Q_D(DockContainer);
+    if (d->isDisConnectAll)
+    {
+        return;
+    }
+    for (auto iter = d->rootSplitterList.begin(); iter != d->rootSplitterList.end(); iter++)
+    {
+        if (obj == *iter)
+        {
+            d->rootSplitterList.erase(iter);
+            break;
+        }
+    }
+}
+
+void DockContainer::onTabBarDestroyed(QObject *obj)
+{
+    Q_D(DockContainer);
+    if (d->isDisConnectAll)
+    {
+        return;
+    }
+    QWidget *widget = qobject_cast<QWidget*>(obj);
+    auto iter = d->tabBarSet.find(widget);
+    if (iter != d->tabBarSet.end())
+    {
+        d->tabBarSet.erase(iter);
+    }
+}
+
+void DockContainer::onTabBarCloseTab()
+{
+    Q_D(DockContainer);
+    if (d->isDisConnectAll)
+    {
+        return;
+    }
+    markLayoutChanged(d);
+    LayoutJournal::Record record;
+    if (journalLocation(d, d->contextMenuTabWidget, record.target))
+    {
+        record.operation = LayoutJournal::CLOSE;
+        record.targetIndex = d->contextMenuTabIndex;
+        appendJournal(d, record);
+    }
+    QWidget *removedWidget = d->contextMenuTabWidget->removeTabAndWidget(d->contextMenuTabIndex);
+    if (d->contextMenuTabWidget->widgetCount() == 0)
+    {
+        d->contextMenuTabWidget->deleteLater();
+    }
+    // Windows of recyclable types go back to the pool, with nothing left pointing at them
+    DockableWindow *window = qobject_cast<DockableWindow *>(removedWidget);
+    if (window != nullptr && d->dockableWindowPool->recycleWindow(window))
+    {
+        disconnect(window, &DockableWindow::destroyed, this, &DockContainer::onDockableWindowDestroyed);
+        d->dockTree.removeWindow(window);
+    }
+    else if (nullptr != removedWidget)
+    {
+        removedWidget->deleteLater();
+    }
+}
+
+void DockContainer::onAddTab(int windowType)
+{
+    Q_D(DockContainer);
+    if (asyncFactory(windowType) != nullptr && d->contextMenuTabWidget != nullptr)
+    {
+        DockModel::Tab tab;
+        tab.windowType = windowType;
+        PendingWindow *pending = createPendingPage(tab);
+        int index = d->contextMenuTabWidget->addTab(pending, pending->getTitle());
+        d->contextMenuTabWidget->setCurrentTabIndex(index);
+        markLayoutChanged(d);
+        LayoutJournal::Record record;
+        if (journalLocation(d, d->contextMenuTabWidget, record.target))
+        {
+            record.operation = LayoutJournal::TAB;
+            record.sourceIndex = windowType;
+            record.targetIndex = index;
+            appendJournal(d, record);
+        }
+        createPendingWindow(pending);
+        return;
+    }
+    auto window = d->dockableWindowPool->newWindow(windowType);
+    this->tabbedView(window, d->contextMenuTabWidget, -1, window->getTitle());
+}
+
+void DockContainer::onDockableWindowDestroyed(QObject *obj)
+{
+    Q_D(DockContainer);
+    if (d->isDisConnectAll)
+    {
+        return;
+    }
+    DockableWindow *w = static_cast<DockableWindow *>(obj);
+    d->dockableWindowPool->deleteWindow(w);
+    d->dockTree.removeWindow(w);
+}
+
+void DockContainer::onSplitterWidgetInserted(int index, QWidget *widget)
+{
+    Q_D(DockContainer);
+    Splitter *splitter = qobject_cast<Splitter *>(sender());
+    if (splitter != nullptr)
+    {
+        d->dockTree.insertChild(splitter, index, widget);
+    }
+}
+
+void DockContainer::onSplitterWidgetRemoved(QWidget *widget)
+{
+    Q_D(DockContainer);
+    Splitter *splitter = qobject_cast<Splitter *>(sender());
+    if (splitter != nullptr)
+    {
+        d->dockTree.removeChild(splitter, widget);
+    }
+}
+
+void DockContainer::onTabWidgetWindowInserted(QWidget *window)
+{
+    Q_D(DockContainer);
+    TabWidget *tabWidget = qobject_cast<TabWidget *>(sender());
+    if (tabWidget != nullptr)
     {
-        d->templateFormOnDrag->hide();
+        d->dockTree.insertWindow(tabWidget, window);
     }
 }
 
-QWidget *DockContainer::widgetAt(QPoint p)
+void DockContainer::onTabWidgetWindowRemoved(QWidget *window)
+{
+    Q_D(DockContainer);
+    d->dockTree.removeWindow(window);
+}
+
+void DockContainer::onTabCurrentWidgetChanged(QWidget *page)
 {
     Q_D(DockContainer);
-    if (d->templateFormOnDrag != nullptr)
+    TabWidget *tabWidget = qobject_cast<TabWidget *>(sender());
+    if (tabWidget == nullptr || qobject_cast<PendingWindow *>(page) == nullptr)
     {
-        d->templateFormOnDrag->setMask(QRegion(d->templateFormOnDrag->rect()));
+        return;
     }
-
-    QWidget *currentWidget = QApplication::widgetAt(p);
-
-    if (d->templateFormOnDrag != nullptr)
+    // Not created inside the stacked widget's own signal, and only if it is still shown then
+    d->pendingTabWidgets.append(tabWidget);
+    if (!d->isPendingTabsQueued)
     {
-        d->templateFormOnDrag->clearMask();
+        d->isPendingTabsQueued = true;
+        QTimer::singleShot(0, this, &DockContainer::onPendingTabsShown);
     }
+}
 
-    QWidgetList topWindowList;
-    if (nullptr == currentWidget)
-    {
-        topWindowList = QApplication::topLevelWidgets();
-    }
-    else if (qobject_cast<TabBar *>(currentWidget) == nullptr)
+void DockContainer::onPendingTabsShown()
+{
+    Q_D(DockContainer);
+    d->isPendingTabsQueued = false;
+    // Tab widgets move around while dragging, endDragging comes back here
+    if (d->isDragging)
     {
-        QWidget *topLevelWindow = currentWidget;
-        while (!topLevelWindow->isWindow() && topLevelWindow->parentWidget() != nullptr)
-        {
-            topLevelWindow = topLevelWindow->parentWidget();
-        }
-        topWindowList.append(topLevelWindow);
+        return;
     }
-
-    foreach(QWidget *widget, topWindowList)
+    QList<QPointer<TabWidget>> tabWidgets = d->pendingTabWidgets;
+    d->pendingTabWidgets.clear();
+    for (int i = 0; i < tabWidgets.size(); i++)
     {
-        if (!widget->isVisible())
-        {
-            continue;
-        }
-
-        if (widget == d->templateFormOnDrag)
+        if (tabWidgets[i].isNull())
         {
             continue;
         }
-
-        QRect expandRect = widget->frameGeometry().adjusted(-20, -20, 20, 20);
-        QRect indenRect = widget->geometry().adjusted(20, 20, -20, -20);
-        QRegion borderRegion = QRegion(expandRect) - QRegion(indenRect);
-        if (borderRegion.contains(p))
+        PendingWindow *pending = qobject_cast<PendingWindow *>(tabWidgets[i]->currentWidget());
+        if (pending != nullptr)
         {
-            return widget;
+            createPendingWindow(pending);
         }
     }
-    return currentWidget;
 }
 
-DockContainer::RegionType DockContainer::getRegionType(QPoint pt, QRect rect)
+void DockContainer::onPendingWindowPrepared()
 {
-    bool isInLeft = pt.x() < rect.width() / 3;
-    bool isInRight = pt.x() > rect.width() * 2 / 3;
-    bool isInTop = pt.y() < rect.height() / 3;
-    bool isInBttom = pt.y() > rect.height() * 2 / 3;
-
-    RegionType regionType;
-    if (isInLeft)
-    {
-        regionType = LEFT;
-        if (isInTop)
-        {
-            if (pt.y() < pt.x())
-            {
-                regionType = TOP;
-            }
-        }
-        else if (isInBttom)
-        {
-            if (rect.height() - pt.y() < pt.x())
-            {
-                regionType = BOTTOM;
-            }
-        }
-        return regionType;
-    }
-
-    if (isInRight)
-    {
-        RegionType regionType = RIGHT;
-        if (isInTop)
-        {
-            if (pt.y() < rect.width() - pt.x())
-            {
-                regionType = TOP;
-            }
-        }
-        else if (isInBttom)
-        {
-            if (pt.y() > pt.x())
-            {
-                regionType = BOTTOM;
-            }
-        }
-        return regionType;
-    }
-    if (isInTop)
+    Q_D(DockContainer);
+    PendingWindow *pending = qobject_cast<PendingWindow *>(sender());
+    if (pending == nullptr)
     {
-        return TOP;
+        return;
     }
-    if (isInBttom)
+    if (d->isDragging)
     {
-        return BOTTOM;
+        d->preparedWindows.append(pending);
+        return;
     }
-    return CENTRAL;
+    createPendingWindow(pending);
 }
 
-void DockContainer::changeRootSplitter(Splitter *oldRootSplitter, Splitter *newRootSplitter)
+void DockContainer::onSplitterHandleReleased()
 {
     Q_D(DockContainer);
-    for (auto iter = d->rootSplitterList.begin(); iter != d->rootSplitterList.end(); iter++)
+    Splitter *splitter = qobject_cast<Splitter *>(sender());
+    markLayoutChanged(d);
+    LayoutJournal::Record record;
+    if (journalLocation(d, splitter, record.target))
     {
-        if (oldRootSplitter == *iter)
-        {
-            if (iter != d->rootSplitterList.begin())
-            {
-                (*iter)->disconnect((*iter)->parent());
-                connect(newRootSplitter, &Splitter::destroyed, oldRootSplitter->parent(), &QObject::deleteLater);
-            }
-            *iter = newRootSplitter;
-            break;
-        }
+        record.operation = LayoutJournal::RESIZE;
+        record.sizes = splitter->sizes();
+        appendJournal(d, record);
     }
 }
 
-void DockContainer::onSplitterDestroyed(QObject *obj)
+void DockContainer::onFloatWindowDestroyed(QObject *obj)
 {
     Q_D(DockContainer);
-    if (d->isDisConnectAll)
+    markLayoutChanged(d);
+    if (d->isDisConnectAll || !d->journal.isOpen())
     {
         return;
     }
-    for (auto iter = d->rootSplitterList.begin(); iter != d->rootSplitterList.end(); iter++)
+    // Still listed only when the user closed it; a window emptied by a drag lost its root splitter first
+    for (int i = 1; i < d->rootSplitterList.size(); i++)
     {
-        if (obj == *iter)
+        if (d->rootSplitterList[i]->parent() == obj)
         {
-            d->rootSplitterList.erase(iter);
+            LayoutJournal::Record record;
+            record.operation = LayoutJournal::CLOSE_WINDOW;
+            record.target.window = i;
+            appendJournal(d, record);
             break;
         }
     }
 }
 
-void DockContainer::onTabBarDestroyed(QObject *obj)
+void DockContainer::onWindowStateMarkedDirty()
 {
     Q_D(DockContainer);
-    if (d->isDisConnectAll)
+    markLayoutChanged(d);
+}
+
+void DockContainer::onJournalSizesTimeout()
+{
+    Q_D(DockContainer);
+    if (!d->journal.isOpen())
     {
         return;
     }
-    QWidget *widget = qobject_cast<QWidget*>(obj);
-    auto iter = d->tabBarSet.find(widget);
-    if (iter != d->tabBarSet.end())
+    // A maximized tab or a drag leaves the sizes of the tree as they are not meant to stay
+    if (d->isDragging || d->maxmizedWindow != nullptr)
     {
-        d->tabBarSet.erase(iter);
+        d->journalSizesTimer->start(d->journalCompactTimer->interval());
+        return;
+    }
+    for (int i = 0; i < d->rootSplitterList.size(); i++)
+    {
+        LayoutJournal::Record record;
+        record.operation = LayoutJournal::SIZES;
+        record.target.window = i;
+        collectJournalSizes(d->rootSplitterList[i], record.sizes);
+        appendJournal(d, record);
     }
 }
 
-void DockContainer::onTabBarCloseTab()
+void DockContainer::onFocusWindowChanged(QWindow *window)
 {
     Q_D(DockContainer);
-    if (d->isDisConnectAll)
+    d->windowActivationOrder.removeAll(QPointer<QWindow>());
+    if (window == nullptr)
     {
         return;
     }
-    QWidget *removedWidget = d->contextMenuTabWidget->removeTabAndWidget(d->contextMenuTabIndex);
-    if (d->contextMenuTabWidget->widgetCount() == 0)
+    d->windowActivationOrder.removeAll(window);
+    d->windowActivationOrder.append(window);
+}
+
+void DockContainer::onRestoreTimeout()
+{
+    Q_D(DockContainer);
+    if (d->isDragging)
     {
-        d->contextMenuTabWidget->deleteLater();
+        d->restoreTimer->start(0);
+        return;
     }
-    if (nullptr != removedWidget)
+    // At least one window per slice, then as many as fit in the frame budget
+    QElapsedTimer elapsed;
+    elapsed.start();
+    while (!d->restoreQueue.isEmpty())
     {
-        removedWidget->deleteLater();
+        QPointer<PendingWindow> pending = d->restoreQueue.takeFirst();
+        // Gone when it was activated or its layout replaced before its turn
+        if (!pending.isNull())
+        {
+            createPendingWindow(pending);
+        }
+        d->restoreCreated++;
+        emit layoutRestoreProgress(d->restoreCreated, d->restoreTotal);
+        if (elapsed.elapsed() >= d->restoreFrameBudget)
+        {
+            break;
+        }
+    }
+    if (d->restoreQueue.isEmpty())
+    {
+        emit layoutRestoreFinished();
+    }
+    else
+    {
+        d->restoreTimer->start(0);
     }
 }
 
-void DockContainer::onAddTab(int windowType)
+void DockContainer::onDockNodeDestroyed(QObject *obj)
 {
     Q_D(DockContainer);
-    auto window = d->dockableWindowPool->newWindow(windowType);
-    this->tabbedView(window, d->contextMenuTabWidget, -1, window->getTitle());
+    if (d->isDisConnectAll)
+    {
+        return;
+    }
+    d->dockTree.removeNode(static_cast<QWidget *>(obj));
 }
 
-void DockContainer::onDockableWindowDestroyed(QObject *obj)
+void DockContainer::onDragMoveReady(const QPoint &globalPos)
 {
     Q_D(DockContainer);
-    if (d->isDisConnectAll)
+    if (d->isDragging)
     {
-        return;
+        showDragging(globalPos);
     }
-    DockableWindow *w = static_cast<DockableWindow *>(obj);
-    d->dockableWindowPool->deleteWindow(w);
 }
 
 void DockContainer::onTabMaxmized()
@@ -1966,16 +3548,12 @@ QWidget *DockContainer::rootWidgetAt(QPoint pt)
 QWidget *DockContainer::rootWidgetof(QWidget *childWidget)
 {
     Q_D(DockContainer);
-    Splitter *rootSplitter = getRootSplitter(childWidget);
-    if (nullptr != rootSplitter)
+    if (nullptr == childWidget)
     {
-        if (!d->rootSplitterList.isEmpty() && rootSplitter == d->rootSplitterList[0])
-        {
-            return d->parentWidget;
-        }
-        return rootSplitter;
+        return nullptr;
     }
-    return nullptr;
+    // The main root is registered with the parent widget, floating roots report their root splitter
+    return d->dockTree.rootWidget(childWidget);
 }
 
 void DockContainer::enableDrag(bool bEnable)
@@ -1987,48 +3565,212 @@ void DockContainer::enableDrag(bool bEnable)
 DockableWindow* DockContainer::getFirstVisibleWindow(uint type)
 {
     Q_D(DockContainer);
-    return d->dockableWindowPool->getFistVisibleWindow(type);
+    DockableWindow *window = d->dockableWindowPool->getFistVisibleWindow(type);
+    if (window == nullptr)
+    {
+        PendingWindow *pending = findPendingWindow(type);
+        if (pending != nullptr)
+        {
+            window = createPendingWindow(pending);
+        }
+    }
+    return window;
 }
 
-void DockContainer::initLayout()
+DockableWindow *DockContainer::findWindow(uint type, int windowId) const
+{
+    Q_D(const DockContainer);
+    return d->dockableWindowPool->findWindow(type, windowId);
+}
+
+int DockContainer::windowId(DockableWindow *window) const
+{
+    Q_D(const DockContainer);
+    return d->dockableWindowPool->windowID(window);
+}
+
+void DockContainer::setHiddenWindowBudget(int maxWindows, qint64 maxBytes)
 {
     Q_D(DockContainer);
-    //clear
-    d->dockableWindowPool->hideAllWindowsBeforeChangeLayout();
-    d->tabBarSet.clear();
-    d->rootSplitterList.clear();
-    if (nullptr != d->dockRootWidget)
+    d->dockableWindowPool->setHiddenWindowBudget(maxWindows, maxBytes);
+    d->dockableWindowPool->trimHiddenWindows();
+}
+
+void DockContainer::setHiddenWindowLimit(uint type, int maxWindows)
+{
+    Q_D(DockContainer);
+    d->dockableWindowPool->setHiddenWindowLimit(type, maxWindows);
+    d->dockableWindowPool->trimHiddenWindows();
+}
+
+void DockContainer::setWindowReserve(uint type, int count)
+{
+    Q_D(DockContainer);
+    d->dockableWindowPool->setReserveSize(type, count);
+    d->reserveTimer->start(0);
+}
+
+QHash<uint, WindowReserveStats> DockContainer::windowReserveStats() const
+{
+    Q_D(const DockContainer);
+    return d->dockableWindowPool->reserveStats();
+}
+
+void DockContainer::onReserveTimeout()
+{
+    Q_D(DockContainer);
+    // Creating a window is not cheap, it waits while a drag or a restore has the frames
+    if (d->isDragging || isRestoring())
     {
-        d->parentWidget->layout()->removeWidget(d->dockRootWidget);
-        delete d->dockRootWidget;
+        d->reserveTimer->start(100);
+        return;
     }
-    d->dockRootWidget = new QWidget();
-    d->parentWidget->layout()->addWidget(d->dockRootWidget);
-    d->dockRootWidget->setObjectName("DockRootWidget");
-    QHBoxLayout* carrierlaytout = new QHBoxLayout(d->dockRootWidget);
-    carrierlaytout->setSpacing(0);
-    carrierlaytout->setContentsMargins(0, 0, 0, 0);
+    if (d->dockableWindowPool->refillReserve())
+    {
+        d->reserveTimer->start(0);
+    }
+}
 
-    //根分割窗口,水平方向
-    Splitter *mainRootSplitter = createSplitterWidget();
-    mainRootSplitter->setOrientation(Qt::Horizontal);
-    connect(mainRootSplitter, &Splitter::destroyed, this, &DockContainer::onSplitterDestroyed);
-    carrierlaytout->addWidget(mainRootSplitter);
-    d->rootSplitterList.append(mainRootSplitter);
+void DockContainer::setFramePacedDrag(bool enable)
+{
+    Q_D(DockContainer);
+    d->isFramePacedDrag = enable;
+    d->dragFramePacer->setEnabled(enable);
+    for (int i = 0; i < d->rootSplitterList.size(); i++)
+    {
+        Splitter *rootSplitter = d->rootSplitterList[i];
+        rootSplitter->setFramePacedResize(enable);
+        QList<Splitter *> splitters = rootSplitter->findChildren<Splitter *>();
+        for (int j = 0; j < splitters.size(); j++)
+        {
+            splitters[j]->setFramePacedResize(enable);
+        }
+    }
+}
+
+const DragFramePacer *DockContainer::dragFramePacer() const
+{
+    Q_D(const DockContainer);
+    return d->dragFramePacer;
+}
+
+void DockContainer::setIncrementalLayout(bool enable)
+{
+    Q_D(DockContainer);
+    d->isIncrementalLayout = enable;
+}
+
+void DockContainer::setLazyTabs(bool enable)
+{
+    Q_D(DockContainer);
+    d->isLazyTabs = enable;
+}
+
+void DockContainer::setProgressiveRestore(bool enable)
+{
+    Q_D(DockContainer);
+    d->isProgressiveRestore = enable;
+}
+
+void DockContainer::setRestoreFrameBudget(int msec)
+{
+    Q_D(DockContainer);
+    d->restoreFrameBudget = qMax(0, msec);
+}
+
+bool DockContainer::isRestoring() const
+{
+    Q_D(const DockContainer);
+    return d->restoreTimer->isActive();
+}
+
+bool DockContainer::openJournal(const QString &fileName)
+{
+    Q_D(DockContainer);
+    closeJournal();
+    DockModel model;
+    bool isRecovered = LayoutJournal::replay(fileName, model) && !model.isEmpty();
+    if (isRecovered)
+    {
+        createLayoutFromModel(model);
+    }
+    if (!d->journal.open(fileName))
+    {
+        return isRecovered;
+    }
+    compactJournal();
+    return isRecovered;
+}
+
+void DockContainer::closeJournal()
+{
+    Q_D(DockContainer);
+    d->journalCompactTimer->stop();
+    d->journalSizesTimer->stop();
+    d->journal.close(true);
+}
+
+void DockContainer::setJournalCompactThreshold(int records)
+{
+    Q_D(DockContainer);
+    d->journalCompactThreshold = qMax(1, records);
+}
+
+void DockContainer::compactJournal()
+{
+    Q_D(DockContainer);
+    d->journalCompactTimer->stop();
+    if (!d->journal.isOpen())
+    {
+        return;
+    }
+    // A snapshot must not see a drag half done, so try again later
+    if (d->isDragging)
+    {
+        d->journalCompactTimer->start();
+        return;
+    }
+    DockModel model;
+    saveLayoutToModel(model);
+    QSize mainWindowSize = d->rootSplitterList.isEmpty() ? QSize() : d->rootSplitterList[0]->size();
+    d->journal.compact(model, mainWindowSize);
+}
 
-    Splitter *splitter_1 = createSplitterWidget();
-    splitter_1->setOrientation(Qt::Vertical);
-    mainRootSplitter->addWidget(splitter_1);
+bool DockContainer::createLayoutFromPreset(const LayoutPreset &preset)
+{
+    DockModel model;
+    if (!preset.toModel(model))
+    {
+        return false;
+    }
+    createLayoutFromModel(model);
+    return true;
+}
 
-    //默认窗口
-    TabWidget *tabWidget_1_1 = createTabWidget();
-    splitter_1->addWidget(tabWidget_1_1);
-    DockableWindow *fiterWindow = d->dockableWindowPool->newWindow();
-    if (fiterWindow != nullptr)
+void DockContainer::initLayout()
+{
+    //根分割窗口,水平方向; 默认窗口
+    static constexpr const char *defaultWindows[] = {nullptr};
+    static constexpr LayoutPresetNode defaultNodes[] = {
+        presetSplitter(Qt::Horizontal, 1, 1),
+            presetSplitter(Qt::Vertical, 1, 1),
+                presetTabGroup(1, defaultWindows)
+    };
+    static constexpr LayoutPreset defaultPreset = layoutPreset("Default", defaultNodes);
+    static_assert(isValidLayoutPreset(defaultPreset), "malformed default layout");
+    if (createLayoutFromPreset(defaultPreset))
     {
-        connect(fiterWindow, &DockableWindow::destroyed, this, &DockContainer::onDockableWindowDestroyed);
-        tabWidget_1_1->addTab(fiterWindow, fiterWindow->getTitle());
+        return;
     }
+    // No window registered yet: the same tree with an empty tab group
+    DockModel model;
+    DockModel::NodeId mainRootSplitter = model.createSplitter(Qt::Horizontal);
+    DockModel::NodeId splitter_1 = model.createSplitter(Qt::Vertical);
+    DockModel::NodeId tabGroup_1_1 = model.createTabGroup();
+    model.appendChild(mainRootSplitter, splitter_1, 1);
+    model.appendChild(splitter_1, tabGroup_1_1, 1);
+    model.addWindow(mainRootSplitter);
+    createLayoutFromModel(model);
 }
 
 }
\ No newline at end of file
@@ -11,31 +11,73 @@
 #define DOCKCONTAINER_H
 
 #include "dock_global.h"
+#include "DockModel.h"
+#include "DockableWindowPool.h"
 #include <memory>
 
 #include <QObject>
 #include <QSet>
+#include <QHash>
 #include <QRect>
 #include <QPoint>
 
-class QTabWidget;
 class QMenu;
+class QWindow;
 
 namespace dock {
 class TabWidget;
 class TabBar;
 class LayoutManager;
 class DockableWindow;
-class DockableWindowPool;
 class Splitter;
+class DragFramePacer;
+class PendingWindow;
+class StateStore;
+class LayoutLibrary;
+struct LayoutPreset;
 
 class DockContainerPrivate;
 
+struct LayoutCacheStats
+{
+    int hits;
+    int misses;
+    int evictions;
+    LayoutCacheStats() : hits(0), misses(0), evictions(0) {}
+};
+
+// Window states gathered by one layout snapshot, for one window type
+struct WindowStateStats
+{
+    int serialized;     // saveObject calls
+    int reused;         // clean windows whose last saved state was taken as is
+    qint64 nsecs;       // spent in saveObject
+    WindowStateStats() : serialized(0), reused(0), nsecs(0) {}
+};
+
+// Background saves: the GUI thread only takes the snapshot, the rest runs on a worker
+struct LayoutSaveStats
+{
+    int saves;                  // files written
+    int skipped;                // unchanged layouts, nothing written
+    int failures;
+    qint64 lastBlockedNsecs;    // GUI thread time of the last snapshot
+    qint64 maxBlockedNsecs;
+    qint64 lastWriteNsecs;      // worker time to encode, compress and write it
+    LayoutSaveStats() : saves(0), skipped(0), failures(0), lastBlockedNsecs(0), maxBlockedNsecs(0), lastWriteNsecs(0) {}
+};
+
 class DOCKSHARED_EXPORT DockContainer : public QObject
 {
     Q_OBJECT
     Q_DECLARE_PRIVATE(DockContainer)
 public:
+    enum LayoutFormat
+    {
+        JSON_LAYOUT,
+        CBOR_LAYOUT
+    };
+
     explicit DockContainer(QWidget *parent = nullptr);
     virtual ~DockContainer();
 
@@ -44,12 +86,90 @@ public:
     void floatView(uint nWindowType);
     void activeView(uint nWindowType);
 
-    void saveLayoutToJson(QJsonObject &jsonObj);
+    // Saving returns false and writes nothing if the layout still has savedFingerprint, the one
+    // in the header of the file it would replace. Creating a layout whose header fingerprint is
+    // that of the live layout leaves the widgets alone
+    bool saveLayoutToJson(QJsonObject &jsonObj, const QByteArray &savedFingerprint = QByteArray());
     void createLayoutFromJson(const QJsonObject &jsonObj);
+    // Binary form of the same layout, see DockModel::toCbor; a rejected buffer leaves the layout as it is
+    bool saveLayoutToCbor(QByteArray &data, const QByteArray &savedFingerprint = QByteArray());
+    bool createLayoutFromCbor(const QByteArray &data);
+    // Kept from the last load or save until a dock operation, a resize or DockableWindow::markStateDirty
+    QByteArray layoutFingerprint();
+    // Snapshot the layout now, encode it, optionally qCompress it and replace fileName through
+    // QSaveFile on a worker; saves run one at a time in call order and end with layoutSaved.
+    // The worker reads the fingerprint of the file there is and writes nothing if it is unchanged
+    void saveLayoutInBackground(const QString &fileName, LayoutFormat format, bool isCompressed = false);
+    // Blocks until every background save is on disk, for shutdown
+    void waitForBackgroundSaves();
+    LayoutSaveStats layoutSaveStats() const;
+    // Layout file contents as saved, uncompressed if saveLayoutInBackground compressed them
+    static QByteArray uncompressLayout(const QByteArray &data);
+    // With a store, saved layouts reference the window states kept in it instead of embedding
+    // them, and a referenced state is read when its window is created. Evicted hidden windows
+    // keep their states there too. Not owned
+    void setStateStore(StateStore *store);
+    StateStore *stateStore() const;
+    // The container is a view of a DockModel: snapshot the widgets into one, or build widgets from one
+    void saveLayoutToModel(DockModel &model);
+    void createLayoutFromModel(const DockModel &model);
+    // A layout compiled into the program, see LayoutPreset.h; false if it names an unknown window
+    bool createLayoutFromPreset(const LayoutPreset &preset);
+    // By window type, what the last snapshot spent on window states
+    QHash<uint, WindowStateStats> windowStateStats() const;
     void enableDrag(bool bEnable);
 
     virtual void initLayout();
     DockableWindow* getFirstVisibleWindow(uint type);
+    // Window ids are the stable handles layouts store, see DockableWindowPool
+    DockableWindow *findWindow(uint type, int windowId) const;
+    int windowId(DockableWindow *window) const;
+    // Bounds the windows kept hidden for later layouts, see DockableWindowPool::setHiddenWindowBudget
+    void setHiddenWindowBudget(int maxWindows, qint64 maxBytes);
+    void setHiddenWindowLimit(uint type, int maxWindows);
+    // Keeps count instances of a non-unique type created ahead, refilled when the event loop is idle
+    void setWindowReserve(uint type, int count);
+    QHash<uint, WindowReserveStats> windowReserveStats() const;
+
+    // Coalesce tab drags and splitter handle drags to one evaluation per display frame
+    void setFramePacedDrag(bool enable);
+    const DragFramePacer *dragFramePacer() const;
+
+    // Patch the live widget tree towards a new layout instead of rebuilding it
+    void setIncrementalLayout(bool enable);
+    // Restore background tabs as placeholders, their windows are created when first shown
+    void setLazyTabs(bool enable);
+    // Show the skeleton of a new layout at once and create its windows over the following
+    // event loop turns, spending at most msec per turn
+    void setProgressiveRestore(bool enable);
+    void setRestoreFrameBudget(int msec);
+    bool isRestoring() const;
+
+    // Named layouts stay built but hidden when switching away, up to limit of them (0 disables)
+    void createLayoutFromJson(const QJsonObject &jsonObj, const QString &layoutName);
+    bool createLayoutFromCbor(const QByteArray &data, const QString &layoutName);
+    bool switchToCachedLayout(const QString &layoutName);
+    void setLayoutCacheLimit(int limit);
+    int layoutCacheLimit() const;
+    void clearLayoutCache();
+    LayoutCacheStats layoutCacheStats() const;
+
+    // A named layout in a layout library: saving skips an entry that still holds the live
+    // layout, creating reads that entry alone and is cached under its name like the above
+    bool saveLayoutToLibrary(LayoutLibrary &library, const QString &layoutName);
+    // saveLayoutToLibrary on the save thread; the library is its until layoutSaved or waitForBackgroundSaves
+    void saveLayoutToLibraryInBackground(LayoutLibrary &library, const QString &layoutName);
+    bool createLayoutFromLibrary(const LayoutLibrary &library, const QString &layoutName);
+
+    // Crash-safe autosave: every dock operation is appended to fileName behind a snapshot of the
+    // layout, which is rewritten after threshold operations. Opening first replays what an earlier
+    // session left there and returns true if that gave a layout; closing removes the file
+    bool openJournal(const QString &fileName);
+    void closeJournal();
+    void setJournalCompactThreshold(int records);
+
+public slots:
+    void compactJournal();
 
 private slots:
     void onSplitterDestroyed(QObject *obj);
@@ -58,9 +178,29 @@ private slots:
     void onAddTab(int windowType);
     void onDockableWindowDestroyed(QObject *obj);
     void onTabMaxmized();
+    void onDragMoveReady(const QPoint &globalPos);
+    void onSplitterWidgetInserted(int index, QWidget *widget);
+    void onSplitterWidgetRemoved(QWidget *widget);
+    void onTabWidgetWindowInserted(QWidget *window);
+    void onTabWidgetWindowRemoved(QWidget *window);
+    void onDockNodeDestroyed(QObject *obj);
+    void onTabCurrentWidgetChanged(QWidget *page);
+    void onPendingTabsShown();
+    void onRestoreTimeout();
+    void onReserveTimeout();
+    void onPendingWindowPrepared();
+    void onSplitterHandleReleased();
+    void onFloatWindowDestroyed(QObject *obj);
+    void onWindowStateMarkedDirty();
+    void onJournalSizesTimeout();
+    void onFocusWindowChanged(QWindow *window);
 
 signals:
     void newLayoutAdded();
+    void layoutRestoreProgress(int created, int total);
+    void layoutRestoreFinished();
+    // fileName is the layout name for a save to a library
+    void layoutSaved(const QString &fileName, bool isWritten);
 
 protected:
     QWidget *rootWidgetAt(QPoint pt);
@@ -104,7 +244,6 @@ protected:
     void dockAtRootSplitterLeft(TabWidget *newTabWidget, Splitter *rootSplitter);
     void dockAtRootSplitterRight(TabWidget *newTabWidget, Splitter *rootSplitter);
     void dockAtRootSplitterBottom(TabWidget *newTabWidget, Splitter *rootSplitter);
-    QList<int> recalcRootSplitterSizesAfterAddNew(QList<int> oldSizes, int newItem, bool isToHead);
     bool isLastTabInMainWindow(TabBar* tabBar);
 
     Splitter *getParentSplitter(QWidget *widget);
@@ -129,17 +268,17 @@ protected:
     {
         DragAcceptType type;
         QWidget *horverWidget;
+        QRect hoverRect;    // global rect the drop region is measured against
         HoverWidgetData()
         {
             type = FLOAT;
             horverWidget = nullptr;
         }
     };
+    void buildDropTargetIndex();
     void getHoverWidgetData(QPoint curPos, HoverWidgetData &data);
     void onHoverWidgetChanged(QPoint curPos, HoverWidgetData &newData);
 
-    QWidget *widgetAt(QPoint gloabPos);
-
     enum RegionType
     {
         LEFT,
@@ -157,11 +296,40 @@ protected:
     };
 
     RegionType getRegionType(QPoint pt, QRect rect);
+    RegionType getGlobalRegionType(QPoint globalPt, QRect globalRect);
     
-    Splitter *createSplitterFromJson(const QJsonObject &jsonObj);
-    void saveSplitterToJson(Splitter *splitter, QJsonObject &jsonObj);
-    TabWidget *createTabWidgetFromJson(const QJsonObject &jsonObj);
-    void saveTabWidgetToJson(TabWidget *tabWidget, Qt::Orientation orient, QJsonObject &jsonObj);
+    Splitter *createSplitterFromModel(const DockModel &model, DockModel::NodeId id);
+    DockModel::NodeId saveSplitterToModel(Splitter *splitter, DockModel &model);
+    TabWidget *createTabWidgetFromModel(const DockModel &model, DockModel::NodeId id);
+    DockModel::NodeId saveTabWidgetToModel(TabWidget *tabWidget, DockModel &model);
+    void createFloatWindowFromModel(const DockModel &model, int windowIndex);
+    DockableWindow *acquireWindow(const DockModel::Tab &tab);
+    void loadWindow(DockableWindow *window, const DockModel::Tab &tab);
+    QJsonObject tabState(const DockModel::Tab &tab) const;
+    void buildLayoutFromModel(const DockModel &model);
+    bool isDeferredTab(const DockModel::Node &node, int tabIndex);
+    void scheduleProgressiveRestore();
+    void addTabFromModel(TabWidget *tabWidget, const DockModel::Tab &tab, DockableWindow *window, bool isPending);
+    PendingWindow *createPendingPage(const DockModel::Tab &tab);
+    DockableWindow *createPendingWindow(PendingWindow *pending);
+    PendingWindow *findPendingWindow(uint type);
+    void clearTabWidget(TabWidget *tabWidget);
+
+    bool isLiveLayout(const QByteArray &fingerprint);
+    bool canReconcileLayout(const DockModel &model);
+    void reconcileLayout(const DockModel &model);
+    void matchLayoutNode(QWidget *existing, const DockModel &model, DockModel::NodeId id,
+                         QHash<DockModel::NodeId, QWidget *> &matched);
+    void reconcileSplitter(Splitter *splitter, const DockModel &model, DockModel::NodeId id,
+                           const QHash<DockModel::NodeId, QWidget *> &matched, QList<QWidget *> &garbage);
+    void reconcileTabWidget(TabWidget *tabWidget, const DockModel &model, DockModel::NodeId id);
+    void collectPlacedWindows(QWidget *widget, QList<DockableWindow *> &windows);
+    void collectTabWidgets(QWidget *widget, QList<TabWidget *> &tabWidgets);
+
+    void releaseCurrentLayout();
+    bool stashCurrentLayout();
+    void restoreCachedLayout(int index);
+    void evictCachedLayout(int index);
 
 protected:
     DockContainer(DockContainerPrivate &dd, QWidget *parent = nullptr);
@@ -0,0 +1,1379 @@
+#include <QJsonArray>
+#include <QCborStreamWriter>
+#include <QCborStreamReader>
+#include <QCborValue>
+#include <QCborMap>
+#include <QCryptographicHash>
+#include <QJsonDocument>
+#include <QtEndian>
+#include <algorithm>
+
+#include "DockModel.h"
+#include "StateStore.h"
+
+namespace dock {
+
+const int DockModel::WIDGET_MIN_SIZE;
+const int DockModel::ROOT_DOCKED_SIZE_HINT;
+
+const int HANDLE_WIDTH = 4;
+const int VIEW_WIDGET_TYPE = 2;
+
+const QString c_strWidgetType           = "WidgetType";
+const QString c_strOrientation          = "Orientation";
+const QString c_strSize                 = "Size";
+const QString c_strSplitter             = "Splitter";
+const QString c_strTabWidget            = "TabWidget";
+const QString c_strFloatWindowChildren  = "FloatWindowChildren";
+const QString c_strSplitterChildren     = "SplitterChildren";
+const QString c_strTabWidgetChildren    = "TabWidgetChildren";
+const QString c_strWindowType           = "WindowType";
+const QString c_strWindowID             = "WindowID";
+const QString c_strWindowName           = "WindowName";
+const QString c_strMainWindow           = "MainWindow";
+const QString c_strGeometry             = "Geometry";
+const QString c_strLeft                 = "Left";
+const QString c_strTop                  = "Top";
+const QString c_strWidth                = "Width";
+const QString c_strHeight               = "Height";
+const QString c_strCurrentTabIndex      = "CurrentTabIndex";
+const QString c_strFingerprint          = "Fingerprint";
+const QString c_strStateRef             = "StateRef";
+
+// CBOR layout: a tagged map of integer keys, every list an array in order
+const quint64 LAYOUT_CBOR_TAG = 0x646f636b;   // "dock"
+
+enum LayoutCborKey
+{
+    KEY_VERSION = 0,
+    KEY_WINDOWS = 1,
+    KEY_FINGERPRINT = 2,        // before the windows, so reading it stops early
+
+    KEY_WINDOW_GEOMETRY = 0,
+    KEY_WINDOW_ROOT = 1,
+
+    KEY_NODE_KIND = 0,          // always first, the reader creates the node from it
+    KEY_NODE_ORIENTATION = 1,
+    KEY_NODE_SIZES = 2,         // before the children, which are appended as they are read
+    KEY_NODE_CHILDREN = 3,
+    KEY_NODE_CURRENT_INDEX = 4,
+    KEY_NODE_TABS = 5,
+
+    KEY_TAB_WINDOW_TYPE = 0,
+    KEY_TAB_WINDOW_ID = 1,
+    KEY_TAB_STATE = 2,
+    KEY_TAB_STATE_REF = 3       // instead of KEY_TAB_STATE
+};
+
+static void addIntToHash(QCryptographicHash &hash, qint64 value)
+{
+    value = qToLittleEndian(value);
+    hash.addData(QByteArrayView(reinterpret_cast<const char *>(&value), sizeof(value)));
+}
+
+static void addRectToHash(QCryptographicHash &hash, const QRect &rect)
+{
+    addIntToHash(hash, rect.left());
+    addIntToHash(hash, rect.top());
+    addIntToHash(hash, rect.width());
+    addIntToHash(hash, rect.height());
+}
+
+static bool readCborInteger(QCborStreamReader &reader, qint64 &value)
+{
+    if (!reader.isInteger())
+    {
+        reader.next();
+        return false;
+    }
+    value = reader.toInteger();
+    reader.next();
+    return true;
+}
+
+static void readCborIntegers(QCborStreamReader &reader, QList<int> &values)
+{
+    if (!reader.isArray())
+    {
+        reader.next();
+        return;
+    }
+    reader.enterContainer();
+    while (reader.lastError() == QCborError::NoError && reader.hasNext())
+    {
+        qint64 value = 0;
+        readCborInteger(reader, value);
+        values.append((int)value);
+    }
+    reader.leaveContainer();
+}
+
+// "child_%1_..." and "Tab_%1_..." members in the order of their index, not of their key
+static QList<QJsonObject> orderedJsonChildren(const QJsonObject &children)
+{
+    QList<QPair<int, QJsonObject>> indexed;
+    for (auto iter = children.begin(); iter != children.end(); iter++)
+    {
+        indexed.append(qMakePair(iter.key().section('_', 1, 1).toInt(), iter.value().toObject()));
+    }
+    std::stable_sort(indexed.begin(), indexed.end(),
+                     [](const QPair<int, QJsonObject> &a, const QPair<int, QJsonObject> &b) { return a.first < b.first; });
+    QList<QJsonObject> ordered;
+    for (int i = 0; i < indexed.size(); i++)
+    {
+        ordered.append(indexed[i].second);
+    }
+    return ordered;
+}
+
+static QJsonObject geometryToJson(const QRect &rect)
+{
+    QJsonObject geometryObj;
+    geometryObj.insert(c_strLeft, rect.left());
+    geometryObj.insert(c_strTop, rect.top());
+    geometryObj.insert(c_strWidth, rect.width());
+    geometryObj.insert(c_strHeight, rect.height());
+    return geometryObj;
+}
+
+static QRect geometryFromJson(const QJsonObject &geometryObj)
+{
+    return QRect(geometryObj.value(c_strLeft).toInt(),
+                 geometryObj.value(c_strTop).toInt(),
+                 geometryObj.value(c_strWidth).toInt(),
+                 geometryObj.value(c_strHeight).toInt());
+}
+
+static Qt::Orientation regionOrientation(DockModel::Region region)
+{
+    return (region == DockModel::LEFT || region == DockModel::RIGHT) ? Qt::Horizontal : Qt::Vertical;
+}
+
+static bool isRegionBefore(DockModel::Region region)
+{
+    return region == DockModel::LEFT || region == DockModel::TOP;
+}
+
+DockModel::DockModel()
+    : _handleWidth(HANDLE_WIDTH)
+    , _minimumSize(WIDGET_MIN_SIZE)
+    , _maximizedGroup(INVALID_NODE)
+    , _maximizedTab(-1)
+{
+}
+
+void DockModel::clear()
+{
+    _nodes.clear();
+    _freeNodes.clear();
+    _windows.clear();
+    _maximizedGroup = INVALID_NODE;
+    _maximizedTab = -1;
+}
+
+DockModel::NodeId DockModel::allocNode(NodeKind kind)
+{
+    Node node;
+    node.kind = kind;
+    node.parent = INVALID_NODE;
+    node.isAlive = true;
+    node.orientation = Qt::Horizontal;
+    node.currentIndex = -1;
+
+    NodeId id;
+    if (!_freeNodes.isEmpty())
+    {
+        id = _freeNodes.takeLast();
+        _nodes[id] = node;
+    }
+    else
+    {
+        id = _nodes.size();
+        _nodes.append(node);
+    }
+    return id;
+}
+
+void DockModel::freeNode(NodeId id)
+{
+    _nodes[id] = Node();
+    _nodes[id].isAlive = false;
+    _nodes[id].parent = INVALID_NODE;
+    _freeNodes.append(id);
+}
+
+void DockModel::freeSubtree(NodeId id)
+{
+    QList<NodeId> children = _nodes.at(id).children;
+    for (int i = 0; i < children.size(); i++)
+    {
+        freeSubtree(children.at(i));
+    }
+    freeNode(id);
+}
+
+DockModel::NodeId DockModel::createSplitter(Qt::Orientation orientation)
+{
+    NodeId id = allocNode(SPLITTER);
+    _nodes[id].orientation = orientation;
+    return id;
+}
+
+DockModel::NodeId DockModel::createTabGroup()
+{
+    return allocNode(TAB_GROUP);
+}
+
+void DockModel::appendChild(NodeId splitter, NodeId child, int size)
+{
+    if (!isValid(splitter) || !isValid(child) || _nodes[splitter].kind != SPLITTER)
+    {
+        return;
+    }
+    _nodes[splitter].children.append(child);
+    _nodes[splitter].sizes.append(size);
+    _nodes[child].parent = splitter;
+}
+
+int DockModel::addWindow(NodeId rootSplitter, const QRect &geometry)
+{
+    if (!isValid(rootSplitter))
+    {
+        return -1;
+    }
+    Window window;
+    window.rootSplitter = rootSplitter;
+    window.geometry = geometry;
+    _windows.append(window);
+    relayout();
+    return _windows.size() - 1;
+}
+
+void DockModel::setGeometry(NodeId id, const QRect &geometry)
+{
+    if (isValid(id))
+    {
+        _nodes[id].geometry = geometry;
+    }
+}
+
+bool DockModel::isValid(NodeId id) const
+{
+    return id >= 0 && id < _nodes.size() && _nodes.at(id).isAlive;
+}
+
+int DockModel::windowOf(NodeId id) const
+{
+    if (!isValid(id))
+    {
+        return -1;
+    }
+    while (_nodes.at(id).parent != INVALID_NODE)
+    {
+        id = _nodes.at(id).parent;
+    }
+    for (int i = 0; i < _windows.size(); i++)
+    {
+        if (_windows.at(i).rootSplitter == id)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+DockModel::NodeId DockModel::nodeAt(int windowIndex, const QList<int> &path) const
+{
+    if (windowIndex < 0 || windowIndex >= _windows.size())
+    {
+        return INVALID_NODE;
+    }
+    NodeId id = _windows.at(windowIndex).rootSplitter;
+    for (int i = 0; i < path.size(); i++)
+    {
+        const Node &n = _nodes.at(id);
+        if (n.kind != SPLITTER || path.at(i) < 0 || path.at(i) >= n.children.size())
+        {
+            return INVALID_NODE;
+        }
+        id = n.children.at(path.at(i));
+    }
+    return id;
+}
+
+QList<DockModel::NodeId> DockModel::tabGroups() const
+{
+    QList<NodeId> groups;
+    for (int i = 0; i < _nodes.size(); i++)
+    {
+        if (_nodes.at(i).isAlive && _nodes.at(i).kind == TAB_GROUP)
+        {
+            groups.append(i);
+        }
+    }
+    return groups;
+}
+
+bool DockModel::validate() const
+{
+    int reached = 0;
+    QList<NodeId> stack;
+    for (int i = 0; i < _windows.size(); i++)
+    {
+        NodeId root = _windows.at(i).rootSplitter;
+        if (!isValid(root) || _nodes.at(root).kind != SPLITTER || _nodes.at(root).parent != INVALID_NODE)
+        {
+            return false;
+        }
+        stack.append(root);
+    }
+    while (!stack.isEmpty())
+    {
+        NodeId id = stack.takeLast();
+        const Node &n = _nodes.at(id);
+        reached++;
+        if (n.kind == SPLITTER)
+        {
+            if (n.children.size() != n.sizes.size())
+            {
+                return false;
+            }
+            for (int i = 0; i < n.children.size(); i++)
+            {
+                NodeId child = n.children.at(i);
+                if (!isValid(child) || _nodes.at(child).parent != id)
+                {
+                    return false;
+                }
+                stack.append(child);
+            }
+        }
+        else if (n.currentIndex < -1 || n.currentIndex >= n.tabs.size())
+        {
+            return false;
+        }
+    }
+    // Every live node must hang below exactly one window
+    return reached == _nodes.size() - _freeNodes.size();
+}
+
+int DockModel::addTab(NodeId group, const Tab &tab, int index)
+{
+    if (!isValid(group) || _nodes[group].kind != TAB_GROUP)
+    {
+        return -1;
+    }
+    QList<Tab> &tabs = _nodes[group].tabs;
+    if (index < 0 || index > tabs.size())
+    {
+        index = tabs.size();
+    }
+    tabs.insert(index, tab);
+    _nodes[group].currentIndex = index;
+    return index;
+}
+
+void DockModel::setCurrentTab(NodeId group, int tabIndex)
+{
+    if (!isValid(group) || _nodes[group].kind != TAB_GROUP)
+    {
+        return;
+    }
+    if (tabIndex >= -1 && tabIndex < _nodes[group].tabs.size())
+    {
+        _nodes[group].currentIndex = tabIndex;
+    }
+}
+
+DockModel::NodeId DockModel::dockAtTabGroup(NodeId targetGroup, Region region, const Tab &tab)
+{
+    if (!isValid(targetGroup) || _nodes[targetGroup].kind != TAB_GROUP)
+    {
+        return INVALID_NODE;
+    }
+    NodeId parent = _nodes[targetGroup].parent;
+    if (!isValid(parent))
+    {
+        return INVALID_NODE;
+    }
+    Qt::Orientation orientation = regionOrientation(region);
+    bool isBefore = isRegionBefore(region);
+    int extent = sizeAlong(targetGroup, orientation);
+
+    NodeId group = createTabGroup();
+    addTab(group, tab);
+    if (_nodes[parent].orientation == orientation)
+    {
+        int index = _nodes[parent].children.indexOf(targetGroup);
+        _nodes[parent].sizes = sizesAfterDockBeside(childSizes(parent), index, extent, isBefore);
+        _nodes[parent].children.insert(isBefore ? index : index + 1, group);
+        _nodes[group].parent = parent;
+    }
+    else
+    {
+        QList<int> sizes = splitSizes(extent, isBefore);
+        NodeId splitter = createSplitter(orientation);
+        replaceChild(parent, targetGroup, splitter);
+        appendChild(splitter, isBefore ? group : targetGroup, sizes.at(0));
+        appendChild(splitter, isBefore ? targetGroup : group, sizes.at(1));
+    }
+    relayout();
+    return group;
+}
+
+DockModel::NodeId DockModel::dockAtRoot(int windowIndex, Region region, const Tab &tab)
+{
+    if (windowIndex < 0 || windowIndex >= _windows.size())
+    {
+        return INVALID_NODE;
+    }
+    NodeId root = _windows[windowIndex].rootSplitter;
+    Qt::Orientation orientation = regionOrientation(region);
+    bool isToHead = isRegionBefore(region);
+    if (_nodes[root].orientation != orientation && _nodes[root].children.size() <= 1)
+    {
+        _nodes[root].orientation = orientation;
+    }
+
+    NodeId group = createTabGroup();
+    addTab(group, tab);
+    if (_nodes[root].orientation == orientation)
+    {
+        QList<int> sizes = recalcRootSplitterSizesAfterAddNew(childSizes(root), ROOT_DOCKED_SIZE_HINT, isToHead);
+        if (isToHead)
+        {
+            _nodes[root].children.prepend(group);
+        }
+        else
+        {
+            _nodes[root].children.append(group);
+        }
+        _nodes[root].sizes = sizes;
+        _nodes[group].parent = root;
+    }
+    else
+    {
+        QList<int> sizes = rootSplitSizes(sizeAlong(root, orientation), isToHead);
+        NodeId newRoot = createSplitter(orientation);
+        appendChild(newRoot, isToHead ? group : root, sizes.at(0));
+        appendChild(newRoot, isToHead ? root : group, sizes.at(1));
+        _windows[windowIndex].rootSplitter = newRoot;
+    }
+    relayout();
+    return group;
+}
+
+int DockModel::floatTab(NodeId group, int tabIndex, const QRect &geometry)
+{
+    if (!isValid(group) || _nodes[group].kind != TAB_GROUP
+        || tabIndex < 0 || tabIndex >= _nodes[group].tabs.size()
+        || isLastTabInMainWindow(group))
+    {
+        return -1;
+    }
+    Tab tab = takeTab(group, tabIndex);
+    return addFloatWindow(tab, geometry);
+}
+
+int DockModel::addFloatWindow(const Tab &tab, const QRect &geometry)
+{
+    NodeId root = createSplitter(Qt::Horizontal);
+    NodeId newGroup = createTabGroup();
+    addTab(newGroup, tab);
+    appendChild(root, newGroup, 1);
+    return addWindow(root, geometry);
+}
+
+bool DockModel::closeTab(NodeId group, int tabIndex)
+{
+    if (isMaximized() || !isValid(group) || _nodes[group].kind != TAB_GROUP
+        || tabIndex < 0 || tabIndex >= _nodes[group].tabs.size()
+        || isLastTabInMainWindow(group))
+    {
+        return false;
+    }
+    takeTab(group, tabIndex);
+    relayout();
+    return true;
+}
+
+bool DockModel::closeWindow(int windowIndex)
+{
+    // The main window is never closed
+    if (windowIndex <= 0 || windowIndex >= _windows.size())
+    {
+        return false;
+    }
+    NodeId root = _windows.at(windowIndex).rootSplitter;
+    if (_maximizedGroup != INVALID_NODE && windowOf(_maximizedGroup) == windowIndex)
+    {
+        _maximizedGroup = INVALID_NODE;
+        _maximizedTab = -1;
+    }
+    _windows.removeAt(windowIndex);
+    freeSubtree(root);
+    return true;
+}
+
+void DockModel::setSizes(NodeId splitter, const QList<int> &sizes)
+{
+    if (!isValid(splitter) || _nodes[splitter].kind != SPLITTER || _nodes[splitter].children.size() != sizes.size())
+    {
+        return;
+    }
+    _nodes[splitter].sizes = sizes;
+    relayout();
+}
+
+bool DockModel::isLastTabInMainWindow(NodeId group) const
+{
+    if (!isValid(group) || _nodes.at(group).tabs.size() > 1 || windowOf(group) != 0)
+    {
+        return false;
+    }
+    int groupCount = 0;
+    QList<NodeId> stack;
+    stack.append(_windows.at(0).rootSplitter);
+    while (!stack.isEmpty())
+    {
+        const Node &n = _nodes.at(stack.takeLast());
+        if (n.kind == TAB_GROUP)
+        {
+            groupCount++;
+        }
+        stack.append(n.children);
+    }
+    return groupCount <= 1;
+}
+
+bool DockModel::maximize(NodeId group, int tabIndex)
+{
+    // Like the context menu, only tabs of the main window can be maximized
+    if (!isValid(group) || _nodes[group].kind != TAB_GROUP
+        || tabIndex < 0 || tabIndex >= _nodes[group].tabs.size()
+        || windowOf(group) != 0)
+    {
+        return false;
+    }
+    _maximizedGroup = group;
+    _maximizedTab = tabIndex;
+    relayout();
+    return true;
+}
+
+void DockModel::restoreMaximized()
+{
+    _maximizedGroup = INVALID_NODE;
+    _maximizedTab = -1;
+    relayout();
+}
+
+DockModel::Tab DockModel::takeTab(NodeId group, int tabIndex)
+{
+    if (_maximizedGroup == group)
+    {
+        _maximizedGroup = INVALID_NODE;
+        _maximizedTab = -1;
+    }
+    Node &n = _nodes[group];
+    Tab tab = n.tabs.takeAt(tabIndex);
+    if (n.currentIndex >= n.tabs.size() || n.currentIndex > tabIndex)
+    {
+        n.currentIndex--;
+    }
+    if (n.tabs.isEmpty())
+    {
+        removeEmptyNode(group);
+    }
+    return tab;
+}
+
+void DockModel::removeEmptyNode(NodeId id)
+{
+    NodeId parent = _nodes[id].parent;
+    if (parent == INVALID_NODE)
+    {
+        // An empty floating window closes, the main window keeps its root splitter
+        for (int i = 1; i < _windows.size(); i++)
+        {
+            if (_windows[i].rootSplitter == id)
+            {
+                _windows.removeAt(i);
+                freeNode(id);
+                break;
+            }
+        }
+        return;
+    }
+    int index = _nodes[parent].children.indexOf(id);
+    _nodes[parent].children.removeAt(index);
+    _nodes[parent].sizes.removeAt(index);
+    freeNode(id);
+    if (_nodes[parent].children.isEmpty())
+    {
+        removeEmptyNode(parent);
+    }
+}
+
+void DockModel::replaceChild(NodeId splitter, NodeId oldChild, NodeId newChild)
+{
+    int index = _nodes[splitter].children.indexOf(oldChild);
+    if (index < 0)
+    {
+        return;
+    }
+    _nodes[splitter].children[index] = newChild;
+    _nodes[newChild].parent = splitter;
+    _nodes[oldChild].parent = INVALID_NODE;
+}
+
+int DockModel::sizeAlong(NodeId id, Qt::Orientation orientation) const
+{
+    const QRect &r = _nodes.at(id).geometry;
+    return (orientation == Qt::Horizontal) ? r.width() : r.height();
+}
+
+QList<int> DockModel::childSizes(NodeId splitter) const
+{
+    // Current extents when the model has been laid out, the stored sizes otherwise
+    const Node &n = _nodes.at(splitter);
+    QList<int> sizes;
+    for (int i = 0; i < n.children.size(); i++)
+    {
+        int size = sizeAlong(n.children.at(i), n.orientation);
+        if (size <= 0)
+        {
+            return n.sizes;
+        }
+        sizes.append(size);
+    }
+    return sizes;
+}
+
+void DockModel::layout(const QSize &mainWindowSize)
+{
+    _mainWindowSize = mainWindowSize;
+    relayout();
+}
+
+void DockModel::relayout()
+{
+    if (!_mainWindowSize.isValid())
+    {
+        return;
+    }
+    for (int i = 0; i < _windows.size(); i++)
+    {
+        QSize size = (i == 0) ? _mainWindowSize : _windows.at(i).geometry.size();
+        QRect rect(QPoint(0, 0), size);
+        if (i == 0 && isMaximized())
+        {
+            // The maximized tab covers the whole main window, the rest of the tree is hidden
+            hideNode(_windows.at(i).rootSplitter);
+            _nodes[_maximizedGroup].geometry = rect;
+            continue;
+        }
+        layoutNode(_windows.at(i).rootSplitter, rect);
+    }
+}
+
+void DockModel::layoutNode(NodeId id, const QRect &rect)
+{
+    _nodes[id].geometry = rect;
+    if (_nodes[id].kind != SPLITTER)
+    {
+        return;
+    }
+    const Node &n = _nodes.at(id);
+    const int count = n.children.size();
+    if (count == 0)
+    {
+        return;
+    }
+    const bool isHorizontal = (n.orientation == Qt::Horizontal);
+    const int total = (isHorizontal ? rect.width() : rect.height()) - _handleWidth * (count - 1);
+    float sum = 0.0f;
+    for (int i = 0; i < count; i++)
+    {
+        sum += n.sizes.at(i);
+    }
+    QList<NodeId> children = n.children;
+    QList<int> sizes = n.sizes;
+    int pos = 0;
+    for (int i = 0; i < count; i++)
+    {
+        // Same rule as the Splitter layout kernel: proportional share, clamped to the minimum size
+        int size = (sum > 0.0f) ? (int)(total * (sizes.at(i) / sum)) : total / count;
+        size = std::max<int>(size, _minimumSize);
+        QRect childRect = isHorizontal
+            ? QRect(rect.left() + pos, rect.top(), size, rect.height())
+            : QRect(rect.left(), rect.top() + pos, rect.width(), size);
+        layoutNode(children.at(i), childRect);
+        pos += size + _handleWidth;
+    }
+}
+
+void DockModel::hideNode(NodeId id)
+{
+    _nodes[id].geometry = QRect();
+    QList<NodeId> children = _nodes.at(id).children;
+    for (int i = 0; i < children.size(); i++)
+    {
+        hideNode(children.at(i));
+    }
+}
+
+QList<int> DockModel::splitSizes(int extent, bool isBefore)
+{
+    // The new node takes a third
+    int newSize = extent / 3;
+    int oldSize = extent - newSize;
+    QList<int> sizes;
+    if (isBefore)
+    {
+        sizes << newSize << oldSize;
+    }
+    else
+    {
+        sizes << oldSize << newSize;
+    }
+    return sizes;
+}
+
+QList<int> DockModel::sizesAfterDockBeside(const QList<int> &sizes, int index, int extent, bool isBefore)
+{
+    QList<int> newSizes = sizes;
+    if (index < 0 || index >= newSizes.size())
+    {
+        return newSizes;
+    }
+    QList<int> split = splitSizes(extent, isBefore);
+    newSizes[index] = split.at(1);
+    newSizes.insert(index, split.at(0));
+    return newSizes;
+}
+
+QList<int> DockModel::rootSplitSizes(int extent, bool isToHead)
+{
+    QList<int> sizes;
+    if (isToHead)
+    {
+        sizes << ROOT_DOCKED_SIZE_HINT << extent - ROOT_DOCKED_SIZE_HINT;
+    }
+    else
+    {
+        sizes << extent - ROOT_DOCKED_SIZE_HINT << ROOT_DOCKED_SIZE_HINT;
+    }
+    return sizes;
+}
+
+QList<int> DockModel::recalcRootSplitterSizesAfterAddNew(const QList<int> &oldSizes, int newItemSizeHint, bool isToHead)
+{
+    QList<int> newSizes;
+    int totalDecrease = 0;
+    for (int i = 0; i < oldSizes.size(); i++)
+    {
+        int decrease = std::min<int>(newItemSizeHint - totalDecrease, oldSizes[i] - WIDGET_MIN_SIZE);
+        newSizes.append(oldSizes[i] - decrease);
+        totalDecrease += decrease;
+        Q_ASSERT(totalDecrease <= newItemSizeHint);
+    }
+    int newItemSize = std::max<int>(WIDGET_MIN_SIZE, totalDecrease);
+    if (isToHead)
+    {
+        newSizes.insert(0, newItemSize);
+    }
+    else
+    {
+        newSizes.append(newItemSize);
+    }
+    return newSizes;
+}
+
+QByteArray DockModel::fingerprint() const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    addIntToHash(hash, _windows.size());
+    for (int i = 0; i < _windows.size(); i++)
+    {
+        addRectToHash(hash, _windows.at(i).geometry);
+        addNodeToHash(_windows.at(i).rootSplitter, hash);
+    }
+    return hash.result();
+}
+
+void DockModel::addNodeToHash(NodeId id, QCryptographicHash &hash) const
+{
+    const Node &n = _nodes.at(id);
+    addIntToHash(hash, n.kind);
+    if (n.kind == SPLITTER)
+    {
+        addIntToHash(hash, n.orientation);
+        addIntToHash(hash, n.children.size());
+        for (int i = 0; i < n.children.size(); i++)
+        {
+            addIntToHash(hash, n.sizes.at(i));
+            addNodeToHash(n.children.at(i), hash);
+        }
+        return;
+    }
+    addIntToHash(hash, n.currentIndex);
+    addIntToHash(hash, n.tabs.size());
+    for (int i = 0; i < n.tabs.size(); i++)
+    {
+        const Tab &tab = n.tabs.at(i);
+        addIntToHash(hash, tab.windowType);
+        hash.addData(tabStateHash(tab));
+    }
+}
+
+QByteArray DockModel::tabStateHash(const Tab &tab)
+{
+    if (!tab.stateHash.isEmpty())
+    {
+        return tab.stateHash;
+    }
+    // A store key is the state hash, so the fingerprint is the same with the state inline or not
+    if (tab.state.isEmpty() && !tab.stateRef.isEmpty())
+    {
+        return QByteArray::fromHex(tab.stateRef.toLatin1());
+    }
+    return stateHash(tab.state);
+}
+
+QByteArray DockModel::stateHash(const QJsonObject &state)
+{
+    // Compact json sorts the keys, so equal states give equal bytes
+    return QCryptographicHash::hash(QJsonDocument(state).toJson(QJsonDocument::Compact), QCryptographicHash::Sha1);
+}
+
+QByteArray DockModel::fingerprintFromJson(const QJsonObject &jsonObj)
+{
+    return QByteArray::fromHex(jsonObj.value(c_strFingerprint).toString().toLatin1());
+}
+
+QByteArray DockModel::fingerprintFromCbor(const QByteArray &data)
+{
+    QCborStreamReader reader(data);
+    if (!reader.isTag() || reader.toTag() != QCborTag(LAYOUT_CBOR_TAG))
+    {
+        return QByteArray();
+    }
+    reader.next();
+    if (!reader.isMap())
+    {
+        return QByteArray();
+    }
+    reader.enterContainer();
+    while (reader.lastError() == QCborError::NoError && reader.hasNext())
+    {
+        qint64 key = -1;
+        if (!readCborInteger(reader, key))
+        {
+            reader.next();
+            continue;
+        }
+        if (key == KEY_FINGERPRINT && reader.isByteArray())
+        {
+            QByteArray fingerprint;
+            auto chunk = reader.readByteArray();
+            while (chunk.status == QCborStreamReader::Ok)
+            {
+                fingerprint += chunk.data;
+                chunk = reader.readByteArray();
+            }
+            return (chunk.status == QCborStreamReader::EndOfString) ? fingerprint : QByteArray();
+        }
+        if (key == KEY_WINDOWS)
+        {
+            break;
+        }
+        reader.next();
+    }
+    return QByteArray();
+}
+
+void DockModel::moveStatesTo(StateStore &store)
+{
+    for (int i = 0; i < _nodes.size(); i++)
+    {
+        Node &n = _nodes[i];
+        if (!n.isAlive || n.kind != TAB_GROUP)
+        {
+            continue;
+        }
+        for (int j = 0; j < n.tabs.size(); j++)
+        {
+            Tab &tab = n.tabs[j];
+            if (tab.state.isEmpty())
+            {
+                continue;
+            }
+            // A failed write keeps the state inline, the layout stays complete either way
+            QString key = store.put(tab.state, tab.stateHash);
+            if (!key.isEmpty())
+            {
+                tab.stateRef = key;
+                tab.state = QJsonObject();
+            }
+        }
+    }
+}
+
+void DockModel::toJson(QJsonObject &jsonObj, const QByteArray &fingerprint) const
+{
+    QJsonArray floatWindowChildren;
+    for (int i = 0; i < _windows.size(); i++)
+    {
+        QJsonObject windowObj;
+        saveSplitterToJson(_windows.at(i).rootSplitter, 1, windowObj);
+        windowObj.insert(c_strGeometry, geometryToJson(_windows.at(i).geometry));
+        if (i == 0)
+        {
+            windowObj.insert(c_strWindowName, c_strMainWindow);
+        }
+        else
+        {
+            windowObj.insert(c_strWindowName, QString("%1%2").arg("Window_").arg(i));
+        }
+        floatWindowChildren.append(windowObj);
+    }
+    jsonObj.insert(c_strFloatWindowChildren, floatWindowChildren);
+    jsonObj.insert(c_strFingerprint, QString::fromLatin1((fingerprint.isEmpty() ? this->fingerprint() : fingerprint).toHex()));
+}
+
+void DockModel::saveSplitterToJson(NodeId id, int size, QJsonObject &jsonObj) const
+{
+    const Node &n = _nodes.at(id);
+    jsonObj.insert(c_strWidgetType, SPLITTER);
+    jsonObj.insert(c_strOrientation, n.orientation);
+    jsonObj.insert(c_strSize, size);
+    jsonObj.insert(c_strGeometry, geometryToJson(n.geometry));
+
+    QJsonObject childrenList;
+    for (int i = 0; i < n.children.size(); i++)
+    {
+        QJsonObject childObj;
+        QString childName;
+        NodeId child = n.children.at(i);
+        if (_nodes.at(child).kind == SPLITTER)
+        {
+            childName = c_strSplitter;
+            saveSplitterToJson(child, n.sizes.at(i), childObj);
+        }
+        else
+        {
+            childName = c_strTabWidget;
+            saveTabGroupToJson(child, n.sizes.at(i), childObj);
+        }
+        childName = QString("%1_%2_%3").arg("child").arg(i).arg(childName);
+        childrenList.insert(childName, childObj);
+    }
+    jsonObj.insert(c_strSplitterChildren, childrenList);
+}
+
+void DockModel::saveTabGroupToJson(NodeId id, int size, QJsonObject &jsonObj) const
+{
+    const Node &n = _nodes.at(id);
+    jsonObj.insert(c_strWidgetType, TAB_GROUP);
+    jsonObj.insert(c_strSize, size);
+    jsonObj.insert(c_strCurrentTabIndex, n.currentIndex);
+
+    QJsonObject children;
+    for (int i = 0; i < n.tabs.size(); i++)
+    {
+        const Tab &tab = n.tabs.at(i);
+        QJsonObject childObj;
+        childObj.insert(c_strWidgetType, VIEW_WIDGET_TYPE);
+        childObj.insert(c_strWindowType, QString::number(tab.windowType));
+        if (!tab.stateRef.isEmpty())
+        {
+            childObj.insert(c_strStateRef, tab.stateRef);
+        }
+        for (auto iter = tab.state.begin(); iter != tab.state.end(); iter++)
+        {
+            childObj.insert(iter.key(), iter.value());
+        }
+        // Per tab, after the state so a key of the same name in it cannot override the id
+        if (tab.windowId >= 0)
+        {
+            childObj.insert(c_strWindowID, tab.windowId);
+        }
+        QString childName = QString("%1_%2_%3").arg("Tab").arg(i).arg(tab.windowType);
+        children.insert(childName, childObj);
+    }
+    jsonObj.insert(c_strTabWidgetChildren, children);
+}
+
+bool DockModel::fromJson(const QJsonObject &jsonObj)
+{
+    clear();
+    QJsonArray childreList = jsonObj.value(c_strFloatWindowChildren).toArray();
+    for (int i = 0; i < childreList.count(); i++)
+    {
+        QJsonObject windowJsonObj = childreList[i].toObject();
+        NodeId root = createSplitterFromJson(windowJsonObj);
+        QRect geometry = geometryFromJson(windowJsonObj.value(c_strGeometry).toObject());
+        addWindow(root, geometry);
+    }
+    return !isEmpty();
+}
+
+DockModel::NodeId DockModel::createSplitterFromJson(const QJsonObject &jsonObj)
+{
+    NodeId splitter = createSplitter((Qt::Orientation)jsonObj.value(c_strOrientation).toInt());
+    QList<QJsonObject> childreList = orderedJsonChildren(jsonObj.value(c_strSplitterChildren).toObject());
+    for (int i = 0; i < childreList.size(); i++)
+    {
+        const QJsonObject &childOject = childreList[i];
+        NodeId child = INVALID_NODE;
+        switch (childOject.value(c_strWidgetType).toInt())
+        {
+        case SPLITTER:
+            child = createSplitterFromJson(childOject);
+            break;
+        case TAB_GROUP:
+            child = createTabGroupFromJson(childOject);
+            break;
+        default:
+            Q_ASSERT(false);
+            continue;
+        }
+        appendChild(splitter, child, childOject.value(c_strSize).toInt());
+    }
+    return splitter;
+}
+
+DockModel::NodeId DockModel::createTabGroupFromJson(const QJsonObject &jsonObj)
+{
+    NodeId group = createTabGroup();
+    QList<QJsonObject> childreList = orderedJsonChildren(jsonObj.value(c_strTabWidgetChildren).toObject());
+    for (int i = 0; i < childreList.size(); i++)
+    {
+        const QJsonObject &childOject = childreList[i];
+        Q_ASSERT(childOject.value(c_strWidgetType).toInt() == VIEW_WIDGET_TYPE);
+        Tab tab;
+        tab.windowType = (uint)childOject.value(c_strWindowType).toString().toLongLong();
+        tab.windowId = childOject.value(c_strWindowID).toInt(-1);
+        if (childOject.contains(c_strStateRef))
+        {
+            tab.stateRef = childOject.value(c_strStateRef).toString();
+        }
+        else
+        {
+            // The id names the window, it is not part of what the window saved
+            tab.state = childOject;
+            tab.state.remove(c_strWindowID);
+        }
+        _nodes[group].tabs.append(tab);
+    }
+    _nodes[group].currentIndex = jsonObj.value(c_strCurrentTabIndex).toInt();
+    return group;
+}
+
+
+QByteArray DockModel::toCbor(const QByteArray &fingerprint) const
+{
+    QByteArray data;
+    QCborStreamWriter writer(&data);
+    writer.append(QCborTag(LAYOUT_CBOR_TAG));
+    writer.startMap(3);
+    writer.append(qint64(KEY_VERSION));
+    writer.append(qint64(CBOR_FORMAT_VERSION));
+    writer.append(qint64(KEY_FINGERPRINT));
+    writer.append(fingerprint.isEmpty() ? this->fingerprint() : fingerprint);
+    writer.append(qint64(KEY_WINDOWS));
+    writer.startArray(_windows.size());
+    for (int i = 0; i < _windows.size(); i++)
+    {
+        const QRect &geometry = _windows.at(i).geometry;
+        writer.startMap(2);
+        writer.append(qint64(KEY_WINDOW_GEOMETRY));
+        writer.startArray(4);
+        writer.append(qint64(geometry.left()));
+        writer.append(qint64(geometry.top()));
+        writer.append(qint64(geometry.width()));
+        writer.append(qint64(geometry.height()));
+        writer.endArray();
+        writer.append(qint64(KEY_WINDOW_ROOT));
+        saveNodeToCbor(_windows.at(i).rootSplitter, writer);
+        writer.endMap();
+    }
+    writer.endArray();
+    writer.endMap();
+    return data;
+}
+
+void DockModel::saveNodeToCbor(NodeId id, QCborStreamWriter &writer) const
+{
+    const Node &n = _nodes.at(id);
+    if (n.kind == SPLITTER)
+    {
+        writer.startMap(4);
+        writer.append(qint64(KEY_NODE_KIND));
+        writer.append(qint64(SPLITTER));
+        writer.append(qint64(KEY_NODE_ORIENTATION));
+        writer.append(qint64(n.orientation));
+        writer.append(qint64(KEY_NODE_SIZES));
+        writer.startArray(n.sizes.size());
+        for (int i = 0; i < n.sizes.size(); i++)
+        {
+            writer.append(qint64(n.sizes.at(i)));
+        }
+        writer.endArray();
+        writer.append(qint64(KEY_NODE_CHILDREN));
+        writer.startArray(n.children.size());
+        for (int i = 0; i < n.children.size(); i++)
+        {
+            saveNodeToCbor(n.children.at(i), writer);
+        }
+        writer.endArray();
+        writer.endMap();
+        return;
+    }
+    writer.startMap(3);
+    writer.append(qint64(KEY_NODE_KIND));
+    writer.append(qint64(TAB_GROUP));
+    writer.append(qint64(KEY_NODE_CURRENT_INDEX));
+    writer.append(qint64(n.currentIndex));
+    writer.append(qint64(KEY_NODE_TABS));
+    writer.startArray(n.tabs.size());
+    for (int i = 0; i < n.tabs.size(); i++)
+    {
+        const Tab &tab = n.tabs.at(i);
+        writer.startMap(3);
+        writer.append(qint64(KEY_TAB_WINDOW_TYPE));
+        writer.append(qint64(tab.windowType));
+        writer.append(qint64(KEY_TAB_WINDOW_ID));
+        writer.append(qint64(tab.windowId));
+        if (!tab.stateRef.isEmpty())
+        {
+            writer.append(qint64(KEY_TAB_STATE_REF));
+            writer.append(tab.stateRef);
+        }
+        else
+        {
+            writer.append(qint64(KEY_TAB_STATE));
+            QCborMap::fromJsonObject(tab.state).toCborValue().toCbor(writer);
+        }
+        writer.endMap();
+    }
+    writer.endArray();
+    writer.endMap();
+}
+
+bool DockModel::fromCbor(const QByteArray &data)
+{
+    clear();
+    QCborStreamReader reader(data);
+    if (!reader.isTag() || reader.toTag() != QCborTag(LAYOUT_CBOR_TAG))
+    {
+        return false;
+    }
+    reader.next();
+    if (!reader.isMap())
+    {
+        return false;
+    }
+    reader.enterContainer();
+    qint64 version = -1;
+    while (reader.lastError() == QCborError::NoError && reader.hasNext())
+    {
+        qint64 key = -1;
+        if (!readCborInteger(reader, key))
+        {
+            reader.next();
+            continue;
+        }
+        if (key == KEY_VERSION)
+        {
+            readCborInteger(reader, version);
+            if (version < 1 || version > CBOR_FORMAT_VERSION)
+            {
+                break;
+            }
+        }
+        else if (key == KEY_WINDOWS && version >= 1 && reader.isArray())
+        {
+            reader.enterContainer();
+            while (reader.lastError() == QCborError::NoError && reader.hasNext())
+            {
+                readWindowFromCbor(reader);
+            }
+            reader.leaveContainer();
+        }
+        else
+        {
+            reader.next();
+        }
+    }
+    if (reader.lastError() != QCborError::NoError || version < 1 || version > CBOR_FORMAT_VERSION)
+    {
+        clear();
+        return false;
+    }
+    return !isEmpty();
+}
+
+bool DockModel::readWindowFromCbor(QCborStreamReader &reader)
+{
+    if (!reader.isMap())
+    {
+        reader.next();
+        return false;
+    }
+    NodeId root = INVALID_NODE;
+    QRect geometry;
+    reader.enterContainer();
+    while (reader.lastError() == QCborError::NoError && reader.hasNext())
+    {
+        qint64 key = -1;
+        if (!readCborInteger(reader, key))
+        {
+            reader.next();
+            continue;
+        }
+        if (key == KEY_WINDOW_GEOMETRY)
+        {
+            QList<int> values;
+            readCborIntegers(reader, values);
+            if (values.size() == 4)
+            {
+                geometry = QRect(values[0], values[1], values[2], values[3]);
+            }
+        }
+        else if (key == KEY_WINDOW_ROOT)
+        {
+            root = readNodeFromCbor(reader);
+        }
+        else
+        {
+            reader.next();
+        }
+    }
+    reader.leaveContainer();
+    if (!isValid(root) || _nodes[root].kind != SPLITTER)
+    {
+        return false;
+    }
+    addWindow(root, geometry);
+    return true;
+}
+
+DockModel::NodeId DockModel::readNodeFromCbor(QCborStreamReader &reader)
+{
+    if (!reader.isMap())
+    {
+        reader.next();
+        return INVALID_NODE;
+    }
+    NodeId id = INVALID_NODE;
+    QList<int> sizes;
+    reader.enterContainer();
+    while (reader.lastError() == QCborError::NoError && reader.hasNext())
+    {
+        qint64 key = -1;
+        if (!readCborInteger(reader, key))
+        {
+            reader.next();
+            continue;
+        }
+        qint64 value = 0;
+        if (key == KEY_NODE_KIND && id == INVALID_NODE)
+        {
+            readCborInteger(reader, value);
+            id = (value == SPLITTER) ? createSplitter(Qt::Horizontal) : createTabGroup();
+        }
+        else if (key == KEY_NODE_ORIENTATION && isValid(id))
+        {
+            readCborInteger(reader, value);
+            _nodes[id].orientation = (Qt::Orientation)value;
+        }
+        else if (key == KEY_NODE_SIZES)
+        {
+            readCborIntegers(reader, sizes);
+        }
+        else if (key == KEY_NODE_CHILDREN && isValid(id) && _nodes[id].kind == SPLITTER && reader.isArray())
+        {
+            reader.enterContainer();
+            for (int index = 0; reader.lastError() == QCborError::NoError && reader.hasNext(); index++)
+            {
+                NodeId child = readNodeFromCbor(reader);
+                appendChild(id, child, sizes.value(index, 0));
+            }
+            reader.leaveContainer();
+        }
+        else if (key == KEY_NODE_CURRENT_INDEX && isValid(id))
+        {
+            readCborInteger(reader, value);
+            _nodes[id].currentIndex = (int)value;
+        }
+        else if (key == KEY_NODE_TABS && isValid(id) && _nodes[id].kind == TAB_GROUP && reader.isArray())
+        {
+            reader.enterContainer();
+            while (reader.lastError() == QCborError::NoError && reader.hasNext())
+            {
+                Tab tab;
+                if (readTabFromCbor(reader, tab))
+                {
+                    _nodes[id].tabs.append(tab);
+                }
+            }
+            reader.leaveContainer();
+        }
+        else
+        {
+            reader.next();
+        }
+    }
+    reader.leaveContainer();
+    return id;
+}
+
+bool DockModel::readTabFromCbor(QCborStreamReader &reader, Tab &tab)
+{
+    if (!reader.isMap())
+    {
+        reader.next();
+        return false;
+    }
+    bool hasType = false;
+    reader.enterContainer();
+    while (reader.lastError() == QCborError::NoError && reader.hasNext())
+    {
+        qint64 key = -1;
+        if (!readCborInteger(reader, key))
+        {
+            reader.next();
+            continue;
+        }
+        qint64 value = 0;
+        if (key == KEY_TAB_WINDOW_TYPE)
+        {
+            hasType = readCborInteger(reader, value);
+            tab.windowType = (uint)value;
+        }
+        else if (key == KEY_TAB_WINDOW_ID)
+        {
+            readCborInteger(reader, value);
+            tab.windowId = (int)value;
+        }
+        else if (key == KEY_TAB_STATE)
+        {
+            // The window's own state is opaque here, it is handed to load() as JSON
+            tab.state = QCborValue::fromCbor(reader).toMap().toJsonObject();
+        }
+        else if (key == KEY_TAB_STATE_REF)
+        {
+            tab.stateRef = QCborValue::fromCbor(reader).toString();
+        }
+        else
+        {
+            reader.next();
+        }
+    }
+    reader.leaveContainer();
+    return hasType;
+}
+
+}
@@ -0,0 +1,194 @@
+/**********************************************************
+* @file     DockModel.h
+* @brief    Widget free description of a dock layout; supports the dock
+*           operations and computes geometry without a windowing system
+*
+***********************************************************/
+#ifndef DOCKMODEL_H
+#define DOCKMODEL_H
+
+#include <QList>
+#include <QRect>
+#include <QString>
+#include <QJsonObject>
+#include <QByteArray>
+
+#include "dock_global.h"
+
+class QCborStreamWriter;
+class QCborStreamReader;
+class QCryptographicHash;
+
+namespace dock {
+
+class StateStore;
+
+// A plain value type: it can be copied to, built and laid out on any thread
+class DOCKSHARED_EXPORT DockModel
+{
+public:
+    typedef int NodeId;
+    static const NodeId INVALID_NODE = -1;
+
+    enum NodeKind
+    {
+        SPLITTER,
+        TAB_GROUP
+    };
+
+    enum Region
+    {
+        LEFT,
+        TOP,
+        RIGHT,
+        BOTTOM
+    };
+
+    struct Tab
+    {
+        uint windowType;
+        int windowId;
+        QJsonObject state;      // What DockableWindow::saveObject wrote, handed to load()
+        QByteArray stateHash;   // stateHash(state) when the window had it cached, else empty
+        QString stateRef;       // StateStore key of a state kept out of the layout, state is then empty
+        Tab() : windowType(0), windowId(-1) {}
+    };
+
+    struct Node
+    {
+        NodeKind kind;
+        NodeId parent;
+        bool isAlive;
+        // SPLITTER
+        Qt::Orientation orientation;
+        QList<NodeId> children;
+        QList<int> sizes;       // Size of each child along the orientation
+        // TAB_GROUP
+        QList<Tab> tabs;
+        int currentIndex;
+        // Result of layout(), relative to the window the node is in
+        QRect geometry;
+    };
+
+    struct Window
+    {
+        NodeId rootSplitter;
+        QRect geometry;         // Floating windows only, the main window is sized by layout()
+    };
+
+    DockModel();
+
+    void clear();
+    bool isEmpty() const { return _windows.isEmpty(); }
+
+    // Building blocks, the first window added is the main window
+    NodeId createSplitter(Qt::Orientation orientation);
+    NodeId createTabGroup();
+    void appendChild(NodeId splitter, NodeId child, int size);
+    int addWindow(NodeId rootSplitter, const QRect &geometry = QRect());
+    void setGeometry(NodeId id, const QRect &geometry);
+
+    int windowCount() const { return _windows.size(); }
+    const Window &window(int index) const { return _windows.at(index); }
+    bool isValid(NodeId id) const;
+    const Node &node(NodeId id) const { return _nodes.at(id); }
+    int windowOf(NodeId id) const;
+    // The node reached from the root splitter of a window by child indexes
+    NodeId nodeAt(int windowIndex, const QList<int> &path) const;
+    QList<NodeId> tabGroups() const;
+    bool validate() const;
+
+    // Dock operations, sized by the rules below
+    int addTab(NodeId group, const Tab &tab, int index = -1);
+    NodeId dockAtTabGroup(NodeId targetGroup, Region region, const Tab &tab);
+    NodeId dockAtRoot(int windowIndex, Region region, const Tab &tab);
+    int floatTab(NodeId group, int tabIndex, const QRect &geometry);
+    int addFloatWindow(const Tab &tab, const QRect &geometry);
+    bool closeTab(NodeId group, int tabIndex);
+    bool closeWindow(int windowIndex);
+    // Removes the tab for the caller to place again; an emptied tab group is removed with it
+    Tab takeTab(NodeId group, int tabIndex);
+    void setSizes(NodeId splitter, const QList<int> &sizes);
+    bool isLastTabInMainWindow(NodeId group) const;
+    void setCurrentTab(NodeId group, int tabIndex);
+
+    bool maximize(NodeId group, int tabIndex);
+    void restoreMaximized();
+    bool isMaximized() const { return _maximizedGroup != INVALID_NODE; }
+
+    // Geometry
+    void setHandleWidth(int width) { _handleWidth = width; }
+    void setMinimumSize(int size) { _minimumSize = size; }
+    void layout(const QSize &mainWindowSize);
+
+    // Hash of the tree, the sizes, the float geometries and the window states; window ids are
+    // pool identities and are left out. Both formats store it in their header
+    QByteArray fingerprint() const;
+    static QByteArray stateHash(const QJsonObject &state);
+    static QByteArray fingerprintFromJson(const QJsonObject &jsonObj);
+    static QByteArray fingerprintFromCbor(const QByteArray &data);
+
+    // Moves the inline states into the store, the tabs keep only the keys
+    void moveStatesTo(StateStore &store);
+
+    // Persistence, the format written by DockContainer::saveLayoutToJson.
+    // A fingerprint already computed for this model can be passed to save hashing it again
+    void toJson(QJsonObject &jsonObj, const QByteArray &fingerprint = QByteArray()) const;
+    bool fromJson(const QJsonObject &jsonObj);
+
+    // Versioned CBOR with integer keys and ordered child arrays, read as a stream.
+    // fromCbor fails on data of another format or a newer version and leaves the model empty
+    static const int CBOR_FORMAT_VERSION = 1;
+    QByteArray toCbor(const QByteArray &fingerprint = QByteArray()) const;
+    bool fromCbor(const QByteArray &data);
+
+    // The size rules of the dock operations; DockContainer sizes its widgets with the same functions
+    static const int WIDGET_MIN_SIZE = 100;
+    static const int ROOT_DOCKED_SIZE_HINT = 200;
+    // A tab docked beside a node of extent along the split: the new node and that one, in order
+    static QList<int> splitSizes(int extent, bool isBefore);
+    // The same into the splitter already holding the node at index, its sizes given
+    static QList<int> sizesAfterDockBeside(const QList<int> &sizes, int index, int extent, bool isBefore);
+    // A tab docked at a side of a window whose root splitter runs across: the new node and the old root, in order
+    static QList<int> rootSplitSizes(int extent, bool isToHead);
+    static QList<int> recalcRootSplitterSizesAfterAddNew(const QList<int> &oldSizes, int newItemSizeHint, bool isToHead);
+
+private:
+    NodeId allocNode(NodeKind kind);
+    void freeNode(NodeId id);
+    void freeSubtree(NodeId id);
+    void removeEmptyNode(NodeId id);
+    void replaceChild(NodeId splitter, NodeId oldChild, NodeId newChild);
+    int sizeAlong(NodeId id, Qt::Orientation orientation) const;
+    QList<int> childSizes(NodeId splitter) const;
+    void relayout();
+    void layoutNode(NodeId id, const QRect &rect);
+    void hideNode(NodeId id);
+
+    void saveSplitterToJson(NodeId id, int size, QJsonObject &jsonObj) const;
+    void saveTabGroupToJson(NodeId id, int size, QJsonObject &jsonObj) const;
+    NodeId createSplitterFromJson(const QJsonObject &jsonObj);
+    NodeId createTabGroupFromJson(const QJsonObject &jsonObj);
+
+    void addNodeToHash(NodeId id, QCryptographicHash &hash) const;
+    static QByteArray tabStateHash(const Tab &tab);
+
+    void saveNodeToCbor(NodeId id, QCborStreamWriter &writer) const;
+    bool readWindowFromCbor(QCborStreamReader &reader);
+    NodeId readNodeFromCbor(QCborStreamReader &reader);
+    bool readTabFromCbor(QCborStreamReader &reader, Tab &tab);
+
+private:
+    QList<Node> _nodes;
+    QList<NodeId> _freeNodes;
+    QList<Window> _windows;
+    QSize _mainWindowSize;
+    int _handleWidth;
+    int _minimumSize;
+    NodeId _maximizedGroup;
+    int _maximizedTab;
+};
+
+}
+
+#endif // DOCKMODEL_H
@@ -0,0 +1,338 @@
+#include <QWidget>
+
+#include "DockTree.h"
+#include "Splitter.h"
+#include "TabWidget.h"
+
+namespace dock {
+
+DockTree::DockTree()
+{
+}
+
+DockTree::~DockTree()
+{
+    clear();
+}
+
+void DockTree::clear()
+{
+    for (auto iter = _nodes.begin(); iter != _nodes.end(); iter++)
+    {
+        delete iter.value();
+    }
+    for (auto iter = _rootBySplitter.begin(); iter != _rootBySplitter.end(); iter++)
+    {
+        delete iter.value();
+    }
+    _nodes.clear();
+    _windowToTabGroup.clear();
+    _rootBySplitter.clear();
+}
+
+DockTree::Node *DockTree::newNode(NodeKind kind, QWidget *widget)
+{
+    Node *node = new Node;
+    node->kind = kind;
+    node->widget = widget;
+    node->parent = nullptr;
+    node->root = nullptr;
+    node->tabCount = 0;
+    node->tabGroupCount = 0;
+    return node;
+}
+
+void DockTree::addSplitter(Splitter *splitter)
+{
+    if (splitter == nullptr || _nodes.contains(splitter))
+    {
+        return;
+    }
+    _nodes.insert(splitter, newNode(SPLITTER, splitter));
+}
+
+void DockTree::addTabGroup(TabWidget *tabWidget)
+{
+    if (tabWidget == nullptr || _nodes.contains(tabWidget))
+    {
+        return;
+    }
+    _nodes.insert(tabWidget, newNode(TAB_GROUP, tabWidget));
+}
+
+void DockTree::removeNode(QWidget *widget)
+{
+    Node *node = _nodes.take(widget);
+    if (node == nullptr)
+    {
+        return;
+    }
+    Node *rootNode = (node->parent != nullptr && node->parent->kind == ROOT) ? node->parent : nullptr;
+    unlink(node);
+    if (rootNode != nullptr)
+    {
+        _rootBySplitter.remove(widget);
+        delete rootNode;
+    }
+    for (int i = 0; i < node->children.size(); i++)
+    {
+        node->children[i]->parent = nullptr;
+    }
+    for (int i = 0; i < node->windows.size(); i++)
+    {
+        _windowToTabGroup.remove(node->windows[i]);
+    }
+    delete node;
+}
+
+void DockTree::addRoot(Splitter *rootSplitter, QWidget *rootWindow)
+{
+    Node *child = findNode(rootSplitter);
+    if (child == nullptr || _rootBySplitter.contains(rootSplitter))
+    {
+        return;
+    }
+    Node *rootNode = newNode(ROOT, rootWindow);
+    unlink(child);
+    rootNode->children.append(child);
+    child->parent = rootNode;
+    setSubtreeRoot(child, rootNode);
+    _rootBySplitter.insert(rootSplitter, rootNode);
+}
+
+void DockTree::replaceRoot(Splitter *oldRootSplitter, Splitter *newRootSplitter)
+{
+    Node *child = findNode(newRootSplitter);
+    if (child == nullptr)
+    {
+        return;
+    }
+    Node *rootNode = _rootBySplitter.take(oldRootSplitter);
+    if (rootNode == nullptr)
+    {
+        return;
+    }
+    // The old root splitter has normally been moved below the new one already
+    Node *oldChild = findNode(oldRootSplitter);
+    if (oldChild != nullptr && oldChild->parent == rootNode)
+    {
+        unlink(oldChild);
+    }
+    unlink(child);
+    rootNode->children.append(child);
+    child->parent = rootNode;
+    setSubtreeRoot(child, rootNode);
+    _rootBySplitter.insert(newRootSplitter, rootNode);
+}
+
+void DockTree::insertChild(Splitter *parentSplitter, int index, QWidget *child)
+{
+    Node *parentNode = findNode(parentSplitter);
+    Node *childNode = findNode(child);
+    if (parentNode == nullptr || childNode == nullptr)
+    {
+        return;
+    }
+    unlink(childNode);
+    index = qBound(0, index, parentNode->children.size());
+    parentNode->children.insert(index, childNode);
+    childNode->parent = parentNode;
+    setSubtreeRoot(childNode, parentNode->root);
+}
+
+void DockTree::removeChild(Splitter *parentSplitter, QWidget *child)
+{
+    Node *childNode = findNode(child);
+    if (childNode != nullptr && childNode->parent != nullptr && childNode->parent->widget == parentSplitter)
+    {
+        unlink(childNode);
+    }
+}
+
+void DockTree::insertWindow(TabWidget *tabWidget, QWidget *window)
+{
+    Node *tabGroup = findNode(tabWidget);
+    if (tabGroup == nullptr || window == nullptr)
+    {
+        return;
+    }
+    removeWindow(window);
+    _windowToTabGroup.insert(window, tabGroup);
+    tabGroup->windows.append(window);
+    tabGroup->tabCount++;
+    if (tabGroup->root != nullptr)
+    {
+        tabGroup->root->tabCount++;
+    }
+}
+
+void DockTree::removeWindow(QWidget *window)
+{
+    Node *tabGroup = _windowToTabGroup.take(window);
+    if (tabGroup == nullptr)
+    {
+        return;
+    }
+    tabGroup->windows.removeOne(window);
+    tabGroup->tabCount--;
+    if (tabGroup->root != nullptr)
+    {
+        tabGroup->root->tabCount--;
+    }
+}
+
+Splitter *DockTree::parentSplitter(QWidget *widget) const
+{
+    Node *node = findNode(widget);
+    Node *parentNode = (node != nullptr) ? node->parent : ownerNode(widget);
+    if (parentNode != nullptr && parentNode->kind == TAB_GROUP)
+    {
+        parentNode = parentNode->parent;
+    }
+    if (parentNode == nullptr || parentNode->kind != SPLITTER)
+    {
+        return nullptr;
+    }
+    return static_cast<Splitter *>(parentNode->widget);
+}
+
+Splitter *DockTree::rootSplitter(QWidget *widget) const
+{
+    Node *node = findNode(widget);
+    if (node == nullptr)
+    {
+        node = ownerNode(widget);
+    }
+    if (node == nullptr)
+    {
+        return nullptr;
+    }
+    if (node->root != nullptr)
+    {
+        return static_cast<Splitter *>(node->root->children.first()->widget);
+    }
+    // Not attached yet, the top-most splitter of the detached branch
+    Node *top = nullptr;
+    for (Node *p = node; p != nullptr; p = p->parent)
+    {
+        if (p->kind == SPLITTER)
+        {
+            top = p;
+        }
+    }
+    return (top != nullptr) ? static_cast<Splitter *>(top->widget) : nullptr;
+}
+
+TabWidget *DockTree::parentTabWidget(QWidget *widget) const
+{
+    if (findNode(widget) != nullptr)
+    {
+        return nullptr;
+    }
+    Node *owner = ownerNode(widget);
+    if (owner == nullptr || owner->kind != TAB_GROUP)
+    {
+        return nullptr;
+    }
+    return static_cast<TabWidget *>(owner->widget);
+}
+
+QWidget *DockTree::rootWidget(QWidget *widget) const
+{
+    Node *rootNode = rootOf(widget);
+    if (rootNode == nullptr)
+    {
+        return nullptr;
+    }
+    if (rootNode->widget != nullptr)
+    {
+        return rootNode->widget;
+    }
+    return rootNode->children.first()->widget;
+}
+
+bool DockTree::isRootSplitter(Splitter *splitter) const
+{
+    return _rootBySplitter.contains(splitter);
+}
+
+int DockTree::rootTabCount(QWidget *widget) const
+{
+    Node *rootNode = rootOf(widget);
+    return (rootNode != nullptr) ? rootNode->tabCount : 0;
+}
+
+int DockTree::rootTabGroupCount(QWidget *widget) const
+{
+    Node *rootNode = rootOf(widget);
+    return (rootNode != nullptr) ? rootNode->tabGroupCount : 0;
+}
+
+DockTree::Node *DockTree::findNode(QWidget *widget) const
+{
+    return _nodes.value(widget, nullptr);
+}
+
+DockTree::Node *DockTree::ownerNode(QWidget *widget) const
+{
+    if (widget == nullptr)
+    {
+        return nullptr;
+    }
+    // Dockable windows sit in the stacked widget of their tab group, tab bars directly in it
+    Node *tabGroup = _windowToTabGroup.value(widget, nullptr);
+    if (tabGroup != nullptr)
+    {
+        return tabGroup;
+    }
+    return _nodes.value(widget->parentWidget(), nullptr);
+}
+
+DockTree::Node *DockTree::rootOf(QWidget *widget) const
+{
+    Node *node = findNode(widget);
+    if (node == nullptr)
+    {
+        node = ownerNode(widget);
+    }
+    return (node != nullptr) ? node->root : nullptr;
+}
+
+void DockTree::unlink(Node *node)
+{
+    if (node->parent != nullptr)
+    {
+        node->parent->children.removeOne(node);
+        node->parent = nullptr;
+    }
+    setSubtreeRoot(node, nullptr);
+}
+
+void DockTree::setSubtreeRoot(Node *node, Node *root)
+{
+    // Every node of a subtree shares the same root, so an unchanged root ends the walk
+    if (node->root == root)
+    {
+        return;
+    }
+    if (node->kind == TAB_GROUP)
+    {
+        if (node->root != nullptr)
+        {
+            node->root->tabGroupCount--;
+            node->root->tabCount -= node->tabCount;
+        }
+        if (root != nullptr)
+        {
+            root->tabGroupCount++;
+            root->tabCount += node->tabCount;
+        }
+    }
+    node->root = root;
+    for (int i = 0; i < node->children.size(); i++)
+    {
+        setSubtreeRoot(node->children[i], root);
+    }
+}
+
+}
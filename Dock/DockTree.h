@@ -0,0 +1,86 @@
+/**********************************************************
+* @file     DockTree.h
+* @brief    Node graph of the dock layout kept next to the widgets;
+*           parent, root and tab count queries are plain reads
+*
+***********************************************************/
+#ifndef DOCKTREE_H
+#define DOCKTREE_H
+
+#include <QList>
+#include <QHash>
+
+class QWidget;
+
+namespace dock {
+
+class Splitter;
+class TabWidget;
+
+class DockTree
+{
+public:
+    enum NodeKind
+    {
+        ROOT,
+        SPLITTER,
+        TAB_GROUP
+    };
+
+    struct Node
+    {
+        NodeKind kind;
+        QWidget *widget;        // ROOT: the widget reported as the root window, may be null
+        Node *parent;
+        Node *root;             // null while the node is not attached below a root
+        QList<Node *> children;
+        QList<QWidget *> windows;   // TAB_GROUP: the dockable windows it holds
+        int tabCount;           // TAB_GROUP: its windows, ROOT: windows of all its tab groups
+        int tabGroupCount;      // ROOT: tab groups below it
+    };
+
+    DockTree();
+    ~DockTree();
+
+    void clear();
+
+    // Nodes are created with the widget and linked when the widget is inserted
+    void addSplitter(Splitter *splitter);
+    void addTabGroup(TabWidget *tabWidget);
+    void removeNode(QWidget *widget);
+
+    void addRoot(Splitter *rootSplitter, QWidget *rootWindow);
+    void replaceRoot(Splitter *oldRootSplitter, Splitter *newRootSplitter);
+
+    void insertChild(Splitter *parentSplitter, int index, QWidget *child);
+    void removeChild(Splitter *parentSplitter, QWidget *child);
+    void insertWindow(TabWidget *tabWidget, QWidget *window);
+    void removeWindow(QWidget *window);
+
+    Splitter *parentSplitter(QWidget *widget) const;
+    Splitter *rootSplitter(QWidget *widget) const;
+    TabWidget *parentTabWidget(QWidget *widget) const;
+    // The root window registered for the root of widget, or its root splitter if none was given
+    QWidget *rootWidget(QWidget *widget) const;
+    bool isRootSplitter(Splitter *splitter) const;
+
+    int rootTabCount(QWidget *widget) const;
+    int rootTabGroupCount(QWidget *widget) const;
+
+private:
+    Node *newNode(NodeKind kind, QWidget *widget);
+    Node *findNode(QWidget *widget) const;
+    Node *ownerNode(QWidget *widget) const;
+    Node *rootOf(QWidget *widget) const;
+    void unlink(Node *node);
+    void setSubtreeRoot(Node *node, Node *root);
+
+private:
+    QHash<QWidget *, Node *> _nodes;
+    QHash<QWidget *, Node *> _windowToTabGroup;
+    QHash<QWidget *, Node *> _rootBySplitter;
+};
+
+}
+
+#endif // DOCKTREE_H
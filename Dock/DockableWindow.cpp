@@ -1,9 +1,12 @@
 #include "DockableWindow.h"
+#include "DockModel.h"
 
 namespace dock {
 
 DockableWindow::DockableWindow(QWidget *parent)
     : QWidget(parent)
+    , _stateRevision(1)
+    , _savedRevision(0)
 {
 }
 
@@ -32,6 +35,48 @@ QString DockableWindow::getTitle()
     return pFactory->getTitle();
 }
 
+void DockableWindow::markStateDirty()
+{
+    _stateRevision++;
+    emit stateMarkedDirty();
+}
+
+QJsonObject DockableWindow::savedState(bool *isReused)
+{
+    bool isClean = tracksStateChanges() && _savedRevision == _stateRevision;
+    if (isReused != nullptr)
+    {
+        *isReused = isClean;
+    }
+    if (isClean)
+    {
+        return _savedState;
+    }
+    QJsonObject state;
+    saveObject(state);
+    if (tracksStateChanges())
+    {
+        _savedState = state;
+        _savedStateHash.clear();
+        _savedRevision = _stateRevision;
+    }
+    return state;
+}
+
+QByteArray DockableWindow::savedStateHash()
+{
+    if (!tracksStateChanges())
+    {
+        return DockModel::stateHash(savedState());
+    }
+    QJsonObject state = savedState();
+    if (_savedStateHash.isEmpty())
+    {
+        _savedStateHash = DockModel::stateHash(state);
+    }
+    return _savedStateHash;
+}
+
 int DockableWindow::windowType()
 {
     const QMetaObject *meta = metaObject();
@@ -42,4 +87,22 @@ int DockableWindow::windowType()
     return (int)qHash(QString(meta->className()));
 }
 
+bool DockableWindow::recycle()
+{
+    if (!onRecycle())
+    {
+        return false;
+    }
+    _stateRevision = 1;
+    _savedRevision = 0;
+    _savedState = QJsonObject();
+    _savedStateHash.clear();
+    return true;
+}
+
+qint64 DockableWindow::memoryCost() const
+{
+    return qint64(width()) * height() * 4;
+}
+
 }
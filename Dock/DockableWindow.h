@@ -21,7 +21,8 @@
 //@param ClassName: Class name
 //@param Title: Default window title
 //@param IsUnique: Whether the window can only have one instance
-#define DEC_WINDOW_FACTORY(ClassName, Title, IsUnique)							\
+//@param RecycleLimit: Closed windows kept for reuse, 0 to delete them
+#define DEC_RECYCLABLE_WINDOW_FACTORY(ClassName, Title, IsUnique, RecycleLimit)	\
 class ClassName##Factory : public dock::WindowFactory							\
 {																				\
 public:																			\
@@ -31,6 +32,7 @@ public:																			\
         pManager->registerFactory(qHash(QString(#ClassName)), this); 			\
     }																			\
     virtual bool isUnique() override { return IsUnique; }						\
+    virtual int recycleLimit() override { return RecycleLimit; }				\
     virtual QString getTitle() override { return QStringLiteral(Title); }  		\
     virtual dock::DockableWindow* create(QWidget* p) override							\
     {																			\
@@ -38,6 +40,9 @@ public:																			\
     }                                                                           \
 };
 
+#define DEC_WINDOW_FACTORY(ClassName, Title, IsUnique)							\
+        DEC_RECYCLABLE_WINDOW_FACTORY(ClassName, Title, IsUnique, 0)
+
 // Static registration macro, if automatic registration is not needed, use DEC_WINDOW_FACTORY and REGISTER_WINDOW
 //@param ClassName: Class name
 //@param Title: Default window title
@@ -46,6 +51,11 @@ public:																			\
         DEC_WINDOW_FACTORY(ClassName, Title, IsUnique)							\
 static ClassName##Factory g_##ClassName##FactoryInstance;
 
+// Static registration of a window type whose closed windows are reused, see WindowFactory::recycleLimit
+#define STATIC_REGISTER_RECYCLABLE_WINDOW(ClassName, Title, IsUnique, RecycleLimit)	\
+        DEC_RECYCLABLE_WINDOW_FACTORY(ClassName, Title, IsUnique, RecycleLimit)	\
+static ClassName##Factory g_##ClassName##FactoryInstance;
+
 #define REGISTER_WINDOW(ClassName)												\
         WindowFactoryManager::getInstance()->registerFactory(qHash(QString(#ClassName)), \
         new ClassName##Factory, true);
@@ -68,6 +78,8 @@ public:
     virtual void onContextMenu(QMenu* menu) { (void)menu; }
     virtual bool canClose() {return true;}
     virtual bool load(const QJsonObject &jsonObj) { (void)jsonObj; return true; }
+    // Used instead of load when the factory is async, with what WindowFactory::prepare returned
+    virtual bool attach(const QVariant &prepared) { (void)prepared; return true; }
     virtual void saveObject(QJsonObject &jsonObj)
     {
         //todo test code
@@ -76,6 +88,38 @@ public:
 
     virtual QString getTitle();
     int windowType();
+
+    // A window that calls markStateDirty whenever what saveObject writes changes has its state
+    // serialized once per change; the others are asked on every save
+    virtual bool tracksStateChanges() const { return false; }
+    void markStateDirty();
+    quint64 stateRevision() const { return _stateRevision; }
+    // saveObject, or its result kept from the last save while the state is clean
+    QJsonObject savedState(bool *isReused = nullptr);
+    // Hash of savedState() for layout fingerprints, computed once per revision
+    QByteArray savedStateHash();
+
+    // Bytes the window holds while the pool keeps it hidden, weighed against the pool budget.
+    // By default its area at 4 bytes a pixel; windows holding large data report that instead
+    virtual qint64 memoryCost() const;
+
+    // Recycling, for factories with a recycleLimit. onRecycle resets a closed window to what
+    // create returns, false to have it deleted instead; onReuse runs before newWindow hands it
+    // out again, load follows as for a new window
+    virtual bool onRecycle() { return true; }
+    virtual void onReuse() {}
+    // onRecycle, then the saved state of the closed window is forgotten
+    bool recycle();
+
+signals:
+    // Emitted by markStateDirty
+    void stateMarkedDirty();
+
+private:
+    quint64 _stateRevision;
+    quint64 _savedRevision;
+    QJsonObject _savedState;
+    QByteArray _savedStateHash;
 };
 
 
@@ -1,11 +1,210 @@
 #include "DockableWindowPool.h"
 #include "DockableWindow.h"
+#include "StateStore.h"
+
+#include <QElapsedTimer>
+#include <QEvent>
+#include <QCborMap>
+#include <QCborValue>
+#include <algorithm>
 
 namespace dock {
 
+// Window id: generation of the slot above the slot index
+static const int SLOT_INDEX_BITS = 16;
+static const int SLOT_INDEX_MASK = (1 << SLOT_INDEX_BITS) - 1;
+static const int GENERATION_MASK = 0x7fff;
+
+static int makeWindowID(int slotIndex, int generation)
+{
+    return (generation << SLOT_INDEX_BITS) | slotIndex;
+}
+
+// Moves a pooled window within its visible list whenever its widget is shown or hidden
+class WindowShowWatcher : public QObject
+{
+public:
+    explicit WindowShowWatcher(DockableWindowPool *pool) : _pool(pool) {}
+
+protected:
+    virtual bool eventFilter(QObject *obj, QEvent *event) override
+    {
+        if (event->type() == QEvent::Show || event->type() == QEvent::Hide)
+        {
+            _pool->onWindowShown(static_cast<DockableWindow *>(obj));
+        }
+        return false;
+    }
+
+private:
+    DockableWindowPool *_pool;
+};
+
 DockableWindowPool::DockableWindowPool()
+    : _maxHiddenWindows(-1)
+    , _maxHiddenCost(-1)
+    , _hideClock(0)
+    , _evictionCount(0)
+    , _stateStore(nullptr)
+    , _showWatcher(new WindowShowWatcher(this))
+{
+
+}
+
+DockableWindowPool::~DockableWindowPool()
+{
+    delete _showWatcher;
+}
+
+const DockableWindowPool::WindowSlot *DockableWindowPool::findSlot(uint type, int winId) const
+{
+    if (!isValidID(winId))
+    {
+        return nullptr;
+    }
+    auto iter = _mapTypeToSlots.constFind(type);
+    if (iter == _mapTypeToSlots.constEnd())
+    {
+        return nullptr;
+    }
+    int slotIndex = winId & SLOT_INDEX_MASK;
+    if (slotIndex >= iter.value().entries.size())
+    {
+        return nullptr;
+    }
+    const WindowSlot &slot = iter.value().entries.at(slotIndex);
+    if (slot.window == nullptr || slot.generation != (winId >> SLOT_INDEX_BITS))
+    {
+        return nullptr;
+    }
+    return &slot;
+}
+
+DockableWindowPool::WindowSlot *DockableWindowPool::findSlot(uint type, int winId)
+{
+    return const_cast<WindowSlot *>(static_cast<const DockableWindowPool *>(this)->findSlot(type, winId));
+}
+
+DockableWindowPool::SlotList &DockableWindowPool::slotList(WindowSlots &typeSlots, const WindowSlot &slot)
+{
+    if (slot.isEvicted)
+    {
+        return typeSlots.evicted;
+    }
+    return slot.isVisible ? typeSlots.visible : typeSlots.hidden;
+}
+
+void DockableWindowPool::linkSlot(WindowSlots &typeSlots, int slotIndex)
+{
+    WindowSlot &slot = typeSlots.entries[slotIndex];
+    SlotList &list = slotList(typeSlots, slot);
+    if (&list == &typeSlots.hidden)
+    {
+        slot.cost = slot.window->memoryCost();
+        slot.hiddenAt = ++_hideClock;
+    }
+    else if (&list != &typeSlots.evicted)
+    {
+        slot.cost = 0;
+    }
+    // A shown widget goes to the head of the visible list, anything else to the tail: the shown
+    // windows always come first
+    if (&list == &typeSlots.visible && slot.window->isVisible())
+    {
+        slot.prev = -1;
+        slot.next = list.first;
+        if (list.first >= 0)
+        {
+            typeSlots.entries[list.first].prev = slotIndex;
+        }
+        else
+        {
+            list.last = slotIndex;
+        }
+        list.first = slotIndex;
+    }
+    else
+    {
+        slot.prev = list.last;
+        slot.next = -1;
+        if (list.last >= 0)
+        {
+            typeSlots.entries[list.last].next = slotIndex;
+        }
+        else
+        {
+            list.first = slotIndex;
+        }
+        list.last = slotIndex;
+    }
+    list.count++;
+    list.cost += slot.cost;
+}
+
+void DockableWindowPool::unlinkSlot(WindowSlots &typeSlots, int slotIndex)
+{
+    WindowSlot &slot = typeSlots.entries[slotIndex];
+    SlotList &list = slotList(typeSlots, slot);
+    if (slot.prev >= 0)
+    {
+        typeSlots.entries[slot.prev].next = slot.next;
+    }
+    else
+    {
+        list.first = slot.next;
+    }
+    if (slot.next >= 0)
+    {
+        typeSlots.entries[slot.next].prev = slot.prev;
+    }
+    else
+    {
+        list.last = slot.prev;
+    }
+    slot.prev = -1;
+    slot.next = -1;
+    list.count--;
+    list.cost -= slot.cost;
+}
+
+void DockableWindowPool::setSlotVisible(WindowSlots &typeSlots, int slotIndex, bool isVisible)
 {
+    WindowSlot &slot = typeSlots.entries[slotIndex];
+    if (slot.window == nullptr || slot.isVisible == isVisible)
+    {
+        return;
+    }
+    unlinkSlot(typeSlots, slotIndex);
+    slot.isVisible = isVisible;
+    linkSlot(typeSlots, slotIndex);
+}
+
+void DockableWindowPool::onWindowShown(DockableWindow *w)
+{
+    auto iter = _mapWindowToTypeID.constFind(w);
+    if (iter == _mapWindowToTypeID.constEnd())
+    {
+        return;
+    }
+    WindowSlot *slot = findSlot(iter.value().first, iter.value().second);
+    if (slot == nullptr || !slot->isVisible)
+    {
+        return;
+    }
+    WindowSlots &typeSlots = _mapTypeToSlots[iter.value().first];
+    int slotIndex = iter.value().second & SLOT_INDEX_MASK;
+    unlinkSlot(typeSlots, slotIndex);
+    linkSlot(typeSlots, slotIndex);
+}
 
+void DockableWindowPool::setVisible(DockableWindow *w, bool isVisible)
+{
+    auto iter = _mapWindowToTypeID.constFind(w);
+    if (iter == _mapWindowToTypeID.constEnd() || findSlot(iter.value().first, iter.value().second) == nullptr)
+    {
+        return;
+    }
+    setSlotVisible(_mapTypeToSlots[iter.value().first], iter.value().second & SLOT_INDEX_MASK, isVisible);
 }
 
 bool DockableWindowPool::isDockedWindow(QWidget *w)
@@ -19,19 +218,31 @@ bool DockableWindowPool::isDockedWindow(QWidget *w)
     {
         return false;
     }
-    return _mapVisibleWindowToTypeID.contains(window);
+    auto iter = _mapWindowToTypeID.constFind(window);
+    if (iter == _mapWindowToTypeID.constEnd())
+    {
+        return false;
+    }
+    WindowSlot *slot = findSlot(iter.value().first, iter.value().second);
+    return slot != nullptr && slot->isVisible;
 }
 
-int DockableWindowPool::windowID(DockableWindow *w)
+int DockableWindowPool::windowID(DockableWindow *w) const
 {
-    auto iter = _mapVisibleWindowToTypeID.find(w);
-    if (iter == _mapVisibleWindowToTypeID.end())
+    auto iter = _mapWindowToTypeID.constFind(w);
+    if (iter == _mapWindowToTypeID.constEnd())
     {
         return -1;
     }
     return iter.value().second;
 }
 
+DockableWindow *DockableWindowPool::findWindow(uint type, int winId) const
+{
+    const WindowSlot *slot = findSlot(type, winId);
+    return (slot != nullptr) ? slot->window : nullptr;
+}
+
 DockableWindow *DockableWindowPool::newWindow(uint type)
 {
     auto f = WindowFactoryManager::getInstance()->getFactory(type);
@@ -39,104 +250,170 @@ DockableWindow *DockableWindowPool::newWindow(uint type)
     {
         return nullptr;
     }
-    auto iter = _mapTypeToWindowList.find(type);
-    if (iter != _mapTypeToWindowList.end())
+    auto iter = _mapTypeToSlots.find(type);
+    if (iter != _mapTypeToSlots.end())
     {
-        QList<DockableWindow*> windowList = iter.value();
-        for (int i = 0; i < windowList.size(); i++)
+        WindowSlots &typeSlots = iter.value();
+        // The window hidden last is the one most likely still warm
+        int slotIndex = typeSlots.hidden.last;
+        if (slotIndex >= 0)
         {
-            DockableWindow *w = windowList[i];
-            if (!_mapVisibleWindowToTypeID.contains(w))// If the window is not visible, add it to the visible container list
-            {
-                _mapVisibleWindowToTypeID.insert(w, qMakePair(w->windowType(), i));
-                return w;
-            }
-            else
-            {
-                if (f->isUnique())
-                {
-                    // If the window is unique, return nullptr
-                    return nullptr;
-                }
-            }
+            setSlotVisible(typeSlots, slotIndex, true);
+            return typeSlots.entries[slotIndex].window;
+        }
+        if (f->isUnique() && typeSlots.visible.count > 0)
+        {
+            // If the window is unique, return nullptr
+            return nullptr;
+        }
+        if (typeSlots.evicted.last >= 0)
+        {
+            return restoreEvictedSlot(type, typeSlots, typeSlots.evicted.last);
         }
     }
-    DockableWindow *w = f->create(nullptr);
+    WindowOpening opening;
+    opening.timer.start();
+    DockableWindow *w = nullptr;
+    bool isRecycled = false;
+    auto iterRecycled = _mapTypeToRecycled.find(type);
+    if (iterRecycled != _mapTypeToRecycled.end() && !iterRecycled.value().isEmpty())
+    {
+        // Recycled windows first, they would otherwise sit idle next to a full reserve
+        w = iterRecycled.value().takeLast();
+        w->onReuse();
+        isRecycled = true;
+    }
+    auto iterReserve = _mapTypeToReserve.find(type);
+    if (w == nullptr && iterReserve != _mapTypeToReserve.end() && !iterReserve.value().isEmpty())
+    {
+        w = iterReserve.value().takeLast();
+    }
+    bool isHit = (w != nullptr);
+    if (!isHit)
+    {
+        w = f->create(nullptr);
+    }
     registerWindow(w);
+    opening.isHit = isHit;
+    _mapWindowToOpening.insert(w, opening);
+    if (isRecycled)
+    {
+        _mapTypeToReserveStats[type].recycled++;
+    }
+    else if (isHit && _reserveTakenCallback)
+    {
+        _reserveTakenCallback();
+    }
     return w;
 }
 
-DockableWindow* DockableWindowPool::getFistVisibleWindow(uint type)
+void DockableWindowPool::windowReady(DockableWindow *w)
 {
-    if (!_mapTypeToWindowList.contains(type))
+    auto iterOpening = _mapWindowToOpening.find(w);
+    if (iterOpening == _mapWindowToOpening.end())
     {
-        return nullptr;
+        return;
     }
-    QList<DockableWindow*> list = _mapTypeToWindowList[type];
-    for (int i = 0; i < list.size(); i++)
+    auto iterWindow = _mapWindowToTypeID.constFind(w);
+    if (iterWindow != _mapWindowToTypeID.constEnd())
     {
-        if (_mapVisibleWindowToTypeID.contains(list[i]) && list[i]->isVisible())
+        WindowReserveStats &stats = _mapTypeToReserveStats[iterWindow.value().first];
+        qint64 nsecs = iterOpening->timer.nsecsElapsed();
+        if (iterOpening->isHit)
         {
-            return list[i];
+            stats.hits++;
+            stats.hitNsecs += nsecs;
+        }
+        else
+        {
+            stats.misses++;
+            stats.missNsecs += nsecs;
         }
     }
-    return nullptr;
+    _mapWindowToOpening.erase(iterOpening);
 }
 
-DockableWindow *DockableWindowPool::getOneExistedWindow(uint type)
+DockableWindow* DockableWindowPool::getFistVisibleWindow(uint type)
 {
-    if (!_mapTypeToWindowList.contains(type))
+    auto iter = _mapTypeToSlots.constFind(type);
+    if (iter == _mapTypeToSlots.constEnd())
     {
         return nullptr;
     }
-    QList<DockableWindow*> list = _mapTypeToWindowList[type];
-    for (int i = 0; i < list.size(); i++)
+    int slotIndex = iter.value().visible.first;
+    if (slotIndex < 0)
     {
-        if (_mapVisibleWindowToTypeID.contains(list[i]))
-        {
-            return list[i];
-        }
+        return nullptr;
     }
-    return nullptr;
+    DockableWindow *w = iter.value().entries.at(slotIndex).window;
+    return w->isVisible() ? w : nullptr;
 }
 
-DockableWindow *DockableWindowPool::getWindow(uint type, int winId)
+DockableWindow *DockableWindowPool::getOneExistedWindow(uint type)
 {
-    auto iter = _mapTypeToWindowList.find(type);
-    if (iter == _mapTypeToWindowList.end())
+    auto iter = _mapTypeToSlots.constFind(type);
+    if (iter == _mapTypeToSlots.constEnd())
     {
-        Q_ASSERT(false);
         return nullptr;
     }
-    auto windowList = iter.value();
-    if (winId < 0 || winId >= windowList.size())
+    int slotIndex = iter.value().visible.first;
+    return (slotIndex >= 0) ? iter.value().entries.at(slotIndex).window : nullptr;
+}
+
+DockableWindow *DockableWindowPool::getWindow(uint type, int winId)
+{
+    // An id from a layout of an earlier session, or of a deleted window, names no window here
+    WindowSlot *slot = findSlot(type, winId);
+    if (slot == nullptr)
     {
+        int evictedIndex = findEvictedSlot(type, winId);
+        if (evictedIndex >= 0)
+        {
+            return restoreEvictedSlot(type, _mapTypeToSlots[type], evictedIndex);
+        }
         return newWindow(type);
     }
-    DockableWindow *w = windowList[winId];
-    _mapVisibleWindowToTypeID.insert(w, qMakePair(w->windowType(), winId));
-    return windowList[winId];
+    setVisible(slot->window, true);
+    return slot->window;
 }
 
 int DockableWindowPool::registerWindow(DockableWindow *w)
 {
-    if (_mapVisibleWindowToTypeID.contains(w))
+    auto iterWindow = _mapWindowToTypeID.constFind(w);
+    if (iterWindow != _mapWindowToTypeID.constEnd())
     {
-        return -1;
+        // Already pooled, it is only shown again under its id
+        WindowSlot *slot = findSlot(iterWindow.value().first, iterWindow.value().second);
+        if (slot == nullptr || slot->isVisible)
+        {
+            return -1;
+        }
+        setVisible(w, true);
+        return iterWindow.value().second;
     }
 
-    QList<DockableWindow*> windowList;
-    auto iter = _mapTypeToWindowList.find(w->windowType());
-    if (iter != _mapTypeToWindowList.end())
+    uint type = w->windowType();
+    WindowSlots &typeSlots = _mapTypeToSlots[type];
+    int slotIndex = typeSlots.firstFree;
+    if (slotIndex >= 0)
     {
-        windowList = iter.value();
+        typeSlots.firstFree = typeSlots.entries[slotIndex].nextFree;
     }
-    windowList.append(w);
-
-    int wId = windowList.size() - 1;
-    _mapTypeToWindowList[w->windowType()] = windowList;
+    else
+    {
+        Q_ASSERT(typeSlots.entries.size() <= SLOT_INDEX_MASK);
+        slotIndex = typeSlots.entries.size();
+        typeSlots.entries.append(WindowSlot());
+    }
+    WindowSlot &slot = typeSlots.entries[slotIndex];
+    slot.window = w;
+    slot.isVisible = true;
+    slot.nextFree = -1;
+    linkSlot(typeSlots, slotIndex);
+    w->installEventFilter(_showWatcher);
 
-    _mapVisibleWindowToTypeID.insert(w, qMakePair(w->windowType(), wId));
+    int wId = makeWindowID(slotIndex, slot.generation);
+    _mapWindowToTypeID.insert(w, qMakePair(type, wId));
     return wId;
 }
 
@@ -147,64 +424,329 @@ void DockableWindowPool::deleteWindow(DockableWindow *w)
         //Q_ASSERT(false);
         return;
     }
-    int wId = -1;
-    auto iterWindow_TypeID = _mapVisibleWindowToTypeID.find(w);
-    if (iterWindow_TypeID == _mapVisibleWindowToTypeID.end())
+    auto iterWindow = _mapWindowToTypeID.find(w);
+    if (iterWindow == _mapWindowToTypeID.end())
     {
         return;
     }
-    wId = iterWindow_TypeID.value().second;
-    auto type = static_cast<int>(iterWindow_TypeID.value().first);
-    _mapVisibleWindowToTypeID.erase(iterWindow_TypeID);
+    uint type = iterWindow.value().first;
+    int wId = iterWindow.value().second;
+    _mapWindowToTypeID.erase(iterWindow);
+    _mapWindowToOpening.remove(w);
 
-    auto iterType_WindowList = _mapTypeToWindowList.find(type);
-    if (iterType_WindowList == _mapTypeToWindowList.end())
+    WindowSlot *slot = findSlot(type, wId);
+    if (slot == nullptr)
     {
         return;
     }
+    // The next window in this slot gets a new generation, the ids of the others stay as they are
+    WindowSlots &typeSlots = _mapTypeToSlots[type];
+    int slotIndex = wId & SLOT_INDEX_MASK;
+    unlinkSlot(typeSlots, slotIndex);
+    slot->window = nullptr;
+    slot->isVisible = false;
+    slot->generation = (slot->generation + 1) & GENERATION_MASK;
+    slot->nextFree = typeSlots.firstFree;
+    typeSlots.firstFree = slotIndex;
+}
 
-    QList<DockableWindow*> windowList = iterType_WindowList.value();
-    windowList.removeAt(wId);
-    _mapTypeToWindowList[iterType_WindowList.key()] = windowList;
-    for (int i = wId; i < windowList.size(); i++)
+void DockableWindowPool::hideAllWindowsBeforeChangeLayout()
+{
+    for (auto iter = _mapTypeToSlots.begin(); iter != _mapTypeToSlots.end(); iter++)
     {
-        if (i >= 0 && i < windowList.size() && windowList[i] != nullptr)
+        WindowSlots &typeSlots = iter.value();
+        while (typeSlots.visible.first >= 0)
         {
-            _mapVisibleWindowToTypeID[windowList[i]] = qMakePair(type, i);
+            int slotIndex = typeSlots.visible.first;
+            typeSlots.entries[slotIndex].window->setParent(nullptr);
+            setSlotVisible(typeSlots, slotIndex, false);
         }
     }
 }
 
-void DockableWindowPool::hideAllWindowsBeforeChangeLayout()
+void DockableWindowPool::hideWindow(DockableWindow *w)
 {
-    for (auto iter = _mapVisibleWindowToTypeID.begin(); iter != _mapVisibleWindowToTypeID.end(); iter++)
+    if (!isDockedWindow(w))
     {
-        DockableWindow *window = iter.key();
-        window->setParent(nullptr);
+        return;
     }
-    _mapVisibleWindowToTypeID.clear();
+    w->setParent(nullptr);
+    setVisible(w, false);
 }
 
-bool DockableWindowPool::hasWindow(int type)
+DockableWindow *DockableWindowPool::getHiddenWindow(uint type, int winId)
 {
-    if (!_mapTypeToWindowList.contains(type))
+    WindowSlot *slot = findSlot(type, winId);
+    if (slot == nullptr)
     {
-        return false;
+        int evictedIndex = findEvictedSlot(type, winId);
+        return (evictedIndex >= 0) ? restoreEvictedSlot(type, _mapTypeToSlots[type], evictedIndex) : nullptr;
+    }
+    if (slot->isVisible)
+    {
+        return nullptr;
     }
-    QList<DockableWindow*> list = _mapTypeToWindowList[type];
-    return !list.empty();
+    setVisible(slot->window, true);
+    return slot->window;
+}
+
+void DockableWindowPool::releaseWindow(DockableWindow *w)
+{
+    setVisible(w, false);
+}
+
+void DockableWindowPool::claimWindow(DockableWindow *w)
+{
+    setVisible(w, true);
+}
+
+bool DockableWindowPool::hasWindow(int type)
+{
+    auto iter = _mapTypeToSlots.constFind(type);
+    return iter != _mapTypeToSlots.constEnd() && iter.value().visible.count + iter.value().hidden.count > 0;
 }
 
 bool DockableWindowPool::hasVisibleWindow(int type)
 {
-    if (!_mapTypeToWindowList.contains(type))
+    return visibleWindowCount(type) > 0;
+}
+
+int DockableWindowPool::visibleWindowCount(uint type) const
+{
+    auto iter = _mapTypeToSlots.constFind(type);
+    return (iter != _mapTypeToSlots.constEnd()) ? iter.value().visible.count : 0;
+}
+
+int DockableWindowPool::hiddenWindowCount(uint type) const
+{
+    auto iter = _mapTypeToSlots.constFind(type);
+    return (iter != _mapTypeToSlots.constEnd()) ? iter.value().hidden.count : 0;
+}
+
+int DockableWindowPool::findEvictedSlot(uint type, int winId) const
+{
+    auto iter = _mapTypeToSlots.constFind(type);
+    if (!isValidID(winId) || iter == _mapTypeToSlots.constEnd())
     {
-        return false;
+        return -1;
+    }
+    int slotIndex = winId & SLOT_INDEX_MASK;
+    if (slotIndex >= iter.value().entries.size())
+    {
+        return -1;
+    }
+    const WindowSlot &slot = iter.value().entries.at(slotIndex);
+    return (slot.isEvicted && slot.generation == (winId >> SLOT_INDEX_BITS)) ? slotIndex : -1;
+}
+
+qint64 DockableWindowPool::evictSlot(WindowSlots &typeSlots, int slotIndex)
+{
+    WindowSlot &slot = typeSlots.entries[slotIndex];
+    DockableWindow *w = slot.window;
+    QJsonObject state = w->savedState();
+    QString key;
+    if (_stateStore != nullptr && !state.isEmpty())
+    {
+        key = _stateStore->put(state, w->savedStateHash());
+    }
+    unlinkSlot(typeSlots, slotIndex);
+    slot.window = nullptr;
+    slot.isEvicted = true;
+    slot.evictedStateKey = key;
+    slot.evictedState = key.isEmpty() ? state : QJsonObject();
+    slot.cost = slot.evictedState.isEmpty() ? 0 : QCborMap::fromJsonObject(slot.evictedState).toCborValue().toCbor().size();
+    qint64 cost = slot.cost;
+    linkSlot(typeSlots, slotIndex);
+    // Unregistered first, so its destroyed signal does not free the slot the id still names
+    _mapWindowToTypeID.remove(w);
+    _mapWindowToOpening.remove(w);
+    delete w;
+    _evictionCount++;
+    return cost;
+}
+
+void DockableWindowPool::dropEvictedSlot(WindowSlots &typeSlots, int slotIndex)
+{
+    // As for a deleted window: the id names nothing any more and the slot is free again
+    WindowSlot &slot = typeSlots.entries[slotIndex];
+    unlinkSlot(typeSlots, slotIndex);
+    slot.isEvicted = false;
+    slot.evictedStateKey.clear();
+    slot.evictedState = QJsonObject();
+    slot.cost = 0;
+    slot.generation = (slot.generation + 1) & GENERATION_MASK;
+    slot.nextFree = typeSlots.firstFree;
+    typeSlots.firstFree = slotIndex;
+}
+
+DockableWindow *DockableWindowPool::restoreEvictedSlot(uint type, WindowSlots &typeSlots, int slotIndex)
+{
+    auto f = WindowFactoryManager::getInstance()->getFactory(type);
+    DockableWindow *w = (f != nullptr) ? f->create(nullptr) : nullptr;
+    if (w == nullptr)
+    {
+        return nullptr;
+    }
+    WindowSlot &slot = typeSlots.entries[slotIndex];
+    QJsonObject state = slot.evictedState;
+    if (!slot.evictedStateKey.isEmpty() && _stateStore != nullptr)
+    {
+        state = _stateStore->get(slot.evictedStateKey);
+    }
+    unlinkSlot(typeSlots, slotIndex);
+    slot.isEvicted = false;
+    slot.evictedStateKey.clear();
+    slot.evictedState = QJsonObject();
+    slot.window = w;
+    slot.isVisible = true;
+    linkSlot(typeSlots, slotIndex);
+    _mapWindowToTypeID.insert(w, qMakePair(type, makeWindowID(slotIndex, slot.generation)));
+    w->installEventFilter(_showWatcher);
+    if (!state.isEmpty())
+    {
+        w->load(state);
+    }
+    return w;
+}
+
+void DockableWindowPool::setHiddenWindowBudget(int maxWindows, qint64 maxBytes)
+{
+    _maxHiddenWindows = maxWindows;
+    _maxHiddenCost = maxBytes;
+}
+
+void DockableWindowPool::setHiddenWindowLimit(uint type, int maxWindows)
+{
+    if (maxWindows < 0)
+    {
+        _mapTypeToHiddenLimit.remove(type);
+    }
+    else
+    {
+        _mapTypeToHiddenLimit.insert(type, maxWindows);
+    }
+}
+
+void DockableWindowPool::trimHiddenWindows()
+{
+    if (_maxHiddenWindows < 0 && _maxHiddenCost < 0 && _mapTypeToHiddenLimit.isEmpty())
+    {
+        return;
+    }
+    struct Candidate
+    {
+        uint type;
+        int slotIndex;
+        quint64 hiddenAt;
+        qint64 cost;
+        bool isEvicted;
+    };
+    // Windows of a cached layout are hidden too but still placed in it, only detached ones go.
+    // Evicted states held in memory count against the bytes only, and go in the same order
+    QVector<Candidate> candidates;
+    QHash<uint, int> typeCounts;
+    int count = 0;
+    qint64 cost = 0;
+    for (auto iter = _mapTypeToSlots.begin(); iter != _mapTypeToSlots.end(); iter++)
+    {
+        const WindowSlots &typeSlots = iter.value();
+        for (int i = typeSlots.hidden.first; i >= 0; i = typeSlots.entries.at(i).next)
+        {
+            const WindowSlot &slot = typeSlots.entries.at(i);
+            if (slot.window->parentWidget() != nullptr)
+            {
+                continue;
+            }
+            candidates.append(Candidate{iter.key(), i, slot.hiddenAt, slot.cost, false});
+            typeCounts[iter.key()]++;
+            count++;
+            cost += slot.cost;
+        }
+        for (int i = typeSlots.evicted.first; i >= 0; i = typeSlots.entries.at(i).next)
+        {
+            const WindowSlot &slot = typeSlots.entries.at(i);
+            if (slot.cost > 0)
+            {
+                candidates.append(Candidate{iter.key(), i, slot.hiddenAt, slot.cost, true});
+                cost += slot.cost;
+            }
+        }
     }
-    QList<DockableWindow*> list = _mapTypeToWindowList[type];
-    for (int i = 0; i < list.size(); i++)
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+        return a.hiddenAt < b.hiddenAt;
+    });
+    for (int i = 0; i < candidates.size(); i++)
     {
-        if (_mapVisibleWindowToTypeID.contains(list[i]))
+        const Candidate &candidate = candidates.at(i);
+        if (candidate.isEvicted)
+        {
+            if (_maxHiddenCost >= 0 && cost > _maxHiddenCost)
+            {
+                dropEvictedSlot(_mapTypeToSlots[candidate.type], candidate.slotIndex);
+                cost -= candidate.cost;
+            }
+            continue;
+        }
+        int limit = _mapTypeToHiddenLimit.value(candidate.type, -1);
+        bool isOverTypeLimit = limit >= 0 && typeCounts.value(candidate.type) > limit;
+        bool isOverBudget = (_maxHiddenWindows >= 0 && count > _maxHiddenWindows)
+                            || (_maxHiddenCost >= 0 && cost > _maxHiddenCost);
+        if (!isOverTypeLimit && !isOverBudget)
+        {
+            continue;
+        }
+        cost += evictSlot(_mapTypeToSlots[candidate.type], candidate.slotIndex) - candidate.cost;
+        typeCounts[candidate.type]--;
+        count--;
+    }
+}
+
+void DockableWindowPool::setReserveSize(uint type, int count)
+{
+    auto f = WindowFactoryManager::getInstance()->getFactory(type);
+    // A unique window is reused, never created twice
+    if (f == nullptr || f->isUnique())
+    {
+        count = 0;
+    }
+    QList<DockableWindow *> &reserve = _mapTypeToReserve[type];
+    while (reserve.size() > qMax(0, count))
+    {
+        delete reserve.takeLast();
+    }
+    if (count > 0)
+    {
+        _mapTypeToReserveSize.insert(type, count);
+    }
+    else
+    {
+        _mapTypeToReserveSize.remove(type);
+    }
+}
+
+bool DockableWindowPool::refillReserve()
+{
+    bool isCreated = false;
+    for (auto iter = _mapTypeToReserveSize.constBegin(); iter != _mapTypeToReserveSize.constEnd(); iter++)
+    {
+        QList<DockableWindow *> &reserve = _mapTypeToReserve[iter.key()];
+        if (reserve.size() >= iter.value())
+        {
+            continue;
+        }
+        if (isCreated)
+        {
+            return true;
+        }
+        auto f = WindowFactoryManager::getInstance()->getFactory(iter.key());
+        DockableWindow *w = (f != nullptr) ? f->create(nullptr) : nullptr;
+        if (w == nullptr)
+        {
+            continue;
+        }
+        reserve.append(w);
+        isCreated = true;
+        if (reserve.size() < iter.value())
         {
             return true;
         }
@@ -212,4 +754,39 @@ bool DockableWindowPool::hasVisibleWindow(int type)
     return false;
 }
 
+void DockableWindowPool::clearReserve()
+{
+    for (auto iter = _mapTypeToReserve.begin(); iter != _mapTypeToReserve.end(); iter++)
+    {
+        qDeleteAll(iter.value());
+        iter.value().clear();
+    }
+    for (auto iter = _mapTypeToRecycled.begin(); iter != _mapTypeToRecycled.end(); iter++)
+    {
+        qDeleteAll(iter.value());
+        iter.value().clear();
+    }
+}
+
+bool DockableWindowPool::recycleWindow(DockableWindow *w)
+{
+    auto iterWindow = _mapWindowToTypeID.constFind(w);
+    if (iterWindow == _mapWindowToTypeID.constEnd())
+    {
+        return false;
+    }
+    uint type = iterWindow.value().first;
+    auto f = WindowFactoryManager::getInstance()->getFactory(type);
+    QList<DockableWindow *> &recycled = _mapTypeToRecycled[type];
+    if (f == nullptr || recycled.size() >= f->recycleLimit() || !w->recycle())
+    {
+        return false;
+    }
+    // Its id is retired as for a deleted window, a layout naming it gets a new one
+    deleteWindow(w);
+    w->setParent(nullptr);
+    recycled.append(w);
+    return true;
+}
+
 }
@@ -10,8 +10,13 @@
 #ifndef DOCKABLEWINDOWMANAGER_H
 #define DOCKABLEWINDOWMANAGER_H
 
-#include <QSet>
-#include <QMap>
+#include <QHash>
+#include <QVector>
+#include <QList>
+#include <QPair>
+#include <QJsonObject>
+#include <QElapsedTimer>
+#include <functional>
 
 #include "WindowFactoryManager.h"
 
@@ -19,33 +24,178 @@ class QWidget;
 
 namespace dock {
 class DockableWindow;
+class WindowShowWatcher;
+class StateStore;
+
+// Windows newWindow created for one type, taken ready (recycled or pre-warmed) or built on the
+// spot. Both are timed from newWindow until windowReady, so the load of the state is included
+struct WindowReserveStats
+{
+    int hits;
+    int misses;
+    qint64 hitNsecs;
+    qint64 missNsecs;
+    int recycled;       // hits that reused a closed window
+    WindowReserveStats() : hits(0), misses(0), hitNsecs(0), missNsecs(0), recycled(0) {}
+};
 
 class DockableWindowPool
 {
 public:
     DockableWindowPool();
+    ~DockableWindowPool();
+
+    // Window ids are handles of a slot map per type: slot index and generation. An id stays
+    // valid until its window is deleted, and a deleted window's id never names another window,
+    // so ids written to layouts survive closing other windows. Without deletes the ids are
+    // 0, 1, 2... as layouts saved before handles were introduced have them
+    static bool isValidID(int winId) { return winId >= 0; }
 
     bool isDockedWindow(QWidget *w);
-    int windowID(DockableWindow *w);
+    // The id of a registered window, shown or hidden, -1 otherwise
+    int windowID(DockableWindow *w) const;
+    // The window winId names, nullptr for a stale or unknown id; nothing is shown or created
+    DockableWindow *findWindow(uint type, int winId) const;
     int registerWindow(DockableWindow* w);
 
     DockableWindow *newWindow(uint type = 0);
     DockableWindow *getWindow(uint type, int winId);
+    // The window registered as winId if no layout shows it, otherwise nullptr
+    DockableWindow *getHiddenWindow(uint type, int winId);
     DockableWindow *getOneExistedWindow(uint type);
+    // The head of the visible list if it is shown: constant time, see linkSlot
     DockableWindow* getFistVisibleWindow(uint type);
 
     void deleteWindow(DockableWindow* w);
     void hideAllWindowsBeforeChangeLayout();
+    void hideWindow(DockableWindow *w);
+    // Take a window out of or back into the visible set without moving it
+    void releaseWindow(DockableWindow *w);
+    void claimWindow(DockableWindow *w);
 
+    // Counted as windows are registered, shown, hidden and deleted: constant time, no allocation
     bool hasWindow(int type);
     bool hasVisibleWindow(int type);
+    int visibleWindowCount(uint type) const;
+    int hiddenWindowCount(uint type) const;
+
+    // Hidden windows no layout holds are evicted least recently hidden first, once there are
+    // more than maxWindows of them or they cost more than maxBytes (negative: no limit). An
+    // evicted window's state is kept from saveObject and its id stays reserved: asking for the
+    // id, or for a new window of the type, creates it again and hands the state to load.
+    // With a state store the slot keeps only the key; without one the state stays in memory,
+    // counts against maxBytes and is dropped least recently hidden first, retiring the id
+    void setHiddenWindowBudget(int maxWindows, qint64 maxBytes);
+    // Where evicted states go, not owned; it must outlive the windows evicted into it
+    void setStateStore(StateStore *store) { _stateStore = store; }
+    // At most maxWindows hidden windows of the type, negative to lift the cap
+    void setHiddenWindowLimit(uint type, int maxWindows);
+    // Applies the budget and the caps; the container calls it once a layout is built
+    void trimHiddenWindows();
+    int evictionCount() const { return _evictionCount; }
+
+    // Up to count instances of a non-unique type created ahead of time, so that newWindow only
+    // registers one. refillReserve creates one instance and returns whether more are missing;
+    // the callback runs when newWindow takes from a reserve, to schedule the refill
+    void setReserveSize(uint type, int count);
+    bool refillReserve();
+    // Deletes the reserved and the recycled instances
+    void clearReserve();
+
+    // A closed window of a type whose factory has a recycleLimit: unregistered, its id retired,
+    // and kept for newWindow while there is room and its onRecycle agrees. False if the caller
+    // must delete it
+    bool recycleWindow(DockableWindow *w);
+    int recycledWindowCount(uint type) const { return _mapTypeToRecycled.value(type).size(); }
+    void setReserveTakenCallback(const std::function<void()> &callback) { _reserveTakenCallback = callback; }
+    QHash<uint, WindowReserveStats> reserveStats() const { return _mapTypeToReserveStats; }
+    // Called once the container has loaded and docked a window newWindow returned
+    void windowReady(DockableWindow *w);
 
 private:
-    // Store currently visible windows
-    QMap<DockableWindow *, QPair<uint /*type*/, int /*id*/>> _mapVisibleWindowToTypeID;
+    friend class WindowShowWatcher;
+
+    struct WindowSlot
+    {
+        DockableWindow *window;     // nullptr while free
+        int generation;
+        bool isVisible;
+        bool isEvicted;             // window is nullptr, the state below holds it until it is created again
+        QString evictedStateKey;    // in the state store
+        QJsonObject evictedState;   // only without a store, or if the store could not take it
+        qint64 cost;                // memoryCost() when hidden, the size of evictedState when evicted
+        quint64 hiddenAt;
+        int nextFree;
+        // Links in the visible or the hidden list of the type, by slot index
+        int prev;
+        int next;
+        WindowSlot() : window(nullptr), generation(0), isVisible(false), isEvicted(false), cost(0), hiddenAt(0)
+            , nextFree(-1), prev(-1), next(-1) {}
+    };
+
+    struct SlotList
+    {
+        int first;
+        int last;
+        int count;
+        qint64 cost;
+        SlotList() : first(-1), last(-1), count(0), cost(0) {}
+    };
+
+    struct WindowSlots
+    {
+        QVector<WindowSlot> entries;
+        int firstFree;
+        // Visible: the widgets shown first, the one shown last at the head. Hidden and evicted:
+        // in the order the windows were hidden
+        SlotList visible;
+        SlotList hidden;
+        SlotList evicted;
+        WindowSlots() : firstFree(-1) {}
+    };
+
+    const WindowSlot *findSlot(uint type, int winId) const;
+    WindowSlot *findSlot(uint type, int winId);
+    void setVisible(DockableWindow *w, bool isVisible);
+    void setSlotVisible(WindowSlots &typeSlots, int slotIndex, bool isVisible);
+    void linkSlot(WindowSlots &typeSlots, int slotIndex);
+    void unlinkSlot(WindowSlots &typeSlots, int slotIndex);
+    void onWindowShown(DockableWindow *w);
+    SlotList &slotList(WindowSlots &typeSlots, const WindowSlot &slot);
+    // Returns what the slot still costs once evicted
+    qint64 evictSlot(WindowSlots &typeSlots, int slotIndex);
+    void dropEvictedSlot(WindowSlots &typeSlots, int slotIndex);
+    DockableWindow *restoreEvictedSlot(uint type, WindowSlots &typeSlots, int slotIndex);
+    int findEvictedSlot(uint type, int winId) const;
+
+private:
+    // Every registered window by type
+    QHash<uint, WindowSlots> _mapTypeToSlots;
+
+    // Type and id of every registered window
+    QHash<DockableWindow *, QPair<uint /*type*/, int /*id*/>> _mapWindowToTypeID;
+
+    int _maxHiddenWindows;
+    qint64 _maxHiddenCost;
+    QHash<uint, int> _mapTypeToHiddenLimit;
+    quint64 _hideClock;
+    int _evictionCount;
+    StateStore *_stateStore;
+    WindowShowWatcher *_showWatcher;
 
-    // Store all windows
-    QMap<uint, QList<DockableWindow *>> _mapTypeToWindowList;
+    // Created, not registered: they have no id until newWindow takes them
+    QHash<uint, QList<DockableWindow *>> _mapTypeToReserve;
+    QHash<uint, int> _mapTypeToReserveSize;
+    QHash<uint, WindowReserveStats> _mapTypeToReserveStats;
+    // Windows from newWindow not ready yet: hit or miss, and since when
+    struct WindowOpening
+    {
+        bool isHit;
+        QElapsedTimer timer;
+    };
+    QHash<DockableWindow *, WindowOpening> _mapWindowToOpening;
+    QHash<uint, QList<DockableWindow *>> _mapTypeToRecycled;
+    std::function<void()> _reserveTakenCallback;
 };
 }
 
@@ -0,0 +1,109 @@
+#include <QGuiApplication>
+#include <QScreen>
+#include <algorithm>
+
+#include "DragFramePacer.h"
+
+namespace dock {
+
+DragFramePacer::DragFramePacer(QObject *parent)
+    : QObject(parent)
+    , _hasPending(false)
+    , _isEnabled(true)
+    , _receivedCount(0)
+    , _processedCount(0)
+{
+    _frameTimer.setSingleShot(true);
+    _frameTimer.setTimerType(Qt::PreciseTimer);
+    connect(&_frameTimer, &QTimer::timeout, this, &DragFramePacer::onFrameTimeout);
+}
+
+DragFramePacer::~DragFramePacer()
+{
+}
+
+void DragFramePacer::setEnabled(bool enable)
+{
+    _isEnabled = enable;
+    if (!_isEnabled)
+    {
+        flush();
+    }
+}
+
+void DragFramePacer::pushMove(const QPoint &globalPos)
+{
+    _receivedCount++;
+    _pendingPos = globalPos;
+    _hasPending = true;
+    if (!_isEnabled)
+    {
+        processPending();
+        return;
+    }
+    if (_frameTimer.isActive())
+    {
+        return;
+    }
+    // The first move after a quiet frame goes through at once, later ones wait for the frame
+    int interval = frameInterval();
+    qint64 elapsed = _sinceLastProcessed.isValid() ? _sinceLastProcessed.elapsed() : interval;
+    if (elapsed >= interval)
+    {
+        processPending();
+    }
+    else
+    {
+        _frameTimer.start(interval - (int)elapsed);
+    }
+}
+
+void DragFramePacer::flush()
+{
+    _frameTimer.stop();
+    if (_hasPending)
+    {
+        processPending();
+    }
+}
+
+void DragFramePacer::cancel()
+{
+    _frameTimer.stop();
+    _hasPending = false;
+}
+
+void DragFramePacer::resetCounters()
+{
+    _receivedCount = 0;
+    _processedCount = 0;
+}
+
+void DragFramePacer::onFrameTimeout()
+{
+    if (_hasPending)
+    {
+        processPending();
+    }
+}
+
+int DragFramePacer::frameInterval() const
+{
+    qreal refreshRate = 60.0;
+    QScreen *screen = QGuiApplication::primaryScreen();
+    if (screen != nullptr && screen->refreshRate() > 1.0)
+    {
+        refreshRate = screen->refreshRate();
+    }
+    return std::max<int>(1, qRound(1000.0 / refreshRate));
+}
+
+void DragFramePacer::processPending()
+{
+    _hasPending = false;
+    _processedCount++;
+    _sinceLastProcessed.restart();
+    emit moveReady(_pendingPos);
+}
+
+}
@@ -0,0 +1,64 @@
+/**********************************************************
+* @file     DragFramePacer.h
+* @brief    Coalesces mouse moves of a drag so that at most one of them
+*           is processed per display frame
+*
+***********************************************************/
+#ifndef DRAGFRAMEPACER_H
+#define DRAGFRAMEPACER_H
+
+#include <QObject>
+#include <QPoint>
+#include <QTimer>
+#include <QElapsedTimer>
+
+#include "dock_global.h"
+
+namespace dock {
+
+class DOCKSHARED_EXPORT DragFramePacer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DragFramePacer(QObject *parent = nullptr);
+    virtual ~DragFramePacer();
+
+    // When disabled every pushed move is processed immediately
+    void setEnabled(bool enable);
+    bool isEnabled() const { return _isEnabled; }
+
+    // Remember the latest cursor position, process it now or at the next frame
+    void pushMove(const QPoint &globalPos);
+    // Process a pending move right away, used when the button is released
+    void flush();
+    // Drop a pending move without processing it
+    void cancel();
+
+    quint64 receivedCount() const { return _receivedCount; }
+    quint64 processedCount() const { return _processedCount; }
+    void resetCounters();
+
+signals:
+    void moveReady(const QPoint &globalPos);
+
+private slots:
+    void onFrameTimeout();
+
+private:
+    int frameInterval() const;
+    void processPending();
+
+private:
+    QTimer _frameTimer;
+    QElapsedTimer _sinceLastProcessed;
+    QPoint _pendingPos;
+    bool _hasPending;
+    bool _isEnabled;
+    quint64 _receivedCount;
+    quint64 _processedCount;
+};
+
+}
+
+#endif // DRAGFRAMEPACER_H
@@ -0,0 +1,110 @@
+#include <QPainter>
+#include <algorithm>
+
+#include "DropPreviewOverlay.h"
+
+namespace dock {
+
+const int PREVIEW_TAB_PADDING = 8;
+
+DropPreviewOverlay::DropPreviewOverlay(QWidget *parent)
+    : QWidget(parent)
+    , _window(parent)
+{
+    setObjectName("DropPreviewOverlay");
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    setAttribute(Qt::WA_NoSystemBackground);
+    setAttribute(Qt::WA_ShowWithoutActivating);
+    setFocusPolicy(Qt::NoFocus);
+}
+
+DropPreviewOverlay::~DropPreviewOverlay()
+{
+}
+
+void DropPreviewOverlay::setTitle(const QString &title)
+{
+    if (_title != title)
+    {
+        _title = title;
+        update();
+    }
+}
+
+void DropPreviewOverlay::showPreview(QWidget *window, const QRect &globalRect)
+{
+    if (window == nullptr)
+    {
+        return;
+    }
+    attachTo(window);
+    QRect localRect(window->mapFromGlobal(globalRect.topLeft()), globalRect.size());
+    if (localRect != _localPreviewRect)
+    {
+        update(_localPreviewRect.united(localRect));
+        _localPreviewRect = localRect;
+    }
+    if (isHidden())
+    {
+        show();
+    }
+}
+
+void DropPreviewOverlay::hidePreview()
+{
+    if (!isHidden())
+    {
+        hide();
+    }
+    _localPreviewRect = QRect();
+}
+
+void DropPreviewOverlay::attachTo(QWidget *window)
+{
+    if (_window != window)
+    {
+        // A plain child widget, moving it between windows needs no native window
+        _window = window;
+        setParent(window);
+        _localPreviewRect = QRect();
+    }
+    if (geometry() != window->rect())
+    {
+        setGeometry(window->rect());
+    }
+    raise();
+}
+
+QRect DropPreviewOverlay::previewRect() const
+{
+    return isWindow() ? rect() : _localPreviewRect;
+}
+
+void DropPreviewOverlay::paintEvent(QPaintEvent *event)
+{
+    (void)event;
+    QRect rect = previewRect();
+    if (rect.isEmpty())
+    {
+        return;
+    }
+    QPainter painter(this);
+    QColor highlight = palette().color(QPalette::Highlight);
+    QColor body = highlight;
+    body.setAlpha(isWindow() ? 255 : 80);
+
+    QFontMetrics metrics = fontMetrics();
+    int tabWidth = std::min<int>(metrics.horizontalAdvance(_title) + 2 * PREVIEW_TAB_PADDING, rect.width());
+    int tabHeight = std::min<int>(metrics.height() + PREVIEW_TAB_PADDING, rect.height());
+    QRect tabRect(rect.left(), rect.top(), tabWidth, tabHeight);
+    QRect bodyRect = rect.adjusted(0, tabHeight, 0, 0);
+
+    painter.fillRect(tabRect, highlight);
+    painter.setPen(palette().color(QPalette::HighlightedText));
+    painter.drawText(tabRect, Qt::AlignCenter, _title);
+    painter.fillRect(bodyRect, body);
+    painter.setPen(highlight);
+    painter.drawRect(bodyRect.adjusted(0, 0, -1, -1));
+}
+
+}
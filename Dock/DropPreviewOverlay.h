@@ -0,0 +1,42 @@
+/**********************************************************
+* @file     DropPreviewOverlay.h
+* @brief    Drop preview painted inside a top-level window while a tab is dragged;
+*           created without parent it serves as the ghost shown outside all windows
+*
+***********************************************************/
+#ifndef DROPPREVIEWOVERLAY_H
+#define DROPPREVIEWOVERLAY_H
+
+#include <QWidget>
+
+namespace dock {
+
+class DropPreviewOverlay : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit DropPreviewOverlay(QWidget *parent = nullptr);
+    virtual ~DropPreviewOverlay();
+
+    void setTitle(const QString &title);
+    // Show the preview at globalRect inside window, only repainting what changed
+    void showPreview(QWidget *window, const QRect &globalRect);
+    void hidePreview();
+
+protected:
+    virtual void paintEvent(QPaintEvent *event) override;
+
+private:
+    void attachTo(QWidget *window);
+    QRect previewRect() const;
+
+private:
+    QString _title;
+    QWidget *_window;
+    QRect _localPreviewRect;
+};
+
+}
+
+#endif // DROPPREVIEWOVERLAY_H
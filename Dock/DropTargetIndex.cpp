@@ -0,0 +1,220 @@
+#include <algorithm>
+
+#include "DropTargetIndex.h"
+
+namespace dock {
+
+// Width of the band around a window that docks at its root splitter
+const int WINDOW_BORDER_DOCK_SIZE = 20;
+
+void RectSlabs::clear()
+{
+    _edges.clear();
+    _slabStarts.clear();
+    _spans.clear();
+}
+
+void RectSlabs::build(const QList<QRect> &rects)
+{
+    clear();
+    for (int i = 0; i < rects.size(); i++)
+    {
+        _edges.append(rects[i].left());
+        _edges.append(rects[i].right() + 1);
+    }
+    std::sort(_edges.begin(), _edges.end());
+    _edges.erase(std::unique(_edges.begin(), _edges.end()), _edges.end());
+
+    for (int s = 0; s + 1 < _edges.size(); s++)
+    {
+        int start = _spans.size();
+        _slabStarts.append(start);
+        for (int i = 0; i < rects.size(); i++)
+        {
+            const QRect &r = rects[i];
+            if (r.left() <= _edges[s] && r.right() + 1 >= _edges[s + 1])
+            {
+                Span span;
+                span.top = r.top();
+                span.bottom = r.bottom();
+                span.index = i;
+                _spans.append(span);
+            }
+        }
+        std::sort(_spans.begin() + start, _spans.end(), [](const Span &a, const Span &b) {
+            return a.top < b.top;
+        });
+    }
+    _slabStarts.append(_spans.size());
+}
+
+int RectSlabs::find(const QPoint &p) const
+{
+    if (_edges.size() < 2)
+    {
+        return -1;
+    }
+    auto edge = std::upper_bound(_edges.cbegin(), _edges.cend(), p.x());
+    int slab = int(edge - _edges.cbegin()) - 1;
+    if (slab < 0 || slab >= _edges.size() - 1)
+    {
+        return -1;
+    }
+    auto begin = _spans.cbegin() + _slabStarts[slab];
+    auto end = _spans.cbegin() + _slabStarts[slab + 1];
+    auto span = std::upper_bound(begin, end, p.y(), [](int y, const Span &s) {
+        return y < s.top;
+    });
+    if (span == begin)
+    {
+        return -1;
+    }
+    --span;
+    return (p.y() <= span->bottom) ? span->index : -1;
+}
+
+void DropTargetIndex::clear()
+{
+    _windows.clear();
+}
+
+void DropTargetIndex::addWindow(QWidget *window, const QRect &frameRect, const QRect &clientRect, const QRect &dockRect, int z)
+{
+    WindowCell cell;
+    cell.window = window;
+    cell.frameRect = frameRect;
+    cell.clientRect = clientRect;
+    cell.dockRect = dockRect;
+    cell.z = z;
+    _windows.append(cell);
+}
+
+void DropTargetIndex::addTabBar(QWidget *window, QWidget *tabBar, const QRect &globalRect)
+{
+    WindowCell *cell = findCell(window);
+    if (cell == nullptr)
+    {
+        return;
+    }
+    Target target;
+    target.kind = TAB_BAR;
+    target.widget = tabBar;
+    target.window = window;
+    target.globalRect = globalRect;
+    cell->tabBars.append(target);
+}
+
+void DropTargetIndex::addTabWidget(QWidget *window, QWidget *tabWidget, const QRect &globalRect)
+{
+    WindowCell *cell = findCell(window);
+    if (cell == nullptr)
+    {
+        return;
+    }
+    Target target;
+    target.kind = TAB_WIDGET;
+    target.widget = tabWidget;
+    target.window = window;
+    target.globalRect = globalRect;
+    cell->tabWidgets.append(target);
+}
+
+void DropTargetIndex::build()
+{
+    std::stable_sort(_windows.begin(), _windows.end(), [](const WindowCell &a, const WindowCell &b) {
+        return a.z > b.z;
+    });
+    QList<QRect> rects;
+    for (int i = 0; i < _windows.size(); i++)
+    {
+        WindowCell &cell = _windows[i];
+        rects.clear();
+        for (int j = 0; j < cell.tabBars.size(); j++)
+        {
+            rects.append(cell.tabBars[j].globalRect);
+        }
+        cell.tabBarSlabs.build(rects);
+
+        rects.clear();
+        for (int j = 0; j < cell.tabWidgets.size(); j++)
+        {
+            rects.append(cell.tabWidgets[j].globalRect);
+        }
+        cell.tabWidgetSlabs.build(rects);
+    }
+}
+
+bool DropTargetIndex::hitTest(const QPoint &globalPos, Target &target) const
+{
+    for (int i = 0; i < _windows.size(); i++)
+    {
+        const WindowCell &cell = _windows[i];
+        if (!cell.frameRect.contains(globalPos))
+        {
+            continue;
+        }
+        // Tab bars win over the border band, the border band over the tab widgets
+        int index = cell.tabBarSlabs.find(globalPos);
+        if (index >= 0)
+        {
+            target = cell.tabBars[index];
+            return true;
+        }
+        if (isInBorder(cell, globalPos))
+        {
+            target = borderTarget(cell);
+            return true;
+        }
+        index = cell.tabWidgetSlabs.find(globalPos);
+        if (index >= 0)
+        {
+            target = cell.tabWidgets[index];
+            return true;
+        }
+        return false;
+    }
+
+    // Outside of every window, only the band around the windows accepts a drop
+    for (int i = 0; i < _windows.size(); i++)
+    {
+        if (isInBorder(_windows[i], globalPos))
+        {
+            target = borderTarget(_windows[i]);
+            return true;
+        }
+    }
+    return false;
+}
+
+DropTargetIndex::WindowCell *DropTargetIndex::findCell(QWidget *window)
+{
+    for (int i = 0; i < _windows.size(); i++)
+    {
+        if (_windows[i].window == window)
+        {
+            return &_windows[i];
+        }
+    }
+    return nullptr;
+}
+
+bool DropTargetIndex::isInBorder(const WindowCell &cell, const QPoint &p) const
+{
+    QRect expandRect = cell.frameRect.adjusted(-WINDOW_BORDER_DOCK_SIZE, -WINDOW_BORDER_DOCK_SIZE,
+                                               WINDOW_BORDER_DOCK_SIZE, WINDOW_BORDER_DOCK_SIZE);
+    QRect indentRect = cell.clientRect.adjusted(WINDOW_BORDER_DOCK_SIZE, WINDOW_BORDER_DOCK_SIZE,
+                                                -WINDOW_BORDER_DOCK_SIZE, -WINDOW_BORDER_DOCK_SIZE);
+    return expandRect.contains(p) && !indentRect.contains(p);
+}
+
+DropTargetIndex::Target DropTargetIndex::borderTarget(const WindowCell &cell) const
+{
+    Target target;
+    target.kind = WINDOW_BORDER;
+    target.widget = cell.window;
+    target.window = cell.window;
+    target.globalRect = cell.dockRect;
+    return target;
+}
+
+}
@@ -0,0 +1,91 @@
+/**********************************************************
+* @file     DropTargetIndex.h
+* @brief    Snapshot of all drop targets taken when a tab drag begins;
+*           hover resolution during the drag is a pure geometric lookup
+*
+***********************************************************/
+#ifndef DROPTARGETINDEX_H
+#define DROPTARGETINDEX_H
+
+#include <QList>
+#include <QRect>
+#include <QPoint>
+
+class QWidget;
+
+namespace dock {
+
+// Non overlapping rectangles cut into vertical slabs, each slab sorted by top,
+// so a point is found with two binary searches
+class RectSlabs
+{
+public:
+    void clear();
+    void build(const QList<QRect> &rects);
+    int find(const QPoint &p) const;
+
+private:
+    struct Span
+    {
+        int top;
+        int bottom;
+        int index;
+    };
+    QList<int> _edges;
+    QList<int> _slabStarts;
+    QList<Span> _spans;
+};
+
+class DropTargetIndex
+{
+public:
+    enum Kind
+    {
+        TAB_BAR,
+        TAB_WIDGET,
+        WINDOW_BORDER
+    };
+
+    struct Target
+    {
+        Kind kind;
+        QWidget *widget;
+        QWidget *window;
+        QRect globalRect;
+    };
+
+    void clear();
+    bool isEmpty() const { return _windows.isEmpty(); }
+
+    // dockRect is the area that docking at the window border is measured against
+    void addWindow(QWidget *window, const QRect &frameRect, const QRect &clientRect, const QRect &dockRect, int z);
+    void addTabBar(QWidget *window, QWidget *tabBar, const QRect &globalRect);
+    void addTabWidget(QWidget *window, QWidget *tabWidget, const QRect &globalRect);
+    void build();
+
+    bool hitTest(const QPoint &globalPos, Target &target) const;
+
+private:
+    struct WindowCell
+    {
+        QWidget *window;
+        QRect frameRect;
+        QRect clientRect;
+        QRect dockRect;
+        int z;
+        QList<Target> tabBars;
+        QList<Target> tabWidgets;
+        RectSlabs tabBarSlabs;
+        RectSlabs tabWidgetSlabs;
+    };
+    WindowCell *findCell(QWidget *window);
+    bool isInBorder(const WindowCell &cell, const QPoint &p) const;
+    Target borderTarget(const WindowCell &cell) const;
+
+    // Sorted top-most first after build()
+    QList<WindowCell> _windows;
+};
+
+}
+
+#endif // DROPTARGETINDEX_H
@@ -0,0 +1,348 @@
+#include <QSaveFile>
+#include <QCborStreamWriter>
+#include <QCborStreamReader>
+#include <QCborValue>
+#include <QCborMap>
+
+#include "LayoutJournal.h"
+
+namespace dock {
+
+// File: [version, main window width, height, DockModel::toCbor snapshot] then one
+// [operation, source window, [source path], source index, target window, [target path], target index, [extra], {state}]
+// per record, extra being the FLOAT geometry or the RESIZE and SIZES sizes
+static void writeInts(QCborStreamWriter &writer, const QList<int> &values)
+{
+    writer.startArray(values.size());
+    for (int i = 0; i < values.size(); i++)
+    {
+        writer.append(qint64(values.at(i)));
+    }
+    writer.endArray();
+}
+
+static bool readInt(QCborStreamReader &reader, int &value)
+{
+    if (!reader.isInteger())
+    {
+        return false;
+    }
+    value = (int)reader.toInteger();
+    reader.next();
+    return true;
+}
+
+static bool readInts(QCborStreamReader &reader, QList<int> &values)
+{
+    values.clear();
+    if (!reader.isArray() || !reader.enterContainer())
+    {
+        return false;
+    }
+    while (reader.lastError() == QCborError::NoError && reader.hasNext())
+    {
+        int value = 0;
+        if (!readInt(reader, value))
+        {
+            return false;
+        }
+        values.append(value);
+    }
+    return reader.leaveContainer();
+}
+
+static bool readBytes(QCborStreamReader &reader, QByteArray &bytes)
+{
+    if (!reader.isByteArray())
+    {
+        return false;
+    }
+    bytes.clear();
+    auto chunk = reader.readByteArray();
+    while (chunk.status == QCborStreamReader::Ok)
+    {
+        bytes += chunk.data;
+        chunk = reader.readByteArray();
+    }
+    return chunk.status == QCborStreamReader::EndOfString;
+}
+
+static bool readHeader(QCborStreamReader &reader, QSize &mainWindowSize, QByteArray &snapshot)
+{
+    if (!reader.isArray() || !reader.enterContainer())
+    {
+        return false;
+    }
+    int version = 0;
+    int width = 0;
+    int height = 0;
+    if (!readInt(reader, version) || version != LayoutJournal::FORMAT_VERSION
+        || !readInt(reader, width) || !readInt(reader, height) || !readBytes(reader, snapshot))
+    {
+        return false;
+    }
+    mainWindowSize = QSize(width, height);
+    return reader.leaveContainer();
+}
+
+static bool readRecord(QCborStreamReader &reader, LayoutJournal::Record &record)
+{
+    if (!reader.isArray() || !reader.enterContainer())
+    {
+        return false;
+    }
+    int operation = 0;
+    QList<int> extra;
+    if (!readInt(reader, operation) || operation < LayoutJournal::TAB || operation > LayoutJournal::SIZES
+        || !readInt(reader, record.source.window) || !readInts(reader, record.source.path)
+        || !readInt(reader, record.sourceIndex)
+        || !readInt(reader, record.target.window) || !readInts(reader, record.target.path)
+        || !readInt(reader, record.targetIndex) || !readInts(reader, extra) || !reader.isMap())
+    {
+        return false;
+    }
+    record.state = QCborValue::fromCbor(reader).toMap().toJsonObject();
+    record.operation = (LayoutJournal::Operation)operation;
+    record.geometry = (extra.size() == 4 && operation == LayoutJournal::FLOAT) ? QRect(extra[0], extra[1], extra[2], extra[3]) : QRect();
+    record.sizes = (operation == LayoutJournal::RESIZE || operation == LayoutJournal::SIZES) ? extra : QList<int>();
+    return reader.lastError() == QCborError::NoError && reader.leaveContainer();
+}
+
+// The sizes the widgets settled on replace the placeholders of the model's operations. A window
+// whose shape differs, like one with a tab widget not yet deleted when they were taken, is left as is
+static bool applyWindowSizes(int windowIndex, const QList<int> &sizes, DockModel &model)
+{
+    if (windowIndex < 0 || windowIndex >= model.windowCount())
+    {
+        return false;
+    }
+    QList<DockModel::NodeId> splitters;
+    QList<DockModel::NodeId> stack;
+    stack.append(model.window(windowIndex).rootSplitter);
+    while (!stack.isEmpty())
+    {
+        DockModel::NodeId id = stack.takeLast();
+        const DockModel::Node &node = model.node(id);
+        if (node.kind != DockModel::SPLITTER)
+        {
+            continue;
+        }
+        splitters.append(id);
+        for (int i = node.children.size() - 1; i >= 0; i--)
+        {
+            stack.append(node.children.at(i));
+        }
+    }
+    int pos = 0;
+    for (int i = 0; i < splitters.size(); i++)
+    {
+        int count = model.node(splitters.at(i)).children.size();
+        if (pos >= sizes.size() || sizes.at(pos) != count || pos + 1 + count > sizes.size())
+        {
+            return false;
+        }
+        pos += 1 + count;
+    }
+    if (pos != sizes.size())
+    {
+        return false;
+    }
+    pos = 0;
+    for (int i = 0; i < splitters.size(); i++)
+    {
+        int count = sizes.at(pos);
+        model.setSizes(splitters.at(i), sizes.mid(pos + 1, count));
+        pos += 1 + count;
+    }
+    return true;
+}
+
+LayoutJournal::LayoutJournal()
+    : _recordCount(0)
+{
+}
+
+LayoutJournal::~LayoutJournal()
+{
+    _file.close();
+}
+
+bool LayoutJournal::open(const QString &fileName)
+{
+    _file.close();
+    _file.setFileName(fileName);
+    _recordCount = 0;
+    return _file.open(QIODevice::WriteOnly | QIODevice::Append);
+}
+
+void LayoutJournal::close(bool isRemoveFile)
+{
+    QString fileName = _file.fileName();
+    _file.close();
+    if (isRemoveFile && !fileName.isEmpty())
+    {
+        QFile::remove(fileName);
+    }
+    _recordCount = 0;
+}
+
+void LayoutJournal::append(const Record &record)
+{
+    if (!_file.isOpen())
+    {
+        return;
+    }
+    QCborStreamWriter writer(&_file);
+    writer.startArray(9);
+    writer.append(qint64(record.operation));
+    writer.append(qint64(record.source.window));
+    writeInts(writer, record.source.path);
+    writer.append(qint64(record.sourceIndex));
+    writer.append(qint64(record.target.window));
+    writeInts(writer, record.target.path);
+    writer.append(qint64(record.targetIndex));
+    if (record.operation == FLOAT)
+    {
+        writeInts(writer, QList<int>() << record.geometry.left() << record.geometry.top()
+                                       << record.geometry.width() << record.geometry.height());
+    }
+    else
+    {
+        writeInts(writer, record.sizes);
+    }
+    QCborValue(QCborMap::fromJsonObject(record.state)).toCbor(writer);
+    writer.endArray();
+    _file.flush();
+    _recordCount++;
+}
+
+bool LayoutJournal::compact(const DockModel &snapshot, const QSize &mainWindowSize)
+{
+    QString fileName = _file.fileName();
+    if (fileName.isEmpty())
+    {
+        return false;
+    }
+    // Until the new file is committed the old one, records included, stays valid
+    _file.close();
+    bool isCompacted = false;
+    QSaveFile saveFile(fileName);
+    if (saveFile.open(QIODevice::WriteOnly))
+    {
+        QCborStreamWriter writer(&saveFile);
+        writer.startArray(4);
+        writer.append(qint64(FORMAT_VERSION));
+        writer.append(qint64(mainWindowSize.width()));
+        writer.append(qint64(mainWindowSize.height()));
+        writer.append(snapshot.toCbor());
+        writer.endArray();
+        isCompacted = saveFile.commit();
+    }
+    if (isCompacted)
+    {
+        _recordCount = 0;
+    }
+    _file.open(QIODevice::WriteOnly | QIODevice::Append);
+    return isCompacted;
+}
+
+bool LayoutJournal::replay(const QString &fileName, DockModel &model)
+{
+    model.clear();
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    QByteArray data = file.readAll();
+    file.close();
+
+    QCborStreamReader reader(data);
+    QSize mainWindowSize;
+    QByteArray snapshot;
+    if (!readHeader(reader, mainWindowSize, snapshot) || !model.fromCbor(snapshot))
+    {
+        model.clear();
+        return false;
+    }
+    // The operations size new tab groups from the geometry, as the widgets did
+    model.layout(mainWindowSize);
+    while (reader.lastError() == QCborError::NoError && reader.isArray())
+    {
+        Record record;
+        if (!readRecord(reader, record))
+        {
+            break;
+        }
+        apply(record, model);
+    }
+    return true;
+}
+
+bool LayoutJournal::apply(const Record &record, DockModel &model)
+{
+    DockModel::NodeId target = model.nodeAt(record.target.window, record.target.path);
+    switch (record.operation)
+    {
+    case CLOSE:
+        return model.closeTab(target, record.targetIndex);
+    case CLOSE_WINDOW:
+        return model.closeWindow(record.target.window);
+    case RESIZE:
+        if (!model.isValid(target))
+        {
+            return false;
+        }
+        model.setSizes(target, record.sizes);
+        return true;
+    case SIZES:
+        return applyWindowSizes(record.target.window, record.sizes, model);
+    default:
+        break;
+    }
+
+    DockModel::Tab tab;
+    if (record.source.window < 0)
+    {
+        tab.windowType = (uint)record.sourceIndex;
+        tab.state = record.state;
+    }
+    else
+    {
+        DockModel::NodeId source = model.nodeAt(record.source.window, record.source.path);
+        if (!model.isValid(source) || model.node(source).kind != DockModel::TAB_GROUP
+            || record.sourceIndex < 0 || record.sourceIndex >= model.node(source).tabs.size())
+        {
+            return false;
+        }
+        if (record.operation == FLOAT)
+        {
+            return model.floatTab(source, record.sourceIndex, record.geometry) >= 0;
+        }
+        if (source == target && model.node(source).tabs.size() == 1)
+        {
+            // Dropped back where it came from
+            return true;
+        }
+        tab = model.takeTab(source, record.sourceIndex);
+    }
+
+    // The target was resolved before the take, an emptied source did not move it
+    switch (record.operation)
+    {
+    case TAB:
+        return model.addTab(target, tab, record.targetIndex) >= 0;
+    case DOCK:
+        if (record.target.path.isEmpty())
+        {
+            return model.dockAtRoot(model.windowOf(target), (DockModel::Region)record.targetIndex, tab) != DockModel::INVALID_NODE;
+        }
+        return model.dockAtTabGroup(target, (DockModel::Region)record.targetIndex, tab) != DockModel::INVALID_NODE;
+    case FLOAT:
+        return model.addFloatWindow(tab, record.geometry) >= 0;
+    default:
+        return false;
+    }
+}
+
+}
@@ -0,0 +1,83 @@
+/**********************************************************
+* @file     LayoutJournal.h
+* @brief    Append-only log of dock operations behind a layout snapshot;
+*           replaying both recovers the layout after a crash
+*
+***********************************************************/
+#ifndef LAYOUTJOURNAL_H
+#define LAYOUTJOURNAL_H
+
+#include <QFile>
+#include <QList>
+#include <QRect>
+#include <QSize>
+#include <QJsonObject>
+
+#include "DockModel.h"
+
+namespace dock {
+
+class LayoutJournal
+{
+public:
+    static const int FORMAT_VERSION = 1;
+
+    enum Operation
+    {
+        TAB,            // a tab into a tab group
+        DOCK,           // a tab into a new tab group beside a tab group, or at a side of a window
+        FLOAT,          // a tab into a new floating window
+        CLOSE,          // a tab closed
+        CLOSE_WINDOW,   // a floating window closed with its tabs
+        RESIZE,         // the children of a splitter resized
+        SIZES           // the sizes the splitters of a window settled on after the operations before
+    };
+
+    // A tab group or splitter: its window and the child indexes down from the root splitter
+    struct Location
+    {
+        int window;
+        QList<int> path;
+        Location() : window(-1) {}
+    };
+
+    // Locations are taken before the operation, as DockModel resolves them before applying it
+    struct Record
+    {
+        Operation operation;
+        Location source;        // TAB, DOCK, FLOAT: the tab group the tab leaves, no window for a new tab
+        int sourceIndex;        // its tab index, or the window type of a new tab
+        Location target;        // the tab group, splitter or window acted on; DOCK at a window has no path
+        int targetIndex;        // TAB: insert index, DOCK: DockModel::Region, CLOSE: tab index
+        QRect geometry;         // FLOAT
+        QList<int> sizes;       // RESIZE; SIZES: the child count then the child sizes of each splitter, depth first
+        QJsonObject state;      // TAB, DOCK, FLOAT of a new tab: the state its window started with
+        Record() : operation(TAB), sourceIndex(-1), targetIndex(-1) {}
+    };
+
+    LayoutJournal();
+    ~LayoutJournal();
+
+    bool open(const QString &fileName);
+    // A clean close removes the file, the layout is then persisted by other means
+    void close(bool isRemoveFile);
+    bool isOpen() const { return _file.isOpen(); }
+    int recordCount() const { return _recordCount; }
+
+    // Written through at once, so a crash loses at most the record being written
+    void append(const Record &record);
+    // Replaces the file with the snapshot alone
+    bool compact(const DockModel &snapshot, const QSize &mainWindowSize);
+
+    // The snapshot in fileName with the records after it applied. A torn last record is dropped
+    static bool replay(const QString &fileName, DockModel &model);
+    static bool apply(const Record &record, DockModel &model);
+
+private:
+    QFile _file;
+    int _recordCount;
+};
+
+}
+
+#endif // LAYOUTJOURNAL_H
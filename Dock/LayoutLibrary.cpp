@@ -0,0 +1,330 @@
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QtEndian>
+
+#include "LayoutLibrary.h"
+
+namespace dock {
+
+const QString c_strCurrentLayoutName    = "CurrentLayoutName";
+const QString c_strLayoutArray          = "LayoutArray";
+const QString c_strLayoutName           = "Name";
+const QString c_strOffset               = "Offset";
+const QString c_strSize                 = "Size";
+const QString c_strFingerprint          = "Fingerprint";
+
+// Header: magic, version, index size, index offset, all little endian, then the layouts and
+// indexes in the order they were written. The index is compact json of
+// {CurrentLayoutName, LayoutArray: [{Name, Offset, Size, Fingerprint}]}
+static const char LIBRARY_MAGIC[8] = {'D', 'O', 'C', 'K', 'L', 'I', 'B', '\0'};
+static const qint64 HEADER_SIZE = 32;
+
+static QByteArray headerBytes(qint64 indexOffset, qint64 indexSize)
+{
+    QByteArray header(HEADER_SIZE, '\0');
+    char *p = header.data();
+    memcpy(p, LIBRARY_MAGIC, sizeof(LIBRARY_MAGIC));
+    qToLittleEndian<quint32>(LayoutLibrary::FORMAT_VERSION, p + 8);
+    qToLittleEndian<quint32>((quint32)indexSize, p + 12);
+    qToLittleEndian<quint64>((quint64)indexOffset, p + 16);
+    return header;
+}
+
+LayoutLibrary::LayoutLibrary()
+    : _data(nullptr)
+    , _dataSize(0)
+    , _indexSize(0)
+{
+}
+
+LayoutLibrary::~LayoutLibrary()
+{
+    close();
+}
+
+bool LayoutLibrary::open(const QString &fileName)
+{
+    close();
+    _file.setFileName(fileName);
+    if (!_file.open(QIODevice::ReadWrite))
+    {
+        return false;
+    }
+    if (_file.size() == 0)
+    {
+        _file.write(headerBytes(HEADER_SIZE, 0));
+        if (writeIndex())
+        {
+            return true;
+        }
+    }
+    else
+    {
+        mapFile();
+        if (readIndex())
+        {
+            return true;
+        }
+    }
+    close();
+    return false;
+}
+
+void LayoutLibrary::close()
+{
+    unmapFile();
+    _file.close();
+    _entries.clear();
+    _names.clear();
+    _currentLayoutName.clear();
+    _indexSize = 0;
+}
+
+void LayoutLibrary::mapFile()
+{
+    _dataSize = _file.size();
+    _data = _file.map(0, _dataSize);
+}
+
+void LayoutLibrary::unmapFile()
+{
+    if (_data != nullptr)
+    {
+        _file.unmap(_data);
+        _data = nullptr;
+    }
+    _dataSize = 0;
+}
+
+QByteArray LayoutLibrary::bytesAt(qint64 offset, qint64 size) const
+{
+    if (offset < 0 || size < 0)
+    {
+        return QByteArray();
+    }
+    if (_data != nullptr)
+    {
+        if (offset + size > _dataSize)
+        {
+            return QByteArray();
+        }
+        // Only the pages of this range are read
+        return QByteArray((const char *)_data + offset, size);
+    }
+    // Without a mapping, a second handle keeps the const reader off the write position
+    QFile file(_file.fileName());
+    if (!file.open(QIODevice::ReadOnly) || !file.seek(offset))
+    {
+        return QByteArray();
+    }
+    QByteArray bytes = file.read(size);
+    return (bytes.size() == size) ? bytes : QByteArray();
+}
+
+bool LayoutLibrary::readIndex()
+{
+    QByteArray header = bytesAt(0, HEADER_SIZE);
+    if (header.size() != HEADER_SIZE || memcmp(header.constData(), LIBRARY_MAGIC, sizeof(LIBRARY_MAGIC)) != 0)
+    {
+        return false;
+    }
+    const char *p = header.constData();
+    quint32 version = qFromLittleEndian<quint32>(p + 8);
+    qint64 indexSize = qFromLittleEndian<quint32>(p + 12);
+    qint64 indexOffset = (qint64)qFromLittleEndian<quint64>(p + 16);
+    if (version < 1 || version > (quint32)FORMAT_VERSION || indexOffset < HEADER_SIZE)
+    {
+        return false;
+    }
+    QJsonParseError error;
+    QJsonObject index = QJsonDocument::fromJson(bytesAt(indexOffset, indexSize), &error).object();
+    if (error.error != QJsonParseError::NoError)
+    {
+        return false;
+    }
+
+    _entries.clear();
+    _names.clear();
+    QJsonArray layoutArray = index.value(c_strLayoutArray).toArray();
+    for (int i = 0; i < layoutArray.size(); i++)
+    {
+        QJsonObject entryObj = layoutArray.at(i).toObject();
+        Entry entry;
+        entry.offset = (qint64)entryObj.value(c_strOffset).toDouble();
+        entry.size = (qint64)entryObj.value(c_strSize).toDouble();
+        entry.fingerprint = QByteArray::fromHex(entryObj.value(c_strFingerprint).toString().toLatin1());
+        QString layoutName = entryObj.value(c_strLayoutName).toString();
+        // Layouts always lie before the index that lists them
+        if (layoutName.isEmpty() || entry.offset < HEADER_SIZE || entry.offset + entry.size > indexOffset
+            || _entries.contains(layoutName))
+        {
+            continue;
+        }
+        _entries.insert(layoutName, entry);
+        _names.append(layoutName);
+    }
+    _currentLayoutName = index.value(c_strCurrentLayoutName).toString();
+    _indexSize = indexSize;
+    return true;
+}
+
+QByteArray LayoutLibrary::indexBytes(const QHash<QString, Entry> &entries) const
+{
+    QJsonArray layoutArray;
+    for (int i = 0; i < _names.size(); i++)
+    {
+        const Entry &entry = entries[_names.at(i)];
+        QJsonObject entryObj;
+        entryObj.insert(c_strLayoutName, _names.at(i));
+        entryObj.insert(c_strOffset, (double)entry.offset);
+        entryObj.insert(c_strSize, (double)entry.size);
+        entryObj.insert(c_strFingerprint, QString::fromLatin1(entry.fingerprint.toHex()));
+        layoutArray.append(entryObj);
+    }
+    QJsonObject index;
+    index.insert(c_strCurrentLayoutName, _currentLayoutName);
+    index.insert(c_strLayoutArray, layoutArray);
+    return QJsonDocument(index).toJson(QJsonDocument::Compact);
+}
+
+bool LayoutLibrary::writeIndex()
+{
+    QByteArray indexBytes = this->indexBytes(_entries);
+    unmapFile();
+    qint64 indexOffset = _file.size();
+    bool isWritten = _file.seek(indexOffset) && _file.write(indexBytes) == indexBytes.size() && _file.flush();
+    // The header moves to the new index only once that is on disk
+    if (isWritten)
+    {
+        isWritten = _file.seek(0) && _file.write(headerBytes(indexOffset, indexBytes.size())) == HEADER_SIZE
+                    && _file.flush();
+    }
+    if (isWritten)
+    {
+        _indexSize = indexBytes.size();
+    }
+    mapFile();
+    return isWritten;
+}
+
+QByteArray LayoutLibrary::layoutFingerprint(const QString &layoutName) const
+{
+    return _entries.value(layoutName).fingerprint;
+}
+
+bool LayoutLibrary::setCurrentLayoutName(const QString &layoutName)
+{
+    if (!isOpen())
+    {
+        return false;
+    }
+    if (_currentLayoutName == layoutName)
+    {
+        return true;
+    }
+    _currentLayoutName = layoutName;
+    return writeIndex();
+}
+
+QByteArray LayoutLibrary::layout(const QString &layoutName) const
+{
+    auto iter = _entries.constFind(layoutName);
+    if (iter == _entries.constEnd())
+    {
+        return QByteArray();
+    }
+    return bytesAt(iter->offset, iter->size);
+}
+
+bool LayoutLibrary::setLayout(const QString &layoutName, const QByteArray &data, const QByteArray &fingerprint)
+{
+    if (!isOpen() || layoutName.isEmpty())
+    {
+        return false;
+    }
+    unmapFile();
+    Entry entry;
+    entry.offset = _file.size();
+    entry.size = data.size();
+    entry.fingerprint = fingerprint;
+    if (!_file.seek(entry.offset) || _file.write(data) != data.size())
+    {
+        mapFile();
+        return false;
+    }
+    if (!_entries.contains(layoutName))
+    {
+        _names.append(layoutName);
+    }
+    _entries.insert(layoutName, entry);
+    return writeIndex();
+}
+
+bool LayoutLibrary::removeLayout(const QString &layoutName)
+{
+    if (!isOpen() || !_entries.remove(layoutName))
+    {
+        return false;
+    }
+    _names.removeOne(layoutName);
+    return writeIndex();
+}
+
+qint64 LayoutLibrary::garbageSize() const
+{
+    if (!isOpen())
+    {
+        return 0;
+    }
+    qint64 used = HEADER_SIZE + _indexSize;
+    for (auto iter = _entries.constBegin(); iter != _entries.constEnd(); iter++)
+    {
+        used += iter->size;
+    }
+    return _file.size() - used;
+}
+
+bool LayoutLibrary::compact()
+{
+    if (!isOpen())
+    {
+        return false;
+    }
+    QSaveFile saveFile(_file.fileName());
+    if (!saveFile.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+    // Live layouts copied in order, then the index; the old file stays until the commit
+    QHash<QString, Entry> entries;
+    saveFile.write(headerBytes(HEADER_SIZE, 0));
+    qint64 offset = HEADER_SIZE;
+    for (int i = 0; i < _names.size(); i++)
+    {
+        Entry entry = _entries.value(_names.at(i));
+        QByteArray data = bytesAt(entry.offset, entry.size);
+        if (data.size() != entry.size)
+        {
+            saveFile.cancelWriting();
+            return false;
+        }
+        saveFile.write(data);
+        entry.offset = offset;
+        offset += entry.size;
+        entries.insert(_names.at(i), entry);
+    }
+    QByteArray indexBytes = this->indexBytes(entries);
+    saveFile.write(indexBytes);
+    saveFile.seek(0);
+    saveFile.write(headerBytes(offset, indexBytes.size()));
+
+    QString fileName = _file.fileName();
+    unmapFile();
+    _file.close();
+    bool isCommitted = saveFile.commit();
+    return open(fileName) && isCommitted;
+}
+
+}
@@ -0,0 +1,79 @@
+/**********************************************************
+* @file     LayoutLibrary.h
+* @brief    Single file holding any number of named layouts behind an
+*           index, read through a file mapping
+*
+***********************************************************/
+#ifndef LAYOUTLIBRARY_H
+#define LAYOUTLIBRARY_H
+
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+
+#include "dock_global.h"
+
+namespace dock {
+
+// The file is only appended to: a layout added or replaced goes to the end followed by a new
+// index, then the header is pointed at that index. A crash before that keeps the old index
+class DOCKSHARED_EXPORT LayoutLibrary
+{
+public:
+    static const int FORMAT_VERSION = 1;
+
+    LayoutLibrary();
+    ~LayoutLibrary();
+
+    // Creates an empty library if there is no file yet
+    bool open(const QString &fileName);
+    void close();
+    bool isOpen() const { return _file.isOpen(); }
+
+    // From the index alone, in the order the layouts were first added
+    QStringList layoutNames() const { return _names; }
+    bool contains(const QString &layoutName) const { return _entries.contains(layoutName); }
+    QByteArray layoutFingerprint(const QString &layoutName) const;
+    QString currentLayoutName() const { return _currentLayoutName; }
+    bool setCurrentLayoutName(const QString &layoutName);
+
+    // The DockModel::toCbor data of the layout, empty for an unknown name
+    QByteArray layout(const QString &layoutName) const;
+    bool setLayout(const QString &layoutName, const QByteArray &data, const QByteArray &fingerprint);
+    bool removeLayout(const QString &layoutName);
+
+    // Bytes of replaced layouts and old indexes; compact() rewrites the file without them
+    qint64 garbageSize() const;
+    bool compact();
+
+private:
+    struct Entry
+    {
+        qint64 offset;
+        qint64 size;
+        QByteArray fingerprint;
+        Entry() : offset(0), size(0) {}
+    };
+
+    QByteArray bytesAt(qint64 offset, qint64 size) const;
+    bool readIndex();
+    QByteArray indexBytes(const QHash<QString, Entry> &entries) const;
+    bool writeIndex();
+    void mapFile();
+    void unmapFile();
+
+private:
+    QFile _file;
+    uchar *_data;
+    qint64 _dataSize;
+    QHash<QString, Entry> _entries;
+    QStringList _names;
+    QString _currentLayoutName;
+    qint64 _indexSize;
+};
+
+}
+
+#endif // LAYOUTLIBRARY_H
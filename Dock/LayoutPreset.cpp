@@ -0,0 +1,76 @@
+#include <QString>
+#include <QHash>
+
+#include "LayoutPreset.h"
+#include "WindowFactoryManager.h"
+
+namespace dock {
+
+// The type REGISTER_WINDOW gives the class, nullptr the first registered one
+static bool presetWindowType(const char *windowClass, uint &windowType)
+{
+    WindowFactoryManager *manager = WindowFactoryManager::getInstance();
+    if (windowClass == nullptr)
+    {
+        const std::map<uint, WindowFactory *> &factorys = manager->getAllFactorys();
+        if (factorys.empty())
+        {
+            return false;
+        }
+        windowType = factorys.begin()->first;
+        return true;
+    }
+    windowType = qHash(QString(windowClass));
+    return manager->getFactory(windowType) != nullptr;
+}
+
+static DockModel::NodeId addPresetNode(const LayoutPresetNode *nodes, int &index, DockModel &model)
+{
+    const LayoutPresetNode &node = nodes[index++];
+    if (node.kind == DockModel::TAB_GROUP)
+    {
+        DockModel::NodeId group = model.createTabGroup();
+        for (int i = 0; i < node.count; i++)
+        {
+            DockModel::Tab tab;
+            if (!presetWindowType(node.windowClasses[i], tab.windowType))
+            {
+                return DockModel::INVALID_NODE;
+            }
+            model.addTab(group, tab);
+        }
+        return group;
+    }
+    DockModel::NodeId splitter = model.createSplitter(node.orientation);
+    for (int i = 0; i < node.count; i++)
+    {
+        int size = nodes[index].size;
+        DockModel::NodeId child = addPresetNode(nodes, index, model);
+        if (child == DockModel::INVALID_NODE)
+        {
+            return DockModel::INVALID_NODE;
+        }
+        model.appendChild(splitter, child, size);
+    }
+    return splitter;
+}
+
+bool LayoutPreset::toModel(DockModel &model) const
+{
+    model.clear();
+    if (!isValidLayoutPreset(*this))
+    {
+        return false;
+    }
+    int index = 0;
+    DockModel::NodeId rootSplitter = addPresetNode(nodes, index, model);
+    if (rootSplitter == DockModel::INVALID_NODE)
+    {
+        model.clear();
+        return false;
+    }
+    model.addWindow(rootSplitter);
+    return true;
+}
+
+}
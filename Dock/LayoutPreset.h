@@ -0,0 +1,82 @@
+/**********************************************************
+* @file     LayoutPreset.h
+* @brief    Layouts declared in code as constexpr tables, built without
+*           reading or parsing anything
+*
+***********************************************************/
+#ifndef LAYOUTPRESET_H
+#define LAYOUTPRESET_H
+
+#include "dock_global.h"
+#include "DockModel.h"
+
+namespace dock {
+
+// One node of the main window tree. The nodes are listed depth first, every splitter
+// followed by its children
+struct LayoutPresetNode
+{
+    DockModel::NodeKind kind;
+    Qt::Orientation orientation;        // SPLITTER
+    int size;                           // along the parent splitter
+    int count;                          // SPLITTER: children that follow, TAB_GROUP: tabs
+    const char *const *windowClasses;   // TAB_GROUP: class names given to the window macros,
+                                        // nullptr for the first registered window type
+};
+
+struct LayoutPreset
+{
+    const char *name;
+    const LayoutPresetNode *nodes;
+    int nodeCount;
+
+    // Builds the model, false if a window class is not registered or the table is malformed
+    bool toModel(DockModel &model) const;
+};
+
+constexpr LayoutPresetNode presetSplitter(Qt::Orientation orientation, int size, int childCount)
+{
+    return LayoutPresetNode{DockModel::SPLITTER, orientation, size, childCount, nullptr};
+}
+
+template <int N>
+constexpr LayoutPresetNode presetTabGroup(int size, const char *const (&windowClasses)[N])
+{
+    return LayoutPresetNode{DockModel::TAB_GROUP, Qt::Horizontal, size, N, windowClasses};
+}
+
+template <int N>
+constexpr LayoutPreset layoutPreset(const char *name, const LayoutPresetNode (&nodes)[N])
+{
+    return LayoutPreset{name, nodes, N};
+}
+
+// Index after the subtree starting at index, -1 if it runs past the table
+constexpr int presetSubtreeEnd(const LayoutPresetNode *nodes, int nodeCount, int index)
+{
+    if (index < 0 || index >= nodeCount)
+    {
+        return -1;
+    }
+    if (nodes[index].kind == DockModel::TAB_GROUP)
+    {
+        return (nodes[index].count > 0) ? index + 1 : -1;
+    }
+    int next = index + 1;
+    for (int i = 0; i < nodes[index].count && next >= 0; i++)
+    {
+        next = presetSubtreeEnd(nodes, nodeCount, next);
+    }
+    return (nodes[index].count > 0) ? next : -1;
+}
+
+// For static_assert: a root splitter whose tree uses every node, no empty splitter or tab group
+constexpr bool isValidLayoutPreset(const LayoutPreset &preset)
+{
+    return preset.nodeCount > 0 && preset.nodes[0].kind == DockModel::SPLITTER
+           && presetSubtreeEnd(preset.nodes, preset.nodeCount, 0) == preset.nodeCount;
+}
+
+}
+
+#endif // LAYOUTPRESET_H
@@ -0,0 +1,62 @@
+#include <QFutureWatcher>
+#include <QtConcurrent>
+
+#include "PendingWindow.h"
+#include "WindowFactoryManager.h"
+#include "WindowFactory.h"
+
+namespace dock {
+
+static QVariant prepareWindowState(WindowFactory *factory, const QJsonObject &state)
+{
+    return factory->prepare(state);
+}
+
+PendingWindow::PendingWindow(const DockModel::Tab &tab, QWidget *parent)
+    : QWidget(parent)
+    , _tab(tab)
+    , _watcher(nullptr)
+    , _isPrepared(false)
+{
+    setObjectName("PendingWindow");
+}
+
+PendingWindow::~PendingWindow()
+{
+}
+
+QString PendingWindow::getTitle() const
+{
+    WindowFactory *factory = WindowFactoryManager::getInstance()->getFactory(_tab.windowType);
+    if (factory == nullptr)
+    {
+        return QString();
+    }
+    return factory->getTitle();
+}
+
+void PendingWindow::startPrepare(WindowFactory *factory, const QJsonObject &state)
+{
+    if (_watcher != nullptr || _isPrepared)
+    {
+        return;
+    }
+    // The watcher dies with the placeholder, a result nobody waits for any more is dropped
+    _watcher = new QFutureWatcher<QVariant>(this);
+    connect(_watcher, &QFutureWatcher<QVariant>::finished, this, &PendingWindow::onPrepareFinished);
+    _watcher->setFuture(QtConcurrent::run(prepareWindowState, factory, state));
+}
+
+bool PendingWindow::isPreparing() const
+{
+    return _watcher != nullptr && !_isPrepared;
+}
+
+void PendingWindow::onPrepareFinished()
+{
+    _prepared = _watcher->result();
+    _isPrepared = true;
+    emit prepared();
+}
+
+}
@@ -0,0 +1,56 @@
+/**********************************************************
+* @file     PendingWindow.h
+* @brief    Stand-in page of a tab whose dockable window is not created yet;
+*           keeps the window type and the saved state until it is needed
+*
+***********************************************************/
+#ifndef PENDINGWINDOW_H
+#define PENDINGWINDOW_H
+
+#include <QWidget>
+#include <QVariant>
+
+#include "DockModel.h"
+
+template <typename T> class QFutureWatcher;
+
+namespace dock {
+
+class WindowFactory;
+
+class PendingWindow : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit PendingWindow(const DockModel::Tab &tab, QWidget *parent = nullptr);
+    virtual ~PendingWindow();
+
+    const DockModel::Tab &tab() const { return _tab; }
+    uint windowType() const { return _tab.windowType; }
+    // The factory title, shown on the tab until the window replaces it
+    QString getTitle() const;
+
+    // Async factories: run WindowFactory::prepare on the thread pool, prepared() follows.
+    // state is that of the tab, read from the state store when the layout only references it
+    void startPrepare(WindowFactory *factory, const QJsonObject &state);
+    bool isPreparing() const;
+    bool isPrepared() const { return _isPrepared; }
+    QVariant preparedData() const { return _prepared; }
+
+signals:
+    void prepared();
+
+private slots:
+    void onPrepareFinished();
+
+private:
+    DockModel::Tab _tab;
+    QFutureWatcher<QVariant> *_watcher;
+    bool _isPrepared;
+    QVariant _prepared;
+};
+
+}
+
+#endif // PENDINGWINDOW_H
@@ -1,11 +1,41 @@
 #include <QMouseEvent>
 #include <QApplication>
 #include <QChildEvent>
+#include <algorithm>
 #include "Splitter.h"
 #include "SplitterHandle.h"
+#include "DragFramePacer.h"
 
 namespace dock {
 static const QEvent::Type ENABLE_UPDATE_EVENT = (QEvent::Type)QEvent::registerEventType(QEvent::User + 200);
+
+// Orientation dependent accessors, resolved at compile time by the layout kernel
+template <Qt::Orientation O> struct Axis;
+
+template <> struct Axis<Qt::Horizontal>
+{
+    static int size(const QRect &r) { return r.width(); }
+    static int size(const QSize &s) { return s.isValid() ? s.width() : 0; }
+    static int delta(const QPoint &p) { return p.x(); }
+    static QRect rect(int pos, int size, const QSize &extent) { return QRect(pos, 0, size, extent.height()); }
+};
+
+template <> struct Axis<Qt::Vertical>
+{
+    static int size(const QRect &r) { return r.height(); }
+    static int size(const QSize &s) { return s.isValid() ? s.height() : 0; }
+    static int delta(const QPoint &p) { return p.y(); }
+    static QRect rect(int pos, int size, const QSize &extent) { return QRect(0, pos, extent.width(), size); }
+};
+
+// Copy element by element, so that dst keeps its own buffer instead of sharing src's
+template <typename T>
+static inline void copyWithoutSharing(const QList<T> &src, QList<T> &dst)
+{
+    dst.resize(src.size());
+    std::copy(src.cbegin(), src.cend(), dst.begin());
+}
+
 Splitter::Splitter(QWidget *parent)
     : QWidget(parent)
     , _handleWidth(4)
@@ -15,8 +45,13 @@ Splitter::Splitter(QWidget *parent)
     , _isMoveForwardSoonAgo(true)
     , _isOpaqueResize(true)
     , _floatHandle(nullptr)
+    , _movingHandleIndex(-1)
+    , _isEnableUpdatePending(false)
+    , _isPlacedByParent(false)
+    , _handleMovePacer(new DragFramePacer(this))
 {
     setObjectName("SplitterForDock");
+    connect(_handleMovePacer, &DragFramePacer::moveReady, this, &Splitter::onHandleMoved);
 }
 
 Splitter::~Splitter()
@@ -47,36 +82,31 @@ void Splitter::updateSizes(int count, ...)
 
 QList<float> Splitter::getProportions(const QList<int>& sizes, bool isContainHandleSizes)
 {
-    QList<int> list;
-    if (isContainHandleSizes)
-    {
-        for (int i = 0; i < sizes.size(); i++)
-        {
-            if (i % 2 != 0)
-            {
-                continue;
-            }
-            list.append(sizes.at(i));
-        }
-    }
-    else
+    QList<float> sizePropotions;
+    proportionsFromSizes(sizes, isContainHandleSizes, sizePropotions);
+    return sizePropotions;
+}
+
+void Splitter::proportionsFromSizes(const QList<int> &sizes, bool isContainHandleSizes, QList<float> &proportions) const
+{
+    const int step = isContainHandleSizes ? 2 : 1;
+    int count = 0;
+    float sumSizes = 0.0f;
+    for (int i = 0; i < sizes.size(); i += step)
     {
-        list = sizes;
+        sumSizes += sizes.at(i);
+        count++;
     }
-
-    float sumSizes = sumInts(list);
-    QList<float> sizePropotions;
-    sizePropotions.clear();
-    if (sumSizes == 0.0f || list.isEmpty())
+    if (sumSizes == 0.0f || count == 0)
     {
-        return sizePropotions;
+        proportions.resize(0);
+        return;
     }
-    for (int i = 0; i < list.size(); i++)
+    proportions.resize(count);
+    for (int i = 0, j = 0; i < sizes.size(); i += step, j++)
     {
-        float size = (list.at(i) / sumSizes);
-        sizePropotions.append(size);
+        proportions[j] = sizes.at(i) / sumSizes;
     }
-    return sizePropotions;
 }
 
 int Splitter::widgetCount() const
@@ -122,6 +152,11 @@ void Splitter::setOpaqueResize(bool opaque)
     _isOpaqueResize = opaque;
 }
 
+void Splitter::setFramePacedResize(bool enable)
+{
+    _handleMovePacer->setEnabled(enable);
+}
+
 void Splitter::insertWidget(int index, QWidget *w)
 {
     w->setParent(this);
@@ -147,6 +182,7 @@ void Splitter::insertWidget(int index, QWidget *w)
     {
         w->setHidden(false);
     }
+    emit widgetInserted(_widgetList.indexOf(w), w);
 }
 
 void Splitter::addWidget(QWidget *w)
@@ -156,20 +192,23 @@ void Splitter::addWidget(QWidget *w)
 
 void Splitter::resizeChildren(const QList<QRect>& geoList)
 {
-    setUpdatesEnabled(false);
+    _treeCommits.resize(0);
+    collectTreeGeometries(geoList, _treeCommits);
+    commitTreeGeometries(_treeCommits);
+}
+
+void Splitter::collectTreeGeometries(const QList<QRect> &geoList, QList<GeometryCommit> &commits)
+{
     for (int i = 0; i < geoList.size(); i++)
     {
-        QRect newGeometry = geoList.at(i);
+        const QRect &newGeometry = geoList.at(i);
+        QWidget *w = nullptr;
         if (i % 2 == 0)
         {
             int widgetIndex = i / 2;
             if (widgetIndex >= 0 && widgetIndex < _widgetList.size())
             {
-                QWidget *w = _widgetList.at(widgetIndex);
-                if (w != nullptr && w->geometry() != newGeometry)
-                {
-                    w->setGeometry(newGeometry);
-                }
+                w = _widgetList.at(widgetIndex);
             }
         }
         else
@@ -177,14 +216,60 @@ void Splitter::resizeChildren(const QList<QRect>& geoList)
             int handleIndex = (i + 1) / 2 - 1;
             if (handleIndex >= 0 && handleIndex < _handleList.size())
             {
-                SplitterHandle* h = _handleList.at(handleIndex);
-                if (h != nullptr && h->geometry() != newGeometry)
-                {
-                    h->setGeometry(newGeometry);
-                }
+                w = _handleList.at(handleIndex);
             }
         }
+        if (w == nullptr)
+        {
+            continue;
+        }
+        // Solve nested splitters against the size they are about to get, not the one they have
+        Splitter *childSplitter = (i % 2 == 0) ? qobject_cast<Splitter *>(w) : nullptr;
+        GeometryCommit commit;
+        commit.widget = w;
+        commit.splitter = childSplitter;
+        commit.geometry = newGeometry;
+        commits.append(commit);
+        if (childSplitter != nullptr)
+        {
+            childSplitter->_isPlacedByParent = true;
+            childSplitter->layoutInto(childSplitter->_sizeProportionArray, newGeometry.size(), childSplitter->_geoBuffer);
+            childSplitter->collectTreeGeometries(childSplitter->_geoBuffer, commits);
+        }
+    }
+    updateMinSizeHint();
+}
+
+void Splitter::commitTreeGeometries(const QList<GeometryCommit> &commits)
+{
+    // Disabling updates here covers every nested splitter as well
+    setUpdatesEnabled(false);
+    for (int i = 0; i < commits.size(); i++)
+    {
+        const GeometryCommit &commit = commits.at(i);
+        if (commit.widget->geometry() != commit.geometry)
+        {
+            commit.widget->setGeometry(commit.geometry);
+        }
+    }
+    // Resizes after the batch are the splitters' own again
+    for (int i = 0; i < commits.size(); i++)
+    {
+        if (commits.at(i).splitter != nullptr)
+        {
+            commits.at(i).splitter->_isPlacedByParent = false;
+        }
     }
+    // One pending event is enough to turn updates back on, don't allocate another per call
+    if (!_isEnableUpdatePending)
+    {
+        _isEnableUpdatePending = true;
+        QApplication::postEvent(this, new QEvent(ENABLE_UPDATE_EVENT));
+    }
+}
+
+void Splitter::updateMinSizeHint()
+{
     int sumMinSize = _minWidgetSize * widgetCount();
     if (_orientation == Qt::Horizontal)
     {
@@ -194,7 +279,6 @@ void Splitter::resizeChildren(const QList<QRect>& geoList)
     {
         _minSizeHint = QSize(_minWidgetSize, sumMinSize);
     }
-    QApplication::postEvent(this, new QEvent(ENABLE_UPDATE_EVENT));
 }
 
 QWidget *Splitter::widget(int index)
@@ -222,6 +306,8 @@ QWidget *Splitter::replaceWidget(int index, QWidget *widget)
     {
         widget->setHidden(false);
     }
+    emit widgetRemoved(oldw);
+    emit widgetInserted(index, widget);
     return oldw;
 }
 
@@ -405,18 +491,80 @@ QList<int> Splitter::recalcSizesAtDeleting(const QList<QRect>& oldGeo, int delet
     return  sizeList;
 }
 
-QList<int> Splitter::recalcSizesAtMoving(const QList<QRect>& oldGeo, int handleIndex, int moveDist, int minSize)
+QList<QRect> Splitter::recalcGeometries(const QList<float>& proprotions)
+{
+    QList<QRect> list;
+    layoutInto(proprotions, size(), list);
+    return list;
+}
+
+void Splitter::layoutInto(const QList<float> &proportions, const QSize &extent, QList<QRect> &geoList) const
+{
+    if (_orientation == Qt::Horizontal)
+    {
+        layoutGeometries<Qt::Horizontal>(proportions, extent, geoList);
+    }
+    else
+    {
+        layoutGeometries<Qt::Vertical>(proportions, extent, geoList);
+    }
+}
+
+template <Qt::Orientation O>
+void Splitter::layoutGeometries(const QList<float> &proportions, const QSize &extent, QList<QRect> &geoList) const
+{
+    const int count = handleCount() + widgetCount();
+    const int totalWidgetSize = Axis<O>::size(extent) - handleCount() * _handleWidth;
+    geoList.resize(count);
+    int pos = 0;
+    int n = 0;
+    for (int i = 0; i < count; i++)
+    {
+        int size = _handleWidth;
+        if (i % 2 == 0)
+        {
+            int widgetIndex = i / 2;
+            if (widgetIndex >= proportions.size() || widgetIndex >= _widgetList.size())
+            {
+                continue;
+            }
+            size = totalWidgetSize * proportions.at(widgetIndex);
+            const QWidget *w = _widgetList.at(widgetIndex);
+            size = std::max<int>(size, Axis<O>::size(w->minimumSize()));
+            if (w->layout() != nullptr)
+            {
+                size = std::max<int>(size, Axis<O>::size(w->minimumSizeHint()));
+            }
+        }
+        geoList[n++] = Axis<O>::rect(pos, size, extent);
+        pos += size;
+    }
+    geoList.resize(n);
+}
+
+template <Qt::Orientation O>
+void Splitter::layoutSizesAtMoving(
+    const QList<QRect> &oldGeo,
+    int handleIndex,
+    int moveDist,
+    int minSize,
+    QList<int> &sizeList) const
 {
     if (oldGeo.isEmpty() || handleIndex < 0 || handleIndex >= _handleList.size())
     {
-        return QList<int>();
+        sizeList.resize(0);
+        return;
+    }
+    sizeList.resize(oldGeo.size());
+    for (int i = 0; i < oldGeo.size(); i++)
+    {
+        sizeList[i] = Axis<O>::size(oldGeo.at(i));
     }
-    QList<int> sizeList = getSizesByRects(oldGeo);
 
-    int compressWidgtIndex = (moveDist > 0) ? handleIndex + 1: handleIndex;
+    int compressWidgtIndex = (moveDist > 0) ? handleIndex + 1 : handleIndex;
     if (compressWidgtIndex < 0 || compressWidgtIndex >= _widgetList.size())
     {
-        return sizeList;
+        return;
     }
 
     int sumDeduct = 0;
@@ -427,83 +575,107 @@ QList<int> Splitter::recalcSizesAtMoving(const QList<QRect>& oldGeo, int handleI
         {
             break;
         }
-        const QRect& r = oldGeo[start];
-        int s = getSize(r);
+        int s = Axis<O>::size(oldGeo.at(start));
         int widgetListIndex = start / 2;
         if (widgetListIndex < 0 || widgetListIndex >= _widgetList.size())
         {
             break;
         }
-        QWidget *w = _widgetList[widgetListIndex];
-        int widgetMinSize = getSize(w->minimumSize());
-        int widgetMinSizeHint = getSize(w->minimumSizeHint());
-        minSize = std::max<int>(minSize, widgetMinSize);
-        minSize = std::max<int>(minSize, widgetMinSizeHint);
+        const QWidget *w = _widgetList.at(widgetListIndex);
+        minSize = std::max<int>(minSize, Axis<O>::size(w->minimumSize()));
+        minSize = std::max<int>(minSize, Axis<O>::size(w->minimumSizeHint()));
         if (s > minSize)
         {
-            int deduct = std::min<int>(s - minSize, (abs)(moveDist) - sumDeduct);
+            int deduct = std::min<int>(s - minSize, abs(moveDist) - sumDeduct);
             sumDeduct += deduct;
             sizeList[start] = s - deduct;
         }
         (moveDist > 0) ? start += 2 : start -= 2;
-        if (start < 0 || start >= oldGeo.size())
-        {
-            break;
-        }
     }
     int expandWidgetIndex = (moveDist > 0) ? (compressWidgtIndex - 1) : (compressWidgtIndex + 1);
-    sizeList[2 * expandWidgetIndex] += sumDeduct;
-    
-    return  sizeList;
+    if (2 * expandWidgetIndex < sizeList.size())
+    {
+        sizeList[2 * expandWidgetIndex] += sumDeduct;
+    }
 }
 
-QList<QRect> Splitter::recalcGeometries(const QList<float>& proprotions)
+template <Qt::Orientation O>
+void Splitter::solveHandleMove(int handleIndex, int moveDist)
 {
-    QList<QRect> list;
-    int pos = 0;
-    int totalWidgetSize = getSize(this) - handleCount() * _handleWidth;
-    for (int i = 0; i < handleCount() + widgetCount(); i++)
+    layoutGeometries<O>(_sizeProportionArray, size(), _geoBuffer);
+    layoutSizesAtMoving<O>(_geoBuffer, handleIndex, moveDist, _minWidgetSize, _sizeBuffer);
+    proportionsFromSizes(_sizeBuffer, true, _lastSizeProportionsInMoving);
+    layoutGeometries<O>(_lastSizeProportionsInMoving, size(), _geoBuffer);
+}
+
+void Splitter::solveDragStep(int moveDist)
+{
+    _treeCommits.resize(0);
+    if (_movingHandleIndex < 0 || _movingHandleIndex >= _handleList.size())
     {
-        int size = 0;
-        if (i % 2 == 0)
-        {
-            int widgetIndex = i / 2;
-            if (widgetIndex < 0 || widgetIndex >= proprotions.size() || widgetIndex >= _widgetList.size())
-            {
-                continue;
-            }
-            float prop = proprotions.at(widgetIndex);
-            size = totalWidgetSize * prop;
-            QWidget *w = _widgetList[widgetIndex];
-            size = std::max<int>(size, getSize(w->minimumSize()));
-            if (w->layout() != nullptr)
-            {
-                size = std::max<int>(size, getSize(w->minimumSizeHint()));
-            }
-        }
-        else
+        return;
+    }
+    if (_orientation == Qt::Horizontal)
+    {
+        solveHandleMove<Qt::Horizontal>(_movingHandleIndex, moveDist);
+    }
+    else
+    {
+        solveHandleMove<Qt::Vertical>(_movingHandleIndex, moveDist);
+    }
+    collectTreeGeometries(_geoBuffer, _treeCommits);
+}
+
+void Splitter::commitDragStep()
+{
+    commitTreeGeometries(_treeCommits);
+}
+
+template <Qt::Orientation O>
+void Splitter::moveHandle(int handleIndex, const QPoint &curPos)
+{
+    if (_isOpaqueResize)
+    {
+        bool moveForward = Axis<O>::delta(curPos - _lastCurPos) > 0;
+        if (_isMoveForwardSoonAgo != moveForward && !_lastSizeProportionsInMoving.isEmpty())
         {
-            size = _handleWidth;
+            copyWithoutSharing(_lastSizeProportionsInMoving, _sizeProportionArray);
+            _startMovePos = _lastCurPos;
         }
-        QRect rect;
-        if (Qt::Horizontal == _orientation)
+        solveDragStep(Axis<O>::delta(curPos - _startMovePos));
+        commitDragStep();
+        _lastCurPos = curPos;
+
+        _isMoveForwardSoonAgo = moveForward;
+    }
+    else
+    {
+        solveHandleMove<O>(handleIndex, Axis<O>::delta(curPos - _startMovePos));
+        int handleGeoIndex = 2 * handleIndex + 1;
+        if (handleGeoIndex < 0 || handleGeoIndex >= _geoBuffer.size())
         {
-            rect = QRect(pos, 0, size, this->height());
+            return;
         }
-        else
+        QRect handleGeometry = _geoBuffer.at(handleGeoIndex);
+        handleGeometry.moveTo(this->mapToGlobal(handleGeometry.topLeft()));
+        if (_floatHandle == nullptr)
         {
-            rect = QRect(0, pos, this->width(), size);
+            _floatHandle = new SplitterHandle(_orientation, nullptr);
+            _floatHandle->raise();
+            _floatHandle->show();
         }
-        pos += size;
-        list.append(rect);
+        _floatHandle->setGeometry(handleGeometry);
     }
-    return list;
 }
 
 void Splitter::resizeEvent(QResizeEvent *event)
 {
-    QList<QRect> geoList = recalcGeometries(_sizeProportionArray);
-    resizeChildren(geoList);
+    // Inside a batch the splitter that started it has already placed our children
+    if (!_isPlacedByParent)
+    {
+        layoutInto(_sizeProportionArray, size(), _geoBuffer);
+        resizeChildren(_geoBuffer);
+    }
     QWidget::resizeEvent(event);
 }
 
@@ -532,6 +704,8 @@ bool Splitter::eventFilter(QObject *watched, QEvent *event)
         }
         else if (event->type() == QEvent::MouseButtonRelease)
         {
+            // Apply the last coalesced move first, so the final position is exact
+            _handleMovePacer->flush();
             QMouseEvent* mouseEvent = static_cast<QMouseEvent*>(event);
             onHandleReleaseEvent(h, mouseEvent);
         }
@@ -543,6 +717,7 @@ bool Splitter::event(QEvent* e)
 {
     if (e->type() == ENABLE_UPDATE_EVENT)
     {
+        _isEnableUpdatePending = false;
         setUpdatesEnabled(true);
         return true;
     }
@@ -551,64 +726,67 @@ bool Splitter::event(QEvent* e)
 
 void Splitter::onHandlePressEvent(SplitterHandle* h, QMouseEvent* e)
 {
-    (void)(h);
     _startMovePos = e->globalPosition().toPoint();
     _lastCurPos = e->globalPosition().toPoint();
+    _movingHandleIndex = _handleList.indexOf(h);
+
+    reserveDragBuffers();
+}
+
+void Splitter::reserveDragBuffers()
+{
+    // Grow the scratch buffers once per drag, the move steps only reuse them
+    const int geoCount = handleCount() + widgetCount();
+    _sizeBuffer.reserve(geoCount);
+    _lastSizeProportionsInMoving.reserve(widgetCount());
+    _sizeProportionArray.reserve(widgetCount());
+    _treeCommits.reserve(reserveTreeBuffers());
+}
+
+int Splitter::reserveTreeBuffers()
+{
+    // Every nested splitter lays itself out into its own _geoBuffer during the step
+    int commitCount = handleCount() + widgetCount();
+    _geoBuffer.reserve(commitCount);
+    for (int i = 0; i < _widgetList.size(); i++)
+    {
+        Splitter *childSplitter = qobject_cast<Splitter *>(_widgetList.at(i));
+        if (childSplitter != nullptr)
+        {
+            commitCount += childSplitter->reserveTreeBuffers();
+        }
+    }
+    return commitCount;
 }
 
 void Splitter::onHandleMoveEvent(SplitterHandle* h, QMouseEvent* e)
+{
+    (void)(h);
+    if (_startMovePos.x() < 0 || _startMovePos.y() < 0)
+    {
+        return;
+    }
+    _handleMovePacer->pushMove(e->globalPosition().toPoint());
+}
+
+void Splitter::onHandleMoved(const QPoint &globalPos)
 {
     if (_startMovePos.x() < 0 || _startMovePos.y() < 0)
     {
         return;
     }
-    int handIndex = _handleList.indexOf(h);
-    if (handIndex == -1)
+    if (_movingHandleIndex < 0 || _movingHandleIndex >= _handleList.size())
     {
         Q_ASSERT(false);
         return;
     }
-    if (_isOpaqueResize)
+    if (_orientation == Qt::Horizontal)
     {
-        bool moveForward = isMoveForward(e->globalPosition().toPoint(), _lastCurPos);
-        if (_isMoveForwardSoonAgo != moveForward && !_lastSizeProportionsInMoving.isEmpty())
-        {
-            _sizeProportionArray = _lastSizeProportionsInMoving;
-            _startMovePos = _lastCurPos;
-        }
-        QPoint moveVector = e->globalPosition().toPoint() - _startMovePos;
-        int moveDist = (_orientation == Qt::Horizontal) ? moveVector.x() : moveVector.y();
-        QList<QRect> geoList = recalcGeometries(_sizeProportionArray);
-        QList<int> newSizes = recalcSizesAtMoving(geoList, handIndex, moveDist, _minWidgetSize);
-        _lastSizeProportionsInMoving = getProportions(newSizes, true);
-        QList<QRect> newGeoList = recalcGeometries(_lastSizeProportionsInMoving);
-        resizeChildren(newGeoList);
-        _lastCurPos = e->globalPosition().toPoint();
-
-        _isMoveForwardSoonAgo = moveForward;
+        moveHandle<Qt::Horizontal>(_movingHandleIndex, globalPos);
     }
     else
     {
-        QPoint moveVector = e->globalPosition().toPoint() - _startMovePos;
-        int moveDist = (_orientation == Qt::Horizontal) ? moveVector.x() : moveVector.y();
-        QList<QRect> geoList = recalcGeometries(_sizeProportionArray);
-        QList<int> newSizes = recalcSizesAtMoving(geoList, handIndex, moveDist, _minWidgetSize);
-        _lastSizeProportionsInMoving = getProportions(newSizes, true);
-        QList<QRect> newGeoList = recalcGeometries(_lastSizeProportionsInMoving);
-        int handleGeoIndex = 2 * handIndex + 1;
-        if (handleGeoIndex < 0 || handleGeoIndex >= newGeoList.size())
-        {
-            return;
-        }
-        QRect handleGeometry = newGeoList.at(handleGeoIndex);
-        handleGeometry.moveTo(this->mapToGlobal(handleGeometry.topLeft()));
-        if (_floatHandle == nullptr)
-        {
-            _floatHandle = new SplitterHandle(_orientation, nullptr);
-            _floatHandle->raise();
-            _floatHandle->show();
-        }
-        _floatHandle->setGeometry(handleGeometry);
+        moveHandle<Qt::Vertical>(_movingHandleIndex, globalPos);
     }
 }
 
@@ -620,6 +798,7 @@ void Splitter::onHandleReleaseEvent(SplitterHandle* h, QMouseEvent* e)
     _startMovePos.setY(-1);
     _lastCurPos.setX(-1);
     _lastCurPos.setY(-1);
+    _movingHandleIndex = -1;
     if (!_isOpaqueResize)
     {
         if (nullptr != _floatHandle)
@@ -630,11 +809,12 @@ void Splitter::onHandleReleaseEvent(SplitterHandle* h, QMouseEvent* e)
     }
     if (!_lastSizeProportionsInMoving.isEmpty())
     {
-        _sizeProportionArray = _lastSizeProportionsInMoving;
-        _lastSizeProportionsInMoving.clear();
+        copyWithoutSharing(_lastSizeProportionsInMoving, _sizeProportionArray);
+        _lastSizeProportionsInMoving.resize(0);
     }
     QList<QRect> newGeoList = recalcGeometries(_sizeProportionArray);
     resizeChildren(newGeoList);
+    emit handleReleased();
 }
 
 void Splitter::childEvent(QChildEvent *event)
@@ -675,6 +855,7 @@ QWidget *Splitter::removeWidget(QWidget *w)
     }
     QList<QRect> geoList = recalcGeometries(_sizeProportionArray);
     resizeChildren(geoList);
+    emit widgetRemoved(ret);
     return ret;
 }
 
@@ -16,6 +16,7 @@
 namespace dock {
 
 class SplitterHandle;
+class DragFramePacer;
 class Splitter : public QWidget
 {
     Q_OBJECT
@@ -40,6 +41,17 @@ public:
 
     void updateSizes(const QList<int>& sizes);
     void updateSizes(int count, ...);
+
+    // Coalesce handle drags to one layout per display frame
+    void setFramePacedResize(bool enable);
+    const DragFramePacer *handleMovePacer() const { return _handleMovePacer; }
+
+signals:
+    void widgetInserted(int index, QWidget *widget);
+    void widgetRemoved(QWidget *widget);
+    // A handle drag ended, the sizes are final
+    void handleReleased();
+
 protected:
     virtual void resizeEvent(QResizeEvent *event) override;
     virtual void moveEvent(QMoveEvent *event) override;
@@ -48,6 +60,13 @@ protected:
     virtual bool event(QEvent *e) override;
     virtual QSize minimumSizeHint() const override;
 
+    // The smallest a child gets while a handle is dragged
+    void setMinimumWidgetSize(int size) { _minWidgetSize = size; }
+    // A drag step of the pressed handle as onHandleMoved runs it: the solve only fills the
+    // buffers reserved on press, the commit applies them to the widgets
+    void solveDragStep(int moveDist);
+    void commitDragStep();
+
 private:
     int getSizeHint(const QWidget *w) const;
     int getSize(const QWidget *w) const;
@@ -64,9 +83,42 @@ private:
     int sumRects(const QList<QRect> &list) const;
     bool isMoveForward(QPoint posNow, QPoint posStart) const;
 
+    // Geometry to be applied to one child or handle of the splitter tree
+    struct GeometryCommit
+    {
+        QWidget *widget;
+        Splitter *splitter;     // widget, when it is a nested splitter
+        QRect geometry;
+    };
+
     void resizeChildren(const QList<QRect> &geoList);
+    void collectTreeGeometries(const QList<QRect> &geoList, QList<GeometryCommit> &commits);
+    void commitTreeGeometries(const QList<GeometryCommit> &commits);
+    void updateMinSizeHint();
+    void layoutInto(const QList<float> &proportions, const QSize &extent, QList<QRect> &geoList) const;
     QList<QRect> recalcGeometries(const QList<float> &proprotions);
 
+    // Layout kernel, specialized on orientation and writing into caller-owned
+    // buffers so that a handle drag does not allocate per mouse move
+    template <Qt::Orientation O>
+    void layoutGeometries(const QList<float> &proportions, const QSize &extent, QList<QRect> &geoList) const;
+    template <Qt::Orientation O>
+    void layoutSizesAtMoving(
+        const QList<QRect> &oldGeo,
+        int movedHandleIndex,
+        int moveDist,
+        int minSize,
+        QList<int> &sizeList) const;
+    void proportionsFromSizes(const QList<int> &sizes, bool isContainHandleSizes, QList<float> &proportions) const;
+    // New proportions and geometries of a drag step, into the reserved buffers
+    template <Qt::Orientation O>
+    void solveHandleMove(int handleIndex, int moveDist);
+    template <Qt::Orientation O>
+    void moveHandle(int handleIndex, const QPoint &curPos);
+    // Reserves what a drag step of this splitter and its nested ones fills
+    void reserveDragBuffers();
+    int reserveTreeBuffers();
+
     QList<int> recalcSizesAtInserting(
         const QList<QRect> &oldGeo,
         int insertedIndex,
@@ -75,17 +127,13 @@ private:
 
     QList<int> recalcSizesAtDeleting(const QList<QRect> &oldGeo, int deletedWidgetIndex);
 
-    QList<int> recalcSizesAtMoving(
-        const QList<QRect> &oldGeo,
-        int movedHandleIndex,
-        int moveDist,
-        int minSize);
-
     QList<float> getProportions(const QList<int> &sizes, bool isContainHandleSizes);
 
     void onHandlePressEvent(SplitterHandle *h, QMouseEvent *e);
     void onHandleMoveEvent(SplitterHandle *h, QMouseEvent *e);
     void onHandleReleaseEvent(SplitterHandle *h, QMouseEvent *e);
+private slots:
+    void onHandleMoved(const QPoint &globalPos);
 private:
     int _handleWidth;
     int _minWidgetSize;
@@ -102,6 +150,18 @@ private:
     bool _isOpaqueResize;
     SplitterHandle *_floatHandle;
     QSize _minSizeHint;
+
+    // Scratch buffers reused by every drag step
+    int _movingHandleIndex;
+    QList<QRect> _geoBuffer;
+    QList<int> _sizeBuffer;
+    bool _isEnableUpdatePending;
+    DragFramePacer *_handleMovePacer;
+
+    // Geometries of the whole subtree, collected top-down and applied in one batch
+    QList<GeometryCommit> _treeCommits;
+    // Set while a parent's batch is resizing this splitter with its children already placed
+    bool _isPlacedByParent;
 };
 
 }
@@ -0,0 +1,64 @@
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QCborValue>
+#include <QCborMap>
+
+#include "StateStore.h"
+#include "DockModel.h"
+
+namespace dock {
+
+static const QString c_strStateSuffix = ".state";
+
+StateStore::StateStore(const QString &directory)
+    : _directory(directory)
+{
+    QDir().mkpath(_directory);
+}
+
+QString StateStore::blobPath(const QString &key) const
+{
+    return _directory + "/" + key + c_strStateSuffix;
+}
+
+QString StateStore::put(const QJsonObject &state, const QByteArray &stateHash)
+{
+    QString key = QString::fromLatin1((stateHash.isEmpty() ? DockModel::stateHash(state) : stateHash).toHex());
+    if (contains(key))
+    {
+        return key;
+    }
+    QSaveFile file(blobPath(key));
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return QString();
+    }
+    file.write(QCborMap::fromJsonObject(state).toCborValue().toCbor());
+    return file.commit() ? key : QString();
+}
+
+QJsonObject StateStore::get(const QString &key) const
+{
+    QFile file(blobPath(key));
+    if (key.isEmpty() || !file.open(QIODevice::ReadOnly) || file.size() == 0)
+    {
+        return QJsonObject();
+    }
+    uchar *data = file.map(0, file.size());
+    if (data == nullptr)
+    {
+        return QCborValue::fromCbor(file.readAll()).toMap().toJsonObject();
+    }
+    // The parse copies what it keeps, the mapping is only read for its duration
+    QJsonObject state = QCborValue::fromCbor(QByteArray::fromRawData((const char *)data, (int)file.size())).toMap().toJsonObject();
+    file.unmap(data);
+    return state;
+}
+
+bool StateStore::contains(const QString &key) const
+{
+    return !key.isEmpty() && QFile::exists(blobPath(key));
+}
+
+}
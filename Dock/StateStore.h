@@ -0,0 +1,43 @@
+/**********************************************************
+* @file     StateStore.h
+* @brief    Directory of window states keyed by content hash; layouts
+*           reference a state by key instead of embedding it
+*
+***********************************************************/
+#ifndef STATESTORE_H
+#define STATESTORE_H
+
+#include <QString>
+#include <QJsonObject>
+#include <QByteArray>
+
+#include "dock_global.h"
+
+namespace dock {
+
+// One CBOR file per state, named by DockModel::stateHash in hex. A file is written once and
+// never changed, so equal states of any number of layouts share it and get() is thread safe.
+// Blobs are never deleted: a layout saved anywhere may reference one, and the store cannot know them all
+class DOCKSHARED_EXPORT StateStore
+{
+public:
+    explicit StateStore(const QString &directory);
+
+    QString directory() const { return _directory; }
+
+    // The key of the state, its hash when already known; an existing blob is not written again
+    QString put(const QJsonObject &state, const QByteArray &stateHash = QByteArray());
+    // Read through a file mapping, empty for an unknown key
+    QJsonObject get(const QString &key) const;
+    bool contains(const QString &key) const;
+
+private:
+    QString blobPath(const QString &key) const;
+
+private:
+    QString _directory;
+};
+
+}
+
+#endif // STATESTORE_H
@@ -33,6 +33,7 @@ TabWidget::TabWidget(QWidget *parent)
     mainLayout->addWidget(_stackedWidget);
 
     connect(_tabBar, &TabBar::currentChanged, this, &TabWidget::setCurrentWidgetIndex);
+    connect(_stackedWidget, &QStackedWidget::currentChanged, this, &TabWidget::onStackedWidgetCurrentChanged);
 }
 
 TabWidget::~TabWidget()
@@ -47,6 +48,7 @@ TabBar* TabWidget::tabBar()
 int TabWidget::addTab(QWidget *page, const QString &label)
 {
     _stackedWidget->addWidget(page);
+    emit windowInserted(page);
     return _tabBar->addTab(label);
 }
 
@@ -55,9 +57,11 @@ int TabWidget::insertTab(int index, QWidget *page, const QString &label)
     if (index < 0)
     {
         _stackedWidget->addWidget(page);
+        emit windowInserted(page);
         return _tabBar->addTab(label);
     }
     _stackedWidget->insertWidget(index, page);
+    emit windowInserted(page);
     return _tabBar->insertTab(index, label);
 }
 
@@ -93,11 +97,13 @@ void TabWidget::removeOnlyWidget(QWidget *widget)
 {
     _stackedWidget->removeWidget(widget);
     widget->setParent(nullptr);
+    emit windowRemoved(widget);
 }
 
 void TabWidget::insertOnlyWidget(int index, QWidget *page)
 {
     _stackedWidget->insertWidget(index, page);
+    emit windowInserted(page);
 }
 
 void TabWidget::removeOnlyTab(int index)
@@ -159,6 +165,11 @@ void TabWidget::setCurrentWidgetIndex(int index)
     _stackedWidget->setCurrentIndex(index);
 }
 
+void TabWidget::onStackedWidgetCurrentChanged(int index)
+{
+    emit currentWidgetChanged(_stackedWidget->widget(index));
+}
+
 void TabWidget::setCurrentWidget(QWidget* widget)
 {
     auto index = _stackedWidget->indexOf(widget);
@@ -39,6 +39,14 @@ public:
 public slots:
     void setCurrentWidgetIndex(int index);
 
+signals:
+    void windowInserted(QWidget *page);
+    void windowRemoved(QWidget *page);
+    void currentWidgetChanged(QWidget *page);
+
+private slots:
+    void onStackedWidgetCurrentChanged(int index);
+
 private:
     TabBar*        _tabBar;
     QStackedWidget*      _stackedWidget;
@@ -11,6 +11,8 @@
 #define WINDOWFACTORY_H
 #include "dock_global.h"
 #include <QString>
+#include <QVariant>
+#include <QJsonObject>
 class QWidget;
 
 namespace dock {
@@ -24,6 +26,16 @@ public:
     virtual QString getTitle() = 0;
     virtual DockableWindow* create(QWidget* p) = 0;
 
+    // Two-phase creation for windows with an expensive load. prepare runs on a pool thread with
+    // the saved state and must not touch any widget; the window made by create then gets its
+    // result through DockableWindow::attach on the GUI thread instead of load
+    virtual bool isAsync() { return false; }
+    virtual QVariant prepare(const QJsonObject &state) { (void)state; return QVariant(); }
+
+    // Closed windows kept for newWindow to reuse instead of creating new ones, 0 to delete them.
+    // See DockableWindow::onRecycle and onReuse
+    virtual int recycleLimit() { return 0; }
+
     virtual ~WindowFactory() {}
 };
 
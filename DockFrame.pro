@@ -4,3 +4,4 @@ CONFIG += no_docs_target
 SUBDIRS       = \
                 Dock \
                 UnityDockFrame-Demo \
+                Benchmarks
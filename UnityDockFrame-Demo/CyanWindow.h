@@ -15,6 +15,7 @@ protected:
     void paintEvent(QPaintEvent *event) override;
 };
 
-STATIC_REGISTER_WINDOW(CyanWindow, "Cyan Window", false)
+// Closed cyan windows are kept for the next Add Tab instead of being deleted
+STATIC_REGISTER_RECYCLABLE_WINDOW(CyanWindow, "Cyan Window", false, 4)
 
 #endif
@@ -5,14 +5,34 @@
 #include <QApplication>
 #include <QJsonArray>
 #include <QJsonObject>
+#include <QFileInfo>
+#include <QTimer>
 
 #include "MainWindow.h"
 #include "DockContainer.h"
+#include "StateStore.h"
+#include "LayoutLibrary.h"
+#include "LayoutPreset.h"
 #include "DockableWindow.h"
 #include "BlackWindow.h"
 #include "WindowFactoryManager.h"
 
 using namespace dock;
+
+// Compiled in: the "Preset Layout" menu builds it without any file or parsing
+static constexpr const char *presetEditorWindows[] = {"RedWindow", "GreenWindow"};
+static constexpr const char *presetToolWindows[] = {"BlueWindow"};
+static constexpr const char *presetSideWindows[] = {"CyanWindow"};
+static constexpr LayoutPresetNode presetNodes[] = {
+    presetSplitter(Qt::Horizontal, 1, 2),
+        presetSplitter(Qt::Vertical, 3, 2),
+            presetTabGroup(2, presetEditorWindows),
+            presetTabGroup(1, presetToolWindows),
+        presetTabGroup(1, presetSideWindows)
+};
+static constexpr LayoutPreset presetLayout = layoutPreset("Preset", presetNodes);
+static_assert(isValidLayoutPreset(presetLayout), "malformed preset layout");
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
 {
@@ -21,6 +41,10 @@ MainWindow::MainWindow(QWidget *parent)
 
     this->setCentralWidget(new QWidget());
     m_pContainer = new DockContainer(this->centralWidget());
+    // Saved layouts keep only references to the window states, shared by all of them
+    m_pStateStore = new StateStore(QApplication::applicationDirPath() + "/layout/states");
+    m_pContainer->setStateStore(m_pStateStore);
+    m_pLayoutLibrary = new LayoutLibrary();
 
     QMenuBar *pMenuBar = menuBar();
     pMenuBar->addMenu(QStringLiteral("Menu 1"));
@@ -47,31 +71,82 @@ MainWindow::MainWindow(QWidget *parent)
     connect(pActionOpenLayout, &QAction::triggered, this, &MainWindow::onOpenLayout);
     QAction *pActionDefaultLayout =pLayoutMenu->addAction(QStringLiteral("Default Layout"));
     connect(pActionDefaultLayout, &QAction::triggered, this, &MainWindow::onDefaultLayout);
+    QAction *pActionPresetLayout =pLayoutMenu->addAction(QStringLiteral("Preset Layout"));
+    connect(pActionPresetLayout, &QAction::triggered, this, &MainWindow::onPresetLayout);
 
     QAction *pActionFixLayout =pLayoutMenu->addAction(QStringLiteral("Fix Layout"));
     pActionFixLayout->setCheckable(true);
     connect(pActionFixLayout, &QAction::triggered, this, &MainWindow::onFixLayout);
 
-    QString fileName = QApplication::applicationDirPath() + "/layout/lastModify.json";
+    // Show the saved layout right away and fill in its windows over the next frames
+    m_pContainer->setProgressiveRestore(true);
+    // Windows left out by layout switches are kept up to a budget, the rest saved and recreated
+    m_pContainer->setHiddenWindowBudget(16, 256 * 1024 * 1024);
+    // One red window is kept ready, Add Tab only has to dock it
+    m_pContainer->setWindowReserve(qHash(QString("RedWindow")), 1);
+    // The container starts with its compiled default layout, the first frame reads nothing from disk
+    QTimer::singleShot(0, this, &MainWindow::onRestoreLastLayout);
+}
+
+void MainWindow::onRestoreLastLayout()
+{
+    // All named layouts in one file, a switch reads only the layout switched to
+    m_pLayoutLibrary->open(QApplication::applicationDirPath() + "/layout/layouts.docklib");
+    // A journal left behind means the last session did not exit cleanly, its layout wins
+    QString journalName = QApplication::applicationDirPath() + "/layout/session.journal";
+    if (m_pContainer->openJournal(journalName))
+        return;
+    QString currentLayoutName = m_pLayoutLibrary->currentLayoutName();
+    if (!currentLayoutName.isEmpty() && m_pContainer->createLayoutFromLibrary(*m_pLayoutLibrary, currentLayoutName))
+        return;
+    // The binary layout is written on exit, the json one is the fallback for older installs
+    QString fileName = QApplication::applicationDirPath() + "/layout/lastModify.dock";
+    if (!QFile::exists(fileName))
+        fileName = QApplication::applicationDirPath() + "/layout/lastModify.json";
     openLayout(fileName);
 }
 
 MainWindow::~MainWindow()
 {
-    QString fileName = QApplication::applicationDirPath() + "/layout/lastModify.json";
-    saveLayout(fileName);
+    // Encoded and written on the save thread, which also finishes any layout saved from the menu
+    m_pContainer->saveLayoutToLibraryInBackground(*m_pLayoutLibrary, "lastModify");
+    m_pContainer->waitForBackgroundSaves();
+    if (m_pLayoutLibrary->contains("lastModify"))
+        m_pLayoutLibrary->setCurrentLayoutName("lastModify");
+    // Replaced layouts pile up at the end of the file until it is compacted
+    if (m_pLayoutLibrary->garbageSize() > 1024 * 1024)
+        m_pLayoutLibrary->compact();
+    delete m_pLayoutLibrary;
+    m_pContainer->closeJournal();
+    m_pContainer->setStateStore(nullptr);
+    delete m_pStateStore;
 }
 
 void MainWindow::onLayout1()
 {
-    QString fileName = QApplication::applicationDirPath() + "/layout/layout1.json";
-    openLayout(fileName);
+    openNamedLayout("layout1");
 }
 
 void MainWindow::onLayout2()
 {
-    QString fileName = QApplication::applicationDirPath() + "/layout/layout2.json";
-    openLayout(fileName);
+    openNamedLayout("layout2");
+}
+
+void MainWindow::openNamedLayout(const QString &strLayoutName)
+{
+    if (m_pContainer->switchToCachedLayout(strLayoutName))
+        return;
+    if (m_pLayoutLibrary->contains(strLayoutName))
+    {
+        m_pContainer->createLayoutFromLibrary(*m_pLayoutLibrary, strLayoutName);
+        return;
+    }
+    // First use: the separate json file is imported into the library
+    QString fileName = QApplication::applicationDirPath() + "/layout/" + strLayoutName + ".json";
+    if (!QFile::exists(fileName))
+        return;
+    openLayout(fileName, strLayoutName);
+    m_pContainer->saveLayoutToLibrary(*m_pLayoutLibrary, strLayoutName);
 }
 
 void MainWindow::onOpenLayout()
@@ -91,6 +166,11 @@ void MainWindow::onDefaultLayout()
     m_pContainer->initLayout();
 }
 
+void MainWindow::onPresetLayout()
+{
+    m_pContainer->createLayoutFromPreset(presetLayout);
+}
+
 void MainWindow::onFixLayout(bool bChecked)
 {
     m_pContainer->enableDrag(!bChecked);
@@ -103,25 +183,31 @@ void MainWindow::onCreateWindow(int windowType)
 
 void MainWindow::saveLayout(const QString &strFileName)
 {
-    QFile file(strFileName);
-    if (!file.open(QIODevice::WriteOnly))
-        return;
-
-    QJsonObject object;
-    m_pContainer->saveLayoutToJson(object);
-
-    QJsonDocument doc;
-    doc.setObject(object);
-    file.write(doc.toJson());
-    file.close();
+    // Only the snapshot is taken here; the save thread compares it with the file and writes it if it changed
+    DockContainer::LayoutFormat format = isBinaryLayout(strFileName) ? DockContainer::CBOR_LAYOUT : DockContainer::JSON_LAYOUT;
+    m_pContainer->saveLayoutInBackground(strFileName, format);
 }
 
-void MainWindow::openLayout(const QString &strFileName)
+void MainWindow::openLayout(const QString &strFileName, const QString &strLayoutName)
 {
     QFile file(strFileName);
     if (!file.open(QIODevice::ReadOnly))
         return;
-    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
-    m_pContainer->createLayoutFromJson(doc.object());
+    QByteArray data = DockContainer::uncompressLayout(file.readAll());
     file.close();
+    if (isBinaryLayout(strFileName))
+    {
+        m_pContainer->createLayoutFromCbor(data);
+        return;
+    }
+    QJsonDocument doc = QJsonDocument::fromJson(data);
+    if (strLayoutName.isEmpty())
+        m_pContainer->createLayoutFromJson(doc.object());
+    else
+        m_pContainer->createLayoutFromJson(doc.object(), strLayoutName);
+}
+
+bool MainWindow::isBinaryLayout(const QString &strFileName) const
+{
+    return QFileInfo(strFileName).suffix() == "dock";
 }
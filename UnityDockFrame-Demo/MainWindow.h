@@ -5,6 +5,8 @@
 
 namespace dock {
     class DockContainer;
+    class StateStore;
+    class LayoutLibrary;
 }
 class MainWindow : public QMainWindow
 {
@@ -20,15 +22,21 @@ private slots:
     void onOpenLayout();
     void onSaveLayout();
     void onDefaultLayout();
+    void onPresetLayout();
+    void onRestoreLastLayout();
     void onFixLayout(bool bChecked);
     void onCreateWindow(int windowType);
 
 private:
-    void openLayout(const QString &strFileName);
+    void openLayout(const QString &strFileName, const QString &strLayoutName = QString());
+    void openNamedLayout(const QString &strLayoutName);
     void saveLayout(const QString &strFileName);
+    bool isBinaryLayout(const QString &strFileName) const;
 
 private:
      dock::DockContainer *m_pContainer = nullptr;
+     dock::StateStore *m_pStateStore = nullptr;
+     dock::LayoutLibrary *m_pLayoutLibrary = nullptr;
 };
 
 #endif // MAINWINDOW_H